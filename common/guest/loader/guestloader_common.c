@@ -2,6 +2,7 @@
 #include <arch_types.h>
 #include <linuxloader.h>
 #include <guestloader_common.h>
+#include <log/string.h>
 
 #define SET_MACHINE_TYPE_TO_R1() \
     asm volatile ("mov r1, %0" : : "r" (MACHINE_TYPE) : "memory", "cc")
@@ -27,11 +28,7 @@ enum guest_image_type {
 
 void copy_image_to(uint32_t *src_addr, uint32_t *end_addr, uint32_t *dst_addr)
 {
-    uint32_t *src = src_addr;
-    uint32_t *end = end_addr;
-    uint32_t *dst = dst_addr;
-    while (src < end)
-        *dst++ = *src++;
+    memcpy(dst_addr, src_addr, (end_addr - src_addr) * sizeof(uint32_t));
 }
 
 void loader_boot_guest(uint32_t guest_os_type)
@@ -7,6 +7,7 @@
 #include <log/print.h>
 #include <gic.h>
 #include <guestloader_common.h>
+#include <monitor_dump.h>
 #ifdef _GDB_
 #include <gdb_stub.h>
 #endif
@@ -180,6 +181,11 @@ int symbol_getter_from_va(uint32_t va, char *symbol)
 #define MEMORY 2
 #define REGISTER 3
 #define BREAK 4
+#define IRQ_STATS 5
+#define TRACE 6
+#define EXIT_STATS 7
+#define PROFILE 8
+#define PROBE 9
 
 /* size 200..0xc8 -> 0xEC00100 : memory dump, 0xEC000D0 : vmid info*/
 struct monitoring_data {
@@ -202,6 +208,89 @@ void send_monitoring_data(uint32_t range, uint32_t src)
     shared_start->start_memory = src;
 }
 
+/*
+ * Flat profile of the target guest. Samples are symbolised with the code
+ * symbols of the target, others are only counted.
+ */
+#define PROFILE_TARGET_VMID 0
+#define PROFILE_TOP 16
+#define CPSR_MODE_USER 0x10
+#define NUM_SYMBOLS_CODE \
+    (sizeof(system_maps_code) / sizeof(system_maps_code[0]))
+
+static uint32_t profile_hits[NUM_SYMBOLS_CODE];
+static uint32_t profile_total;
+static uint32_t profile_dropped;
+static uint32_t profile_other_vmid;
+static uint32_t profile_user;
+static uint32_t profile_unknown;
+
+void profile_reset(void)
+{
+    memset(profile_hits, 0, sizeof(profile_hits));
+    profile_total = 0;
+    profile_dropped = 0;
+    profile_other_vmid = 0;
+    profile_user = 0;
+    profile_unknown = 0;
+}
+
+static void profile_account(uint32_t pc, uint32_t info)
+{
+    int i;
+
+    profile_total++;
+    if (((info >> 8) & 0xFF) != PROFILE_TARGET_VMID) {
+        profile_other_vmid++;
+        return;
+    }
+    if ((info & 0x1F) == CPSR_MODE_USER) {
+        profile_user++;
+        return;
+    }
+    if (num_symbols_code == 0) {
+        profile_unknown++;
+        return;
+    }
+    i = symbol_binary_search(system_maps_code, pc, 0, num_symbols_code - 1);
+    if (i < 0)
+        profile_unknown++;
+    else
+        profile_hits[i]++;
+}
+
+/* Prints the symbols with the most samples, in decreasing order */
+static void profile_show(void)
+{
+    int top[PROFILE_TOP];
+    int i, j, k, best;
+
+    if (profile_total == 0) {
+        printh("no samples\n");
+        return;
+    }
+    printh("%d samples, %d dropped, %d other vmids, %d user, %d unknown\n",
+            profile_total, profile_dropped, profile_other_vmid,
+            profile_user, profile_unknown);
+    for (k = 0; k < PROFILE_TOP; k++) {
+        best = -1;
+        for (i = 0; i < num_symbols_code; i++) {
+            if (!profile_hits[i] ||
+                    (best >= 0 && profile_hits[i] <= profile_hits[best]))
+                continue;
+            for (j = 0; j < k && top[j] != i; j++)
+                ;
+            if (j == k)
+                best = i;
+        }
+        if (best < 0)
+            break;
+        top[k] = best;
+        printh("%d%% %d %s\n", profile_hits[best] * 100 / profile_total,
+                profile_hits[best], system_maps_code[best].symbol);
+    }
+}
+
 int recovery_cnt;
 
 void set_recovery(int cnt)
@@ -297,6 +386,128 @@ void monitoring_handler(int irq, void *pregs, void *pdata)
             printh("\n");
         }
 #endif
+    } else if (shared_start->type == IRQ_STATS) {
+        /* interrupt latency histograms, see monitor_dump.h */
+        uint32_t *dump_base = (uint32_t *)(&shared_memory_start) + (0x100/4);
+        uint32_t elapsed, tick_per_us, num_guests, num_buckets, num_pirqs;
+        int g, s, b;
+        static const char *stage_name[IRQ_STATS_NUM_STAGES] =
+            IRQ_STATS_STAGE_NAMES;
+
+        if (shared_start->memory_range == 0)
+            return;
+        elapsed = dump_base[0];
+        tick_per_us = dump_base[1];
+        num_guests = dump_base[2];
+        num_buckets = dump_base[3];
+        dump_base += IRQ_STATS_HEADER_WORDS;
+        printh("elapsed %d us, %d ticks/us, histogram bucket n: "
+                "[2^n, 2^(n+1)) ticks\n", elapsed / tick_per_us, tick_per_us);
+        for (g = 0; g < num_guests; g++) {
+            printh("vmid %d injected %d eoi %d dropped %d\n", g,
+                    dump_base[0], dump_base[1], dump_base[2]);
+            dump_base += IRQ_STATS_GUEST_COUNTERS;
+            for (s = 0; s < IRQ_STATS_NUM_STAGES; s++) {
+                for (b = 0; b < num_buckets; b++) {
+                    if (dump_base[b])
+                        printh("  %s [%d] : %d\n", stage_name[s], b,
+                                dump_base[b]);
+                }
+                dump_base += num_buckets;
+            }
+        }
+        num_pirqs = *dump_base++;
+        for (i = 0; i < num_pirqs; i++) {
+            printh("pirq %d arrived %d injected %d max %d ticks\n",
+                    dump_base[0], dump_base[1], dump_base[2], dump_base[3]);
+            dump_base += IRQ_STATS_PIRQ_WORDS;
+        }
+    } else if (shared_start->type == TRACE) {
+        /* hypervisor event records, see monitor_dump.h */
+        uint32_t *dump_base = (uint32_t *)(&shared_memory_start) + (0x100/4);
+        uint32_t tick_per_us, num_records, lost, base;
+        uint32_t *rec;
+        static const char *event_name[TRACE_EV_NUM] = TRACE_EV_NAMES;
+
+        if (shared_start->memory_range == 0)
+            return;
+        tick_per_us = dump_base[0];
+        num_records = dump_base[1];
+        lost = dump_base[2];
+        dump_base += TRACE_DUMP_HEADER_WORDS;
+        printh("%d records, %d lost\n", num_records, lost);
+        /* Records are grouped by cpu, time is relative to the earliest */
+        base = dump_base[0];
+        for (i = 0; i < num_records; i++) {
+            rec = dump_base + i * TRACE_RECORD_WORDS;
+            if ((int)(rec[0] - base) < 0)
+                base = rec[0];
+        }
+        for (i = 0; i < num_records; i++) {
+            rec = dump_base + i * TRACE_RECORD_WORDS;
+            printh("cpu %d %d us %s %x %x %x\n", rec[2] >> 16,
+                    (rec[0] - base) / tick_per_us,
+                    (rec[2] & 0xFFFF) < TRACE_EV_NUM ?
+                        event_name[rec[2] & 0xFFFF] : "unknown",
+                    rec[3], rec[4], rec[5]);
+        }
+    } else if (shared_start->type == EXIT_STATS) {
+        /* exits to the hypervisor, see monitor_dump.h */
+        uint32_t *dump_base = (uint32_t *)(&shared_memory_start) + (0x100/4);
+        uint32_t elapsed, num_records, key, class;
+        static const char *class_name[EXIT_STATS_NUM_CLASSES] =
+            EXIT_STATS_CLASS_NAMES;
+
+        if (shared_start->memory_range == 0)
+            return;
+        elapsed = dump_base[0];
+        num_records = dump_base[1];
+        dump_base += EXIT_STATS_HEADER_WORDS;
+        printh("elapsed %d us\n", elapsed);
+        for (i = 0; i < num_records; i++) {
+            key = dump_base[0];
+            class = (key >> 16) & 0xFF;
+            printh("vmid %d %s %x : %d exits %d us\n", key >> 24,
+                    class < EXIT_STATS_NUM_CLASSES ?
+                        class_name[class] : "unknown",
+                    key & 0xFFFF, dump_base[1], dump_base[2]);
+            dump_base += EXIT_STATS_RECORD_WORDS;
+        }
+    } else if (shared_start->type == PROFILE) {
+        /* guest pc samples, see monitor_dump.h */
+        uint32_t *dump_base = (uint32_t *)(&shared_memory_start) + (0x100/4);
+        uint32_t num_samples;
+
+        if (shared_start->memory_range == 0)
+            return;
+        num_samples = dump_base[0];
+        profile_dropped += dump_base[1];
+        dump_base += PROFILE_DUMP_HEADER_WORDS;
+        for (i = 0; i < num_samples; i++) {
+            profile_account(dump_base[0], dump_base[1]);
+            dump_base += PROFILE_SAMPLE_WORDS;
+        }
+        profile_show();
+    } else if (shared_start->type == PROBE) {
+        /* hypervisor probe costs, see monitor_dump.h */
+        uint32_t *dump_base = (uint32_t *)(&shared_memory_start) + (0x100/4);
+        uint32_t tick_per_us, num_records, site;
+        static const char *site_name[PROBE_NUM_SITES] = PROBE_SITE_NAMES;
+
+        if (shared_start->memory_range == 0)
+            return;
+        tick_per_us = dump_base[0];
+        num_records = dump_base[1];
+        dump_base += PROBE_HEADER_WORDS;
+        printh("ticks, %d per us\n", tick_per_us);
+        for (i = 0; i < num_records; i++) {
+            site = dump_base[0] & 0xFFFF;
+            printh("cpu %d %s : %d hits min %d avg %d max %d\n",
+                    dump_base[0] >> 16,
+                    site < PROBE_NUM_SITES ? site_name[site] : "unknown",
+                    dump_base[1], dump_base[2], dump_base[3], dump_base[4]);
+            dump_base += PROBE_RECORD_WORDS;
+        }
     } else if (shared_start->type == BREAK) {
         // break target
 #ifdef _GDB_
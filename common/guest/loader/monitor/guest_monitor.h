@@ -19,6 +19,16 @@
 #define MONITOR_READ_REGISTER               (0x0a * 4)
 #define MONITOR_READ_STOP                   (0x0b * 4)
 #define MONITOR_READ_PUT_MEMORY             (0x0c * 4)
+#define MONITOR_READ_IRQ_STATS              (0x0e * 4)
+#define MONITOR_READ_IRQ_STATS_RESET        (0x0f * 4)
+#define MONITOR_WRITE_IRQ_COALESCE          (0x10 * 4)
+#define MONITOR_READ_TRACE                  (0x11 * 4)
+#define MONITOR_READ_EXIT_STATS             (0x12 * 4)
+#define MONITOR_READ_EXIT_STATS_RESET       (0x13 * 4)
+#define MONITOR_WRITE_PROFILE               (0x14 * 4)
+#define MONITOR_READ_PROFILE                (0x15 * 4)
+#define MONITOR_READ_PROBE                  (0x16 * 4)
+#define MONITOR_READ_PROBE_RESET            (0x17 * 4)
 
 #define GDBSTUB 1
 #define MONITORSTUB 2
@@ -100,6 +110,7 @@ void reboot(void);
 void set_recovery(int cnt);
 void allset(void);
 void get_general_reg(struct arch_regs *regs, uint32_t *sp);
+void profile_reset(void);
 
 extern uint32_t loader_start;
 extern uint32_t restore_start;
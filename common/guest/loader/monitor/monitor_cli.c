@@ -30,6 +30,26 @@ volatile uint32_t *base_register =
         (uint32_t *) (VDEV_MONITORING_BASE + MONITOR_READ_REGISTER);
 volatile uint32_t *base_stop =
         (uint32_t *) (VDEV_MONITORING_BASE + MONITOR_READ_STOP);
+volatile uint32_t *base_irq_stats =
+        (uint32_t *) (VDEV_MONITORING_BASE + MONITOR_READ_IRQ_STATS);
+volatile uint32_t *base_irq_stats_reset =
+        (uint32_t *) (VDEV_MONITORING_BASE + MONITOR_READ_IRQ_STATS_RESET);
+volatile uint32_t *base_irq_coalesce =
+        (uint32_t *) (VDEV_MONITORING_BASE + MONITOR_WRITE_IRQ_COALESCE);
+volatile uint32_t *base_trace =
+        (uint32_t *) (VDEV_MONITORING_BASE + MONITOR_READ_TRACE);
+volatile uint32_t *base_exit_stats =
+        (uint32_t *) (VDEV_MONITORING_BASE + MONITOR_READ_EXIT_STATS);
+volatile uint32_t *base_exit_stats_reset =
+        (uint32_t *) (VDEV_MONITORING_BASE + MONITOR_READ_EXIT_STATS_RESET);
+volatile uint32_t *base_profile_set =
+        (uint32_t *) (VDEV_MONITORING_BASE + MONITOR_WRITE_PROFILE);
+volatile uint32_t *base_profile =
+        (uint32_t *) (VDEV_MONITORING_BASE + MONITOR_READ_PROFILE);
+volatile uint32_t *base_probe =
+        (uint32_t *) (VDEV_MONITORING_BASE + MONITOR_READ_PROBE);
+volatile uint32_t *base_probe_reset =
+        (uint32_t *) (VDEV_MONITORING_BASE + MONITOR_READ_PROBE_RESET);
 
 #define monitoring_list()  (*base_list)
 #define monitoring_stop()  (*base_stop)
@@ -55,6 +75,12 @@ enum monitoring_cmd_type {
     MONITORING_RECOVERY,
     MONITORING_REGISTER,
     MONITORING_STOP,
+    MONITORING_IRQ_STATS,
+    MONITORING_IRQ_COALESCE,
+    MONITORING_TRACE,
+    MONITORING_EXIT_STATS,
+    MONITORING_PROFILE,
+    MONITORING_PROBE,
     MONITORING_NOINPUT
 };
 
@@ -84,6 +110,12 @@ static struct monitoring_cmd monitoring_cmd_type_map_tbl[NUM_MONITORING_CMD] = {
     {"exit", MONITORING_EXIT},
     {"reg", MONITORING_REGISTER},
     {"stop", MONITORING_STOP},
+    {"irq", MONITORING_IRQ_STATS},
+    {"coal", MONITORING_IRQ_COALESCE},
+    {"trace", MONITORING_TRACE},
+    {"kstat", MONITORING_EXIT_STATS},
+    {"prof", MONITORING_PROFILE},
+    {"probe", MONITORING_PROBE},
 };
 
 static void monitoring_help(void)
@@ -100,6 +132,17 @@ static void monitoring_help(void)
                "rb                  - Target System reboot\n"
                "rc                  - Set Fault tolerance system\n"
                "reg                 - Dump target vm's register info\n"
+               "irq [reset]         - Show or reset interrupt latency stats\n"
+               "coal <vmid> <virq> <count> <window us> <interval us>\n"
+               "                    - Coalesce a guest interrupt line\n"
+               "                      [coal 0 47 8 1000 0], count 1 and\n"
+               "                      interval 0 turn it off\n"
+               "trace               - Drain hypervisor event trace\n"
+               "kstat [reset]       - Show or reset hypervisor exit stats\n"
+               "prof [start <us> | stop]\n"
+               "                    - Show the profile of the target vm,\n"
+               "                      start sampling every <us> or stop\n"
+               "probe [reset]       - Show or reset hypervisor probe costs\n"
                "exit                - exit monitoring mode\n");
 }
 
@@ -212,6 +255,69 @@ static void monitoring_dump_memory(char **argv, int argc)
     *base_memory_dump;
 }
 
+static void monitoring_irq_stats(char **argv, int argc)
+{
+    if (argc == 1) {
+        *base_irq_stats;
+    } else if (argc == 2 && strcmp(argv[1], "reset") == 0) {
+        printh("Reset interrupt latency stats\n");
+        *base_irq_stats_reset;
+    } else
+        monitoring_help();
+}
+
+static void monitoring_irq_coalesce(char **argv, int argc)
+{
+    /* struct irq_coalesce_param of the hypervisor */
+    volatile uint32_t *param = (uint32_t *)(&shared_memory_start) + (0x100/4);
+    int i;
+
+    if (argc != 6) {
+        monitoring_help();
+        return;
+    }
+    for (i = 0; i < 5; i++)
+        param[i] = arm_str2int(argv[i + 1]);
+    *base_irq_coalesce = 0;
+}
+
+static void monitoring_exit_stats(char **argv, int argc)
+{
+    if (argc == 1) {
+        *base_exit_stats;
+    } else if (argc == 2 && strcmp(argv[1], "reset") == 0) {
+        printh("Reset hypervisor exit stats\n");
+        *base_exit_stats_reset;
+    } else
+        monitoring_help();
+}
+
+static void monitoring_probe(char **argv, int argc)
+{
+    if (argc == 1) {
+        *base_probe;
+    } else if (argc == 2 && strcmp(argv[1], "reset") == 0) {
+        printh("Reset hypervisor probes\n");
+        *base_probe_reset;
+    } else
+        monitoring_help();
+}
+
+static void monitoring_profile(char **argv, int argc)
+{
+    if (argc == 1) {
+        *base_profile;
+    } else if (argc == 3 && strcmp(argv[1], "start") == 0) {
+        printh("Start sampling every %d us\n", arm_str2int(argv[2]));
+        profile_reset();
+        *base_profile_set = arm_str2int(argv[2]);
+    } else if (argc == 2 && strcmp(argv[1], "stop") == 0) {
+        printh("Stop sampling\n");
+        *base_profile_set = 0;
+    } else
+        monitoring_help();
+}
+
 static enum monitoring_cmd_type convert_to_monitoring_cmd_type(char *input_cmd)
 {
     int i;
@@ -310,6 +416,24 @@ int monitoring_cmd(void)
         case MONITORING_STOP:
             monitoring_stop();
             break;
+        case MONITORING_IRQ_STATS:
+            monitoring_irq_stats(argv, argc);
+            break;
+        case MONITORING_IRQ_COALESCE:
+            monitoring_irq_coalesce(argv, argc);
+            break;
+        case MONITORING_TRACE:
+            *base_trace;
+            break;
+        case MONITORING_EXIT_STATS:
+            monitoring_exit_stats(argv, argc);
+            break;
+        case MONITORING_PROFILE:
+            monitoring_profile(argv, argc);
+            break;
+        case MONITORING_PROBE:
+            monitoring_probe(argv, argc);
+            break;
         }
     }
     return 0;
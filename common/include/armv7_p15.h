@@ -19,6 +19,11 @@
 #define HCR_IMO     0x10
 #define HCR_VI      (0x1 << 7)
 
+#define HDCR_HPMN_MASK  0x1F
+#define HDCR_TPMCR      (0x1 << 5)
+#define HDCR_TPM        (0x1 << 6)
+#define HDCR_HPME       (0x1 << 7)
+
 /* 32bit case only */
 #define read_ttbr0()            ({ uint32_t rval; asm volatile(\
                                 " mrc     p15, 0, %0, c2, c0, 0\n\t" \
@@ -139,6 +144,14 @@
                                 " mcr     p15, 4, %0, c1, c1, 0\n\t" \
                                 : : "r" ((val)) : "memory", "cc")
 
+#define read_hdcr()             ({ uint32_t rval; asm volatile(\
+                                " mrc     p15, 4, %0, c1, c1, 1\n\t" \
+                                : "=r" (rval) : : "memory", "cc"); rval; })
+
+#define write_hdcr(val)         asm volatile(\
+                                " mcr     p15, 4, %0, c1, c1, 1\n\t" \
+                                : : "r" ((val)) : "memory", "cc")
+
 #define read_midr()              ({ uint32_t rval; asm volatile(\
                                 " mrc     p15, 0, %0, c0, c0, 0\n\t" \
                                 : "=r" (rval) : : "memory", "cc"); rval; })
@@ -303,12 +316,140 @@
                                 " mcr     p15, 4, %0, c6, c0, 4\n\t" \
                                 : : "r" ((val)) : "memory", "cc")
 
+/* Performance Monitors */
+
+#define read_pmcr()             ({ uint32_t rval; asm volatile(\
+                                " mrc     p15, 0, %0, c9, c12, 0\n\t" \
+                                : "=r" (rval) : : "memory", "cc"); rval; })
+
+#define write_pmcr(val)         asm volatile(\
+                                " mcr     p15, 0, %0, c9, c12, 0\n\t" \
+                                : : "r" ((val)) : "memory", "cc")
+
+#define read_pmcntenset()       ({ uint32_t rval; asm volatile(\
+                                " mrc     p15, 0, %0, c9, c12, 1\n\t" \
+                                : "=r" (rval) : : "memory", "cc"); rval; })
+
+#define write_pmcntenset(val)   asm volatile(\
+                                " mcr     p15, 0, %0, c9, c12, 1\n\t" \
+                                : : "r" ((val)) : "memory", "cc")
+
+#define read_pmcntenclr()       ({ uint32_t rval; asm volatile(\
+                                " mrc     p15, 0, %0, c9, c12, 2\n\t" \
+                                : "=r" (rval) : : "memory", "cc"); rval; })
+
+#define write_pmcntenclr(val)   asm volatile(\
+                                " mcr     p15, 0, %0, c9, c12, 2\n\t" \
+                                : : "r" ((val)) : "memory", "cc")
+
+#define read_pmovsr()           ({ uint32_t rval; asm volatile(\
+                                " mrc     p15, 0, %0, c9, c12, 3\n\t" \
+                                : "=r" (rval) : : "memory", "cc"); rval; })
+
+#define write_pmovsr(val)       asm volatile(\
+                                " mcr     p15, 0, %0, c9, c12, 3\n\t" \
+                                : : "r" ((val)) : "memory", "cc")
+
+#define write_pmswinc(val)      asm volatile(\
+                                " mcr     p15, 0, %0, c9, c12, 4\n\t" \
+                                : : "r" ((val)) : "memory", "cc")
+
+#define read_pmselr()           ({ uint32_t rval; asm volatile(\
+                                " mrc     p15, 0, %0, c9, c12, 5\n\t" \
+                                : "=r" (rval) : : "memory", "cc"); rval; })
+
+#define write_pmselr(val)       asm volatile(\
+                                " mcr     p15, 0, %0, c9, c12, 5\n\t" \
+                                : : "r" ((val)) : "memory", "cc")
+
+#define read_pmceid0()          ({ uint32_t rval; asm volatile(\
+                                " mrc     p15, 0, %0, c9, c12, 6\n\t" \
+                                : "=r" (rval) : : "memory", "cc"); rval; })
+
+#define read_pmceid1()          ({ uint32_t rval; asm volatile(\
+                                " mrc     p15, 0, %0, c9, c12, 7\n\t" \
+                                : "=r" (rval) : : "memory", "cc"); rval; })
+
+#define read_pmccntr()          ({ uint32_t rval; asm volatile(\
+                                " mrc     p15, 0, %0, c9, c13, 0\n\t" \
+                                : "=r" (rval) : : "memory", "cc"); rval; })
+
+#define write_pmccntr(val)      asm volatile(\
+                                " mcr     p15, 0, %0, c9, c13, 0\n\t" \
+                                : : "r" ((val)) : "memory", "cc")
+
+#define read_pmxevtyper()       ({ uint32_t rval; asm volatile(\
+                                " mrc     p15, 0, %0, c9, c13, 1\n\t" \
+                                : "=r" (rval) : : "memory", "cc"); rval; })
+
+#define write_pmxevtyper(val)   asm volatile(\
+                                " mcr     p15, 0, %0, c9, c13, 1\n\t" \
+                                : : "r" ((val)) : "memory", "cc")
+
+#define read_pmxevcntr()        ({ uint32_t rval; asm volatile(\
+                                " mrc     p15, 0, %0, c9, c13, 2\n\t" \
+                                : "=r" (rval) : : "memory", "cc"); rval; })
+
+#define write_pmxevcntr(val)    asm volatile(\
+                                " mcr     p15, 0, %0, c9, c13, 2\n\t" \
+                                : : "r" ((val)) : "memory", "cc")
+
+#define read_pmuserenr()        ({ uint32_t rval; asm volatile(\
+                                " mrc     p15, 0, %0, c9, c14, 0\n\t" \
+                                : "=r" (rval) : : "memory", "cc"); rval; })
+
+#define write_pmuserenr(val)    asm volatile(\
+                                " mcr     p15, 0, %0, c9, c14, 0\n\t" \
+                                : : "r" ((val)) : "memory", "cc")
+
+#define read_pmintenset()       ({ uint32_t rval; asm volatile(\
+                                " mrc     p15, 0, %0, c9, c14, 1\n\t" \
+                                : "=r" (rval) : : "memory", "cc"); rval; })
+
+#define write_pmintenset(val)   asm volatile(\
+                                " mcr     p15, 0, %0, c9, c14, 1\n\t" \
+                                : : "r" ((val)) : "memory", "cc")
+
+#define read_pmintenclr()       ({ uint32_t rval; asm volatile(\
+                                " mrc     p15, 0, %0, c9, c14, 2\n\t" \
+                                : "=r" (rval) : : "memory", "cc"); rval; })
+
+#define write_pmintenclr(val)   asm volatile(\
+                                " mcr     p15, 0, %0, c9, c14, 2\n\t" \
+                                : : "r" ((val)) : "memory", "cc")
+
+#define read_pmovsset()         ({ uint32_t rval; asm volatile(\
+                                " mrc     p15, 0, %0, c9, c14, 3\n\t" \
+                                : "=r" (rval) : : "memory", "cc"); rval; })
+
+#define write_pmovsset(val)     asm volatile(\
+                                " mcr     p15, 0, %0, c9, c14, 3\n\t" \
+                                : : "r" ((val)) : "memory", "cc")
+
+/* Address translation operations */
+
+/* Stage 1 and 2 translation of a Non-secure PL1 read, result in PAR */
+#define write_ats12nsopr(va)    asm volatile(\
+                                " mcr     p15, 0, %0, c7, c8, 4\n\t" \
+                                " isb\n\t" \
+                                : : "r" ((va)) : "memory", "cc")
+
+#define read_par64()            ({ uint32_t v1, v2; asm volatile(\
+                                " mrrc     p15, 0, %0, %1, c7\n\t" \
+                                : "=r" (v1), "=r" (v2) : : "memory", "cc"); \
+                                (((uint64_t)v2 << 32) + (uint64_t)v1); })
+
 /* TLB maintenance operations */
 
 /* Invalidate entire unified TLB */
 #define invalidate_unified_tlb(val)      asm volatile(\
                 " mcr     p15, 0, %0, c8, c7, 0\n\t" \
                 : : "r" ((val)) : "memory", "cc")
+
+/* Invalidate non-secure non-hyp TLB entries, Inner Shareable */
+#define invalidate_nsnh_tlb_is(val)      asm volatile(\
+                " mcr     p15, 4, %0, c8, c3, 4\n\t" \
+                : : "r" ((val)) : "memory", "cc")
 #endif
 
 
@@ -35,6 +35,7 @@
 #define GICD_OFFSET_ISPENDR    0x200
 #define GICD_OFFSET_ICPENDR    0x280
 #define GICD_OFFSET_ISCACTIVER    0x300
+#define GICD_OFFSET_ICACTIVER    0x380
 #define GICD_OFFSET_IPRIORITYR    0x400
 #define GICD_OFFSET_ITARGETSR    0x800
 #define GICD_OFFSET_ICFGR    0xC00
@@ -28,6 +28,4 @@
 #define HVMM_TRACE_HEX32(label, value)
 #endif
 
-#define hyp_abort_infinite() { while (1) ; }
-
 #endif
@@ -0,0 +1,164 @@
+#ifndef __IVC_RING_H__
+#define __IVC_RING_H__
+
+#include <arch_types.h>
+#include <asm-arm_inline.h>
+
+/**
+ * @brief   Layout of an inter-VM channel, shared by the hypervisor and the
+ *          two guests of the channel.
+ *
+ * Channel 'id' is mapped at IVC_CHANNEL_IPA(id) in both guests and its
+ * doorbell is virq IVC_CHANNEL_VIRQ(id). The first page holds the channel
+ * header, the data areas of the two rings follow it. Each ring has a
+ * single producer and a single consumer:
+ * - ring[IVC_RING_A_TO_B] is written by the first guest of the channel.
+ * - ring[IVC_RING_B_TO_A] is written by the second guest.
+ *
+ * A consumer that polls its ring sets 'polling', the producer then skips
+ * the doorbell hypercall. Before waiting for the doorbell the consumer
+ * clears 'polling' and checks the ring once more.
+ */
+#define IVC_IPA_BASE            0x40000000
+#define IVC_CHANNEL_WINDOW      0x00200000
+#define IVC_CHANNEL_IPA(id)     (IVC_IPA_BASE + (id) * IVC_CHANNEL_WINDOW)
+#define IVC_VIRQ_BASE           76
+#define IVC_CHANNEL_VIRQ(id)    (IVC_VIRQ_BASE + (id))
+
+/** HVC immediate of the doorbell, r0 is the channel id */
+#define IVC_HVC_IMM_DOORBELL    0xFFFB
+
+#define IVC_MAGIC               0x4B495643
+#define IVC_HEADER_SIZE         0x1000
+#define IVC_CACHE_LINE          64
+
+#define IVC_RING_A_TO_B         0
+#define IVC_RING_B_TO_A         1
+
+/* Indices are free running, one cache line each to avoid false sharing */
+struct ivc_ring {
+    /** Written by the producer */
+    volatile uint32_t head;
+    uint8_t pad0[IVC_CACHE_LINE - 4];
+    /** Written by the consumer */
+    volatile uint32_t tail;
+    volatile uint32_t polling;
+    uint8_t pad1[IVC_CACHE_LINE - 8];
+};
+
+struct ivc_shared {
+    uint32_t magic;
+    uint32_t id;
+    /** Bytes of the data area of each ring, a power of 2 */
+    uint32_t ring_size;
+    uint8_t pad[IVC_CACHE_LINE - 12];
+    struct ivc_ring ring[2];
+};
+
+static inline uint32_t *ivc_ring_data(struct ivc_shared *shm, uint32_t ring)
+{
+    return (uint32_t *)((uint8_t *)shm + IVC_HEADER_SIZE +
+            ring * shm->ring_size);
+}
+
+/* A message is a length word followed by the payload, padded to words */
+static inline uint32_t ivc_msg_words(uint32_t len)
+{
+    return 1 + ((len + 3) >> 2);
+}
+
+/**
+ * @brief   Appends a message of 'len' bytes to 'ring'.
+ * @return  0, or -1 if the ring has no room for it.
+ */
+static inline int ivc_ring_write(struct ivc_shared *shm, uint32_t ring,
+        const void *msg, uint32_t len)
+{
+    struct ivc_ring *r = &shm->ring[ring];
+    uint32_t *data = ivc_ring_data(shm, ring);
+    uint32_t mask = (shm->ring_size >> 2) - 1;
+    uint32_t words = ivc_msg_words(len);
+    uint32_t head = r->head;
+    const uint8_t *src = msg;
+    uint32_t w, i, n;
+
+    if (words > (shm->ring_size >> 2) - ((head - r->tail) >> 2))
+        return -1;
+
+    data[(head >> 2) & mask] = len;
+    for (i = 1; i < words; i++, len -= n) {
+        n = len < 4 ? len : 4;
+        w = src[0];
+        if (n > 1)
+            w |= src[1] << 8;
+        if (n > 2)
+            w |= src[2] << 16;
+        if (n > 3)
+            w |= src[3] << 24;
+        data[((head >> 2) + i) & mask] = w;
+        src += n;
+    }
+
+    /* Publish the message before the index */
+    dmb();
+    r->head = head + (words << 2);
+
+    return 0;
+}
+
+/**
+ * @brief   Takes the next message of 'ring' into 'buf'.
+ * @return  Length of the message, 0 if the ring is empty, -1 if 'buf' is
+ *          smaller than the message, which is then left in the ring.
+ */
+static inline int ivc_ring_read(struct ivc_shared *shm, uint32_t ring,
+        void *buf, uint32_t size)
+{
+    struct ivc_ring *r = &shm->ring[ring];
+    uint32_t *data = ivc_ring_data(shm, ring);
+    uint32_t mask = (shm->ring_size >> 2) - 1;
+    uint32_t tail = r->tail;
+    uint8_t *dst = buf;
+    uint32_t len, left, w, i, n;
+
+    if (tail == r->head)
+        return 0;
+
+    /* Read the message after the index */
+    dmb();
+    len = data[(tail >> 2) & mask];
+    if (len > size)
+        return -1;
+
+    for (i = 1, left = len; left; i++, left -= n) {
+        n = left < 4 ? left : 4;
+        w = data[((tail >> 2) + i) & mask];
+        dst[0] = w;
+        if (n > 1)
+            dst[1] = w >> 8;
+        if (n > 2)
+            dst[2] = w >> 16;
+        if (n > 3)
+            dst[3] = w >> 24;
+        dst += n;
+    }
+
+    /* Release the slots after they are read */
+    dmb();
+    r->tail = tail + (ivc_msg_words(len) << 2);
+
+    return len;
+}
+
+/**
+ * @brief   Tells the producer of 'ring' whether the consumer must be woken
+ *          by the doorbell after a write.
+ */
+static inline int ivc_ring_need_doorbell(struct ivc_shared *shm, uint32_t ring)
+{
+    /* Order the published index before reading the consumer's state */
+    dmb();
+    return !shm->ring[ring].polling;
+}
+
+#endif
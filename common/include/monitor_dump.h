@@ -0,0 +1,149 @@
+#ifndef __MONITOR_DUMP_H__
+#define __MONITOR_DUMP_H__
+
+#include <arch_types.h>
+
+/**
+ * @brief   Dumps of the hypervisor statistics, shared by the hypervisor
+ *          and the guest monitor that decodes them.
+ *
+ * The hypervisor writes a dump as 32-bit words at the dump area of the
+ * monitor shared memory. Every dump below documents its layout, the
+ * *_NAMES initializers give the name of each enum value in order.
+ */
+
+/*
+ * Interrupt statistics, see the hypervisor's interrupt_stats.h.
+ * Latencies are kept in log2 histograms of counter ticks, bucket n
+ * counts latencies in [2^n, 2^(n+1)).
+ */
+#define IRQ_STATS_BUCKETS       32
+
+enum irq_stats_stage {
+    IRQ_STATS_ARRIVAL_TO_INJECT = 0,
+    IRQ_STATS_INJECT_TO_EOI,
+    IRQ_STATS_NUM_STAGES
+};
+
+#define IRQ_STATS_STAGE_NAMES   { "arrival->inject", "inject->eoi" }
+
+/*
+ * Layout of the dump written by irq_stats_dump():
+ *  [0] elapsed ticks since the last reset
+ *  [1] ticks per usec
+ *  [2] number of guests (G)
+ *  [3] number of buckets (B)
+ *  G times: injected, eoi, dropped, hist[IRQ_STATS_NUM_STAGES][B]
+ *  [n] number of pirq records (P)
+ *  P times: pirq, arrived, injected, max arrival to inject latency
+ */
+#define IRQ_STATS_HEADER_WORDS  4
+#define IRQ_STATS_GUEST_COUNTERS 3
+#define IRQ_STATS_GUEST_WORDS   \
+    (IRQ_STATS_GUEST_COUNTERS + IRQ_STATS_NUM_STAGES * IRQ_STATS_BUCKETS)
+#define IRQ_STATS_PIRQ_WORDS    4
+
+/* Trace events, see the hypervisor's trace.h */
+enum trace_event_id {
+    TRACE_EV_GUEST_SWITCH = 0,  /* from vmid, to vmid */
+    TRACE_EV_GUEST_SAVE,        /* vmid, cpsr, pc */
+    TRACE_EV_TRAP,              /* ec, iss, pc */
+    TRACE_EV_IRQ,               /* pirq */
+    TRACE_EV_VIRQ_QUEUE,        /* vmid, virq, pirq */
+    TRACE_EV_VIRQ_INJECT,       /* vmid, number of virqs */
+    TRACE_EV_VIRQ_EOI,          /* vmid, slot, pirq */
+    TRACE_EV_NUM
+};
+
+#define TRACE_EV_NAMES \
+    { "switch", "save", "trap", "irq", "queue", "inject", "eoi" }
+
+struct trace_record {
+    uint64_t stamp;             /* CNTPCT */
+    uint16_t event;
+    uint16_t cpu;
+    uint32_t arg[3];
+};
+
+#define TRACE_RECORD_WORDS      (sizeof(struct trace_record) / 4)
+
+/*
+ * Layout of the dump written by trace_drain():
+ *  [0] ticks per usec
+ *  [1] number of records (R)
+ *  [2] records lost by overwrite since the last drain
+ *  R times: struct trace_record, in order of each cpu
+ */
+#define TRACE_DUMP_HEADER_WORDS 3
+
+/* Exit classes, see the hypervisor's exit_stats.h */
+enum exit_stats_class {
+    EXIT_STATS_EC = 0,          /* index: HSR.EC */
+    EXIT_STATS_IRQ,             /* index: 0 */
+    EXIT_STATS_SWITCH,          /* index: 0, save and restore of a switch */
+    EXIT_STATS_HVC,             /* index: HVC immediate, 0 or 0xFFF0-0xFFFF */
+    EXIT_STATS_VDEV_LOW,        /* index: module, VDEV_LEVEL_LOW */
+    EXIT_STATS_VDEV_MIDDLE,     /* index: module, VDEV_LEVEL_MIDDLE */
+    EXIT_STATS_VDEV_HIGH,       /* index: module, VDEV_LEVEL_HIGH */
+    EXIT_STATS_NUM_CLASSES
+};
+
+#define EXIT_STATS_CLASS_NAMES \
+    { "ec", "irq", "switch", "hvc", "vdev low", "vdev middle", "vdev high" }
+
+/*
+ * Layout of the dump written by exit_stats_dump():
+ *  [0] elapsed usec since the last reset
+ *  [1] number of records (R)
+ *  R times: vmid << 24 | class << 16 | index, exits, usec
+ * Counters that never moved are omitted.
+ */
+#define EXIT_STATS_HEADER_WORDS 2
+#define EXIT_STATS_RECORD_WORDS 3
+
+/*
+ * Layout of the dump written by profile_drain(), see the hypervisor's
+ * profile.h:
+ *  [0] number of samples (S)
+ *  [1] samples dropped on full buffers since the last drain
+ *  S times: pc, cpu << 16 | vmid << 8 | cpsr mode
+ */
+#define PROFILE_DUMP_HEADER_WORDS   2
+#define PROFILE_SAMPLE_WORDS        2
+
+/* Probe sites, see the hypervisor's probe.h */
+enum probe_site {
+    PROBE_GUEST_SAVE = 0,
+    PROBE_MEMORY_SAVE,
+    PROBE_INTERRUPT_SAVE,
+    PROBE_VDEV_SAVE,
+    PROBE_VDEV_RESTORE,
+    PROBE_INTERRUPT_RESTORE,
+    PROBE_MEMORY_RESTORE,
+    PROBE_GUEST_RESTORE,
+    PROBE_VDEV_FIND,
+    PROBE_VDEV_READ,
+    PROBE_VDEV_WRITE,
+    PROBE_VDEV_POST,
+    PROBE_NUM_SITES
+};
+
+#define PROBE_SITE_NAMES                                            \
+    {                                                               \
+        "guest_save", "memory_save", "interrupt_save", "vdev_save", \
+        "vdev_restore", "interrupt_restore", "memory_restore",      \
+        "guest_restore", "vdev_find", "vdev_read", "vdev_write",    \
+        "vdev_post"                                                 \
+    }
+
+/*
+ * Layout of the dump written by probe_dump():
+ *  [0] ticks per usec
+ *  [1] number of records (R)
+ *  R times: cpu << 16 | site, count, min, avg, max (ticks)
+ * Sites that were never hit are omitted.
+ */
+#define PROBE_HEADER_WORDS  2
+#define PROBE_RECORD_WORDS  5
+
+#endif
@@ -0,0 +1,83 @@
+#ifndef __PVCON_RING_H__
+#define __PVCON_RING_H__
+
+#include <arch_types.h>
+#include <asm-arm_inline.h>
+
+/**
+ * @brief   Paravirtual console shared by a guest and the hypervisor.
+ *
+ * Every guest has its own console mapped at PVCON_IPA: a header page and
+ * a byte ring of PVCON_BUF_SIZE. The guest produces, the hypervisor
+ * consumes. The guest kicks with HVC #PVCON_HVC_IMM only when the ring
+ * goes non-empty, i.e. when 'kicked' is clear. The hypervisor drains
+ * kicked consoles about a millisecond after the kick, or when the guest
+ * is switched out, then clears 'kicked'. A guest that finds the ring full, or must not
+ * lose output (panic), kicks with PVCON_FLUSH to have it drained at once.
+ */
+#define PVCON_IPA               0x41000000
+#define PVCON_HEADER_SIZE       0x1000
+#define PVCON_BUF_SIZE          0x1000
+#define PVCON_SIZE              (PVCON_HEADER_SIZE + PVCON_BUF_SIZE)
+
+/** HVC immediate of the kick, r0 is PVCON_KICK or PVCON_FLUSH */
+#define PVCON_HVC_IMM           0xFFFA
+#define PVCON_KICK              0
+#define PVCON_FLUSH             1
+
+#define PVCON_CACHE_LINE        64
+
+struct pvcon_shared {
+    /** Written by the guest, free running */
+    volatile uint32_t head;
+    /** Set by the guest when it kicks, cleared by the hypervisor */
+    volatile uint32_t kicked;
+    uint8_t pad0[PVCON_CACHE_LINE - 8];
+    /** Written by the hypervisor, free running */
+    volatile uint32_t tail;
+    uint8_t pad1[PVCON_CACHE_LINE - 4];
+};
+
+static inline char *pvcon_buf(struct pvcon_shared *shm)
+{
+    return (char *)shm + PVCON_HEADER_SIZE;
+}
+
+static inline void pvcon_kick(uint32_t op)
+{
+    register uint32_t r0 asm("r0") = op;
+
+    asm volatile("hvc #0xFFFA" : "+r" (r0) : : "memory");
+}
+
+/**
+ * @brief   Writes 'len' bytes to the console, for the guest. Blocks on a
+ *          full ring by having the hypervisor drain it.
+ */
+static inline void pvcon_write(struct pvcon_shared *shm, const char *s,
+        uint32_t len)
+{
+    char *buf = pvcon_buf(shm);
+    uint32_t head = shm->head;
+    uint32_t i;
+
+    for (i = 0; i < len; i++) {
+        if (head - shm->tail == PVCON_BUF_SIZE) {
+            dmb();
+            shm->head = head;
+            pvcon_kick(PVCON_FLUSH);
+        }
+        buf[head % PVCON_BUF_SIZE] = s[i];
+        head++;
+    }
+
+    /* Publish the bytes before the index */
+    dmb();
+    shm->head = head;
+    if (!shm->kicked) {
+        shm->kicked = 1;
+        pvcon_kick(PVCON_KICK);
+    }
+}
+
+#endif
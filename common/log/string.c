@@ -1,8 +1,98 @@
 #include <string.h>
 
+/*
+ * memcpy, memmove, memset and memcmp work a word at a time once both
+ * pointers are word aligned, and copy or fill 32 bytes per LDM/STM burst.
+ * Buffers whose addresses differ modulo 4 take the byte loops: unaligned
+ * word accesses fault with the MMU off and on Device memory.
+ */
+
+/* Bytes per burst, 8 registers */
+#define STRING_BURST        32
+#define STRING_WORD_MASK    (sizeof(unsigned int) - 1)
+
+/* A word that may alias any object, the buffers are of any type */
+typedef unsigned int __attribute__((__may_alias__)) string_word_t;
+
+#define string_aligned(p)       (!((unsigned long)(p) & STRING_WORD_MASK))
+#define string_coaligned(a, b)  \
+    (!(((unsigned long)(a) ^ (unsigned long)(b)) & STRING_WORD_MASK))
+
+/* Copies 'n' bytes, a non-zero multiple of STRING_BURST, upwards */
+static void __copy_bursts(void *d, const void *s, size_t n)
+{
+#ifdef __arm__
+    asm volatile(
+            "1:     pld     [%1, #128]\n\t"
+            "       ldmia   %1!, {r3-r6, r8-r10, r12}\n\t"
+            "       stmia   %0!, {r3-r6, r8-r10, r12}\n\t"
+            "       subs    %2, %2, #32\n\t"
+            "       bne     1b\n\t"
+            : "+r" (d), "+r" (s), "+r" (n)
+            :
+            : "r3", "r4", "r5", "r6", "r8", "r9", "r10", "r12",
+              "memory", "cc");
+#else
+    string_word_t *wd = d;
+    const string_word_t *ws = s;
+
+    for (n /= sizeof(unsigned int); n; n--)
+        *wd++ = *ws++;
+#endif
+}
+
+/* Fills 'n' bytes, a non-zero multiple of STRING_BURST, with word 'v' */
+static void __set_bursts(void *d, unsigned int v, size_t n)
+{
+#ifdef __arm__
+    asm volatile(
+            "       mov     r3, %2\n\t"
+            "       mov     r4, %2\n\t"
+            "       mov     r5, %2\n\t"
+            "       mov     r6, %2\n\t"
+            "       mov     r8, %2\n\t"
+            "       mov     r9, %2\n\t"
+            "       mov     r10, %2\n\t"
+            "       mov     r12, %2\n\t"
+            "1:     stmia   %0!, {r3-r6, r8-r10, r12}\n\t"
+            "       subs    %1, %1, #32\n\t"
+            "       bne     1b\n\t"
+            : "+r" (d), "+r" (n)
+            : "r" (v)
+            : "r3", "r4", "r5", "r6", "r8", "r9", "r10", "r12",
+              "memory", "cc");
+#else
+    string_word_t *wd = d;
+
+    for (n /= sizeof(unsigned int); n; n--)
+        *wd++ = v;
+#endif
+}
+
+/* Also the forward memmove, safe when __dest is below __src */
 static void *__memmove_down(void *__dest, __const void *__src, size_t __n)
 {
     unsigned char *d = (unsigned char *)__dest, *s = (unsigned char *)__src;
+    size_t bulk;
+
+    if (string_coaligned(d, s)) {
+        while (__n && !string_aligned(d)) {
+            *d++ = *s++;
+            __n--;
+        }
+        bulk = __n & ~(STRING_BURST - 1);
+        if (bulk) {
+            __copy_bursts(d, s, bulk);
+            d += bulk;
+            s += bulk;
+            __n -= bulk;
+        }
+        for (; __n >= sizeof(unsigned int); __n -= sizeof(unsigned int)) {
+            *(string_word_t *)d = *(const string_word_t *)s;
+            d += sizeof(unsigned int);
+            s += sizeof(unsigned int);
+        }
+    }
     while (__n--)
         *d++ = *s++;
 
@@ -11,10 +101,22 @@ static void *__memmove_down(void *__dest, __const void *__src, size_t __n)
 
 static void *__memmove_up(void *__dest, __const void *__src, size_t __n)
 {
-    unsigned char *d = (unsigned char *)__dest + __n - 1, *s = \
-                       (unsigned char *)__src + __n - 1;
+    unsigned char *d = (unsigned char *)__dest + __n, *s = \
+                       (unsigned char *)__src + __n;
+
+    if (string_coaligned(d, s)) {
+        while (__n && !string_aligned(d)) {
+            *--d = *--s;
+            __n--;
+        }
+        for (; __n >= sizeof(unsigned int); __n -= sizeof(unsigned int)) {
+            d -= sizeof(unsigned int);
+            s -= sizeof(unsigned int);
+            *(string_word_t *)d = *(const string_word_t *)s;
+        }
+    }
     while (__n--)
-        *d-- = *s--;
+        *--d = *--s;
 
     return __dest;
 }
@@ -55,7 +157,26 @@ size_t (strlen)(const char *s)
 
 void *(memset)(void *s, int c, size_t count)
 {
-    char *xs = s;
+    unsigned char *xs = s;
+    unsigned int v = (unsigned char)c;
+    size_t bulk;
+
+    while (count && !string_aligned(xs)) {
+        *xs++ = c;
+        count--;
+    }
+    v |= v << 8;
+    v |= v << 16;
+    bulk = count & ~(STRING_BURST - 1);
+    if (bulk) {
+        __set_bursts(xs, v, bulk);
+        xs += bulk;
+        count -= bulk;
+    }
+    for (; count >= sizeof(unsigned int); count -= sizeof(unsigned int)) {
+        *(string_word_t *)xs = v;
+        xs += sizeof(unsigned int);
+    }
     while (count--)
         *xs++ = c;
     return s;
@@ -65,6 +186,24 @@ int (memcmp)(void const *p1, void const *p2, size_t n)
 {
     unsigned char const *_p1 = p1;
     unsigned char const *_p2 = p2;
+
+    /* Skip the equal words, the bytes below find the first difference */
+    if (string_coaligned(_p1, _p2)) {
+        while (n && !string_aligned(_p1) && *_p1 == *_p2) {
+            ++_p1;
+            ++_p2;
+            n--;
+        }
+        if (string_aligned(_p1)) {
+            while (n >= sizeof(unsigned int) &&
+                    *(string_word_t const *)_p1 ==
+                    *(string_word_t const *)_p2) {
+                _p1 += sizeof(unsigned int);
+                _p2 += sizeof(unsigned int);
+                n -= sizeof(unsigned int);
+            }
+        }
+    }
     while (n--) {
         if (*_p1 < *_p2)
             return -1;
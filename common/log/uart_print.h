@@ -7,6 +7,16 @@
  */
 void uart_putc(const char c);
 
+/** @brief Checks whether the TX FIFO of the uart is full.
+ *  @return 1 if a character written now would be lost, otherwise 0.
+ */
+int uart_tx_full(void);
+
+/** @brief Writes a character to the TX FIFO without waiting for room.
+ *  @param c Character for print.
+ */
+void uart_tx(const char c);
+
 /** @brief Writes the C string pointed by str to the uart.
  *  @param v Strints for print.
  */
@@ -2,6 +2,7 @@
 #include "tests_gic_timer.h"
 #include "tests_vdev.h"
 #include "tests_malloc.h"
+#include "tests_string.h"
 
 hvmm_status_t basic_tests_run(uint32_t tests)
 {
@@ -10,6 +11,9 @@ hvmm_status_t basic_tests_run(uint32_t tests)
     if (tests & TESTS_ENABLE_MALLOC)
         result = hvmm_tests_malloc();
 
+    if (tests & TESTS_ENABLE_STRING)
+        result = hvmm_tests_string();
+
     if (tests & TESTS_ENABLE_GIC_TIMER)
         result = hvmm_tests_gic_timer();
 
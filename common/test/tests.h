@@ -15,6 +15,7 @@
 #define TESTS_ENABLE_VGIC               0x08
 #define TESTS_VDEV                      0x10
 #define TESTS_ENABLE_SP804              0x20
+#define TESTS_ENABLE_STRING             0x40
 
 hvmm_status_t basic_tests_run(uint32_t tests);
 
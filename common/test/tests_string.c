@@ -0,0 +1,176 @@
+#include "tests_string.h"
+#include "hvmm_trace.h"
+#include "memory.h"
+#include "armv7_p15.h"
+
+#include <k-hypervisor-config.h>
+#include <log/print.h>
+#include <log/string.h>
+
+#define TEST_BUF_SIZE       512
+/* Lengths around the word and burst boundaries of log/string.c */
+static const uint32_t test_lengths[] = {
+    0, 1, 3, 4, 5, 31, 32, 33, 63, 64, 65, 100, 255, 256, 300
+};
+#define NUM_TEST_LENGTHS    (sizeof(test_lengths) / sizeof(test_lengths[0]))
+
+#define BENCH_SIZE          (64 * 1024)
+#define BENCH_ROUNDS        16
+
+static uint8_t test_src[TEST_BUF_SIZE];
+static uint8_t test_dst[TEST_BUF_SIZE];
+static uint8_t test_ref[TEST_BUF_SIZE];
+
+static void test_fill(uint8_t *buf, uint32_t seed)
+{
+    int i;
+
+    for (i = 0; i < TEST_BUF_SIZE; i++) {
+        seed = seed * 1103515245 + 12345;
+        buf[i] = seed >> 16;
+    }
+}
+
+static int test_check(const char *name, uint32_t a, uint32_t b, uint32_t n)
+{
+    int i;
+
+    for (i = 0; i < TEST_BUF_SIZE; i++) {
+        if (test_dst[i] != test_ref[i]) {
+            printH("string test: %s failed, offsets %d %d length %d\n",
+                    name, a, b, n);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/* Every pair of alignments and every length, against byte loops */
+static int test_string_correctness(void)
+{
+    uint32_t a, b, l, n, i;
+    int sign;
+
+    test_fill(test_src, 1);
+    for (a = 0; a < 8; a++) {
+        for (b = 0; b < 8; b++) {
+            for (l = 0; l < NUM_TEST_LENGTHS; l++) {
+                n = test_lengths[l];
+
+                test_fill(test_dst, a + b);
+                test_fill(test_ref, a + b);
+                memcpy(test_dst + a, test_src + b, n);
+                for (i = 0; i < n; i++)
+                    test_ref[a + i] = test_src[b + i];
+                if (test_check("memcpy", a, b, n))
+                    return -1;
+
+                /* Overlapping, upwards then downwards */
+                test_fill(test_dst, 2);
+                test_fill(test_ref, 2);
+                memmove(test_dst + 64 + a, test_dst + 64 + b * 4, n);
+                for (i = 0; i < n; i++)
+                    test_src[i] = test_ref[64 + b * 4 + i];
+                for (i = 0; i < n; i++)
+                    test_ref[64 + a + i] = test_src[i];
+                test_fill(test_src, 1);
+                if (test_check("memmove", a, b * 4, n))
+                    return -1;
+
+                test_fill(test_dst, 3);
+                test_fill(test_ref, 3);
+                memset(test_dst + a, 0xA0 + b, n);
+                for (i = 0; i < n; i++)
+                    test_ref[a + i] = 0xA0 + b;
+                if (test_check("memset", a, b, n))
+                    return -1;
+
+                /* Equal, then differing at the last byte */
+                memcpy(test_dst + a, test_src + b, n);
+                if (memcmp(test_dst + a, test_src + b, n)) {
+                    printH("string test: memcmp failed, offsets %d %d "
+                            "length %d\n", a, b, n);
+                    return -1;
+                }
+                if (!n)
+                    continue;
+                test_dst[a + n - 1] = test_src[b + n - 1] + 1;
+                sign = test_dst[a + n - 1] > test_src[b + n - 1] ? 1 : -1;
+                if (memcmp(test_dst + a, test_src + b, n) != sign) {
+                    printH("string test: memcmp failed, offsets %d %d "
+                            "length %d\n", a, b, n);
+                    return -1;
+                }
+            }
+        }
+    }
+
+    return 0;
+}
+
+static uint32_t bench_mb_per_sec(uint64_t ticks)
+{
+    uint32_t us = (uint32_t)ticks / COUNT_PER_USEC;
+
+    if (!us)
+        us = 1;
+
+    /* bytes per usec is MB/s */
+    return (BENCH_SIZE * BENCH_ROUNDS) / us;
+}
+
+/* Throughput of the aligned and the misaligned paths */
+static void test_string_benchmark(void)
+{
+    uint8_t *src = memory_alloc(BENCH_SIZE + 4);
+    uint8_t *dst = memory_alloc(BENCH_SIZE + 4);
+    uint64_t start;
+    int i;
+
+    if (!src || !dst) {
+        printH("string benchmark: no memory\n");
+        goto out;
+    }
+
+    start = read_cntpct();
+    for (i = 0; i < BENCH_ROUNDS; i++)
+        memcpy(dst, src, BENCH_SIZE);
+    printH("string benchmark: memcpy aligned %d MB/s\n",
+            bench_mb_per_sec(read_cntpct() - start));
+
+    start = read_cntpct();
+    for (i = 0; i < BENCH_ROUNDS; i++)
+        memcpy(dst + 1, src + 2, BENCH_SIZE);
+    printH("string benchmark: memcpy misaligned %d MB/s\n",
+            bench_mb_per_sec(read_cntpct() - start));
+
+    start = read_cntpct();
+    for (i = 0; i < BENCH_ROUNDS; i++)
+        memset(dst, i, BENCH_SIZE);
+    printH("string benchmark: memset %d MB/s\n",
+            bench_mb_per_sec(read_cntpct() - start));
+
+    start = read_cntpct();
+    for (i = 0; i < BENCH_ROUNDS; i++)
+        memcmp(dst, dst, BENCH_SIZE);
+    printH("string benchmark: memcmp %d MB/s\n",
+            bench_mb_per_sec(read_cntpct() - start));
+
+out:
+    if (src)
+        memory_free(src);
+    if (dst)
+        memory_free(dst);
+}
+
+hvmm_status_t hvmm_tests_string(void)
+{
+    HVMM_TRACE_ENTER();
+    if (test_string_correctness())
+        return HVMM_STATUS_UNKNOWN_ERROR;
+    printH("string test: passed\n");
+    test_string_benchmark();
+    HVMM_TRACE_EXIT();
+    return HVMM_STATUS_SUCCESS;
+}
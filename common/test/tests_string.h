@@ -0,0 +1,8 @@
+#ifndef __TESTS_STRING_H__
+#define __TESTS_STRING_H__
+
+#include <hvmm_types.h>
+
+hvmm_status_t hvmm_tests_string(void);
+
+#endif
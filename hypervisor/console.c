@@ -0,0 +1,97 @@
+/*
+ * console.c
+ * --------------------------------------
+ * Hypervisor console output buffered in a ring
+ */
+
+#include <console.h>
+#include <smp.h>
+#include <timer.h>
+#include <k-hypervisor-config.h>
+#include <log/uart_print.h>
+
+/* A power of 2 */
+#define CONSOLE_RING_SIZE   16384
+/* Time the UART takes to send about a TX FIFO */
+#define CONSOLE_DRAIN_US    1000
+
+static char _console_ring[CONSOLE_RING_SIZE];
+static uint32_t _console_head;
+static uint32_t _console_tail;
+static volatile uint32_t _console_buffered;
+static DEFINE_SPINLOCK(_console_lock);
+/* Armed on the cpus that left output in the ring */
+static struct timer_event _console_event[NUM_CPUS];
+
+/* Moves what the TX FIFO takes, never waits */
+static void console_drain_locked(void)
+{
+    while (_console_tail != _console_head && !uart_tx_full())
+        uart_tx(_console_ring[_console_tail++ & (CONSOLE_RING_SIZE - 1)]);
+}
+
+/* Moves one character, waiting for room in the TX FIFO */
+static void console_tx_one(void)
+{
+    while (uart_tx_full())
+        ;
+    uart_tx(_console_ring[_console_tail++ & (CONSOLE_RING_SIZE - 1)]);
+}
+
+void console_putc(const char c)
+{
+    if (!_console_buffered) {
+        while (uart_tx_full())
+            ;
+        uart_tx(c);
+        return;
+    }
+
+    spin_lock(&_console_lock);
+    /* A full ring costs what an unbuffered console would */
+    if (_console_head - _console_tail == CONSOLE_RING_SIZE)
+        console_tx_one();
+    _console_ring[_console_head++ & (CONSOLE_RING_SIZE - 1)] = c;
+    console_drain_locked();
+    if (_console_tail != _console_head)
+        timer_event_add(&_console_event[smp_processor_id()],
+                CONSOLE_DRAIN_US, CONSOLE_DRAIN_US);
+    spin_unlock(&_console_lock);
+}
+
+/* Tops up the TX FIFO from the ring until it is empty */
+static void console_drain(void *pregs, void *data)
+{
+    spin_lock(&_console_lock);
+    console_drain_locked();
+    if (_console_tail == _console_head)
+        timer_event_cancel(&_console_event[smp_processor_id()]);
+    spin_unlock(&_console_lock);
+}
+
+/**
+ * @brief   Writes out the whole ring and makes the console synchronous,
+ *          for the last words of hyp_abort_infinite(). Does not take the
+ *          lock, the cpu may have failed while holding it.
+ */
+void console_flush(void)
+{
+    _console_buffered = 0;
+    while (_console_tail != _console_head)
+        console_tx_one();
+}
+
+/**
+ * @brief   Starts buffering. Called once the hypervisor is up, the boot
+ *          messages are written synchronously.
+ */
+void console_init(void)
+{
+    int i;
+
+    for (i = 0; i < NUM_CPUS; i++)
+        timer_event_init(&_console_event[i], console_drain, 0);
+    _console_head = 0;
+    _console_tail = 0;
+    _console_buffered = 1;
+}
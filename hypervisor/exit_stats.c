@@ -0,0 +1,180 @@
+/*
+ * exit_stats.c
+ * --------------------------------------
+ * Counts and costs of the exits to the hypervisor
+ */
+
+#include <exit_stats.h>
+#include <timer.h>
+#include <vdev.h>
+#include <log/string.h>
+
+#define EXIT_STATS_ECS          64
+/* HVC immediate 0 and 0xFFF0 - 0xFFFF */
+#define EXIT_STATS_HVCS         17
+#define EXIT_STATS_HVC_BASE     0xFFF0
+/* Modules of each vdev level */
+#define EXIT_STATS_VDEVS        32
+
+struct exit_stats_counter {
+    uint32_t exits;
+    uint64_t ticks;
+};
+
+struct exit_stats_guest {
+    struct exit_stats_counter ec[EXIT_STATS_ECS];
+    struct exit_stats_counter irq;
+    struct exit_stats_counter sw;
+    struct exit_stats_counter hvc[EXIT_STATS_HVCS];
+    struct exit_stats_counter vdev[VDEV_LEVEL_MAX][EXIT_STATS_VDEVS];
+};
+
+/* A guest runs on a single cpu, its counters are never shared */
+static struct exit_stats_guest _exit_stats[NUM_GUESTS_STATIC];
+static uint64_t _reset_stamp;
+
+static inline void exit_stats_account(struct exit_stats_counter *counter,
+        uint32_t stamp)
+{
+    counter->exits++;
+    counter->ticks += timer_stamp() - stamp;
+}
+
+void exit_stats_trap(vcpuid_t vmid, uint32_t ec, uint32_t stamp)
+{
+    if (vmid >= NUM_GUESTS_STATIC || ec >= EXIT_STATS_ECS)
+        return;
+
+    exit_stats_account(&_exit_stats[vmid].ec[ec], stamp);
+}
+
+/**
+ * @brief   Accounts an HVC by its immediate. Immediates out of the
+ *          hypervisor's range are counted by their exception class only.
+ */
+void exit_stats_hvc(vcpuid_t vmid, uint32_t imm, uint32_t stamp)
+{
+    uint32_t slot;
+
+    if (vmid >= NUM_GUESTS_STATIC)
+        return;
+
+    if (imm == VDEV_HVC_IMM_SMCCC)
+        slot = 0;
+    else if (imm >= EXIT_STATS_HVC_BASE && imm <= 0xFFFF)
+        slot = 1 + imm - EXIT_STATS_HVC_BASE;
+    else
+        return;
+
+    exit_stats_account(&_exit_stats[vmid].hvc[slot], stamp);
+}
+
+void exit_stats_irq(vcpuid_t vmid, uint32_t stamp)
+{
+    if (vmid >= NUM_GUESTS_STATIC)
+        return;
+
+    exit_stats_account(&_exit_stats[vmid].irq, stamp);
+}
+
+/**
+ * @brief   Accounts a switch away from 'vmid'.
+ */
+void exit_stats_switch(vcpuid_t vmid, uint32_t stamp)
+{
+    if (vmid >= NUM_GUESTS_STATIC)
+        return;
+
+    exit_stats_account(&_exit_stats[vmid].sw, stamp);
+}
+
+/**
+ * @brief   Accounts an access served by module 'num' of vdev 'level'.
+ */
+void exit_stats_vdev(vcpuid_t vmid, int level, int num, uint32_t stamp)
+{
+    if (vmid >= NUM_GUESTS_STATIC || level < 0 || level >= VDEV_LEVEL_MAX ||
+            num < 0 || num >= EXIT_STATS_VDEVS)
+        return;
+
+    exit_stats_account(&_exit_stats[vmid].vdev[level][num], stamp);
+}
+
+void exit_stats_reset(void)
+{
+    memset(_exit_stats, 0, sizeof(_exit_stats));
+    _reset_stamp = get_timer_curcnt();
+}
+
+static uint32_t exit_stats_usec(uint64_t ticks)
+{
+    uint64_t us = timer_count_to_us(ticks);
+
+    return us > 0xFFFFFFFF ? 0xFFFFFFFF : (uint32_t)us;
+}
+
+struct exit_stats_dump {
+    uint32_t *buf;
+    uint32_t max_words;
+    uint32_t n;
+    uint32_t records;
+};
+
+/* Appends the record of 'counter' unless it is empty or 'buf' is full */
+static void exit_stats_record(struct exit_stats_dump *dump, vcpuid_t vmid,
+        uint32_t class, uint32_t index, struct exit_stats_counter *counter)
+{
+    uint32_t *buf = &dump->buf[dump->n];
+
+    if (!counter->exits ||
+            dump->n + EXIT_STATS_RECORD_WORDS > dump->max_words)
+        return;
+
+    buf[0] = (vmid << 24) | (class << 16) | index;
+    buf[1] = counter->exits;
+    buf[2] = exit_stats_usec(counter->ticks);
+    dump->n += EXIT_STATS_RECORD_WORDS;
+    dump->records++;
+}
+
+/**
+ * @brief   Serializes a snapshot of the statistics into 'buf', see
+ *          exit_stats.h for the layout.
+ * @return  Number of words written.
+ */
+uint32_t exit_stats_dump(uint32_t *buf, uint32_t max_words)
+{
+    struct exit_stats_dump dump;
+    struct exit_stats_guest *stats;
+    int i, j, k;
+
+    if (max_words < EXIT_STATS_HEADER_WORDS)
+        return 0;
+
+    dump.buf = buf;
+    dump.max_words = max_words;
+    dump.n = EXIT_STATS_HEADER_WORDS;
+    dump.records = 0;
+
+    for (i = 0; i < NUM_GUESTS_STATIC; i++) {
+        stats = &_exit_stats[i];
+        for (j = 0; j < EXIT_STATS_ECS; j++)
+            exit_stats_record(&dump, i, EXIT_STATS_EC, j, &stats->ec[j]);
+        exit_stats_record(&dump, i, EXIT_STATS_IRQ, 0, &stats->irq);
+        exit_stats_record(&dump, i, EXIT_STATS_SWITCH, 0, &stats->sw);
+        exit_stats_record(&dump, i, EXIT_STATS_HVC, VDEV_HVC_IMM_SMCCC,
+                &stats->hvc[0]);
+        for (j = 1; j < EXIT_STATS_HVCS; j++)
+            exit_stats_record(&dump, i, EXIT_STATS_HVC,
+                    EXIT_STATS_HVC_BASE + j - 1, &stats->hvc[j]);
+        for (j = 0; j < VDEV_LEVEL_MAX; j++)
+            for (k = 0; k < EXIT_STATS_VDEVS; k++)
+                exit_stats_record(&dump, i, EXIT_STATS_VDEV_LOW + j, k,
+                        &stats->vdev[j][k]);
+    }
+
+    buf[0] = exit_stats_usec(get_timer_curcnt() - _reset_stamp);
+    buf[1] = dump.records;
+
+    return dump.n;
+}
@@ -3,6 +3,8 @@
 #include <hvmm_trace.h>
 #include <vcpu.h>
 #include <guest_hw.h>
+#include <trap_mmio.h>
+#include <trace.h>
 
 #define CPSR_MODE_USER  0x10
 #define CPSR_MODE_FIQ   0x11
@@ -253,11 +255,7 @@ static hvmm_status_t guest_hw_save(struct vcpu *vcpu,
     context_copy_regs(regs, current_regs);
     context_save_cops(&context->regs_cop);
     context_save_banked(&context->regs_banked);
-    printh("guest_hw_save  context: saving vmid[%d] mode(%x):%s pc:0x%x\n",
-            _current_guest[0]->vmid,
-           regs->cpsr & 0x1F,
-           _modename(regs->cpsr & 0x1F),
-           regs->pc);
+    trace_event(TRACE_EV_GUEST_SAVE, vcpu->vmid, regs->cpsr, regs->pc);
 
     return HVMM_STATUS_SUCCESS;
 }
@@ -303,6 +301,8 @@ static hvmm_status_t guest_hw_init(struct vcpu *vcpu,
     vmpidr |= 0;
     vcpu->vmpidr = vmpidr;
 
+    trap_mmio_flush(vcpu->vmid);
+
     regs->pc = CFG_GUEST_START_ADDRESS;
     /* Initialize loader status for reboot */
     regs->gpr[10] = 0;
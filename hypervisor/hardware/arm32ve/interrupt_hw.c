@@ -46,6 +46,11 @@ static hvmm_status_t host_interrupt_configure(uint32_t irq)
             gic_cpumask_current(), GIC_INT_PRIORITY_DEFAULT);
 }
 
+static hvmm_status_t host_interrupt_set_target(uint32_t irq, uint8_t cpumask)
+{
+    return gic_set_irq_target(irq, cpumask);
+}
+
 static hvmm_status_t host_interrupt_end(uint32_t irq)
 {
     /* Completion & Deactivation */
@@ -80,6 +85,11 @@ static hvmm_status_t guest_interrupt_end(uint32_t irq)
     return gic_completion_irq(irq);
 }
 
+static hvmm_status_t guest_interrupt_deactivate(uint32_t irq)
+{
+    return gic_deactivate_irq(irq);
+}
+
 static hvmm_status_t guest_interrupt_inject(vcpuid_t vmid, uint32_t virq,
                         uint32_t pirq, uint8_t hw)
 {
@@ -89,7 +99,7 @@ static hvmm_status_t guest_interrupt_inject(vcpuid_t vmid, uint32_t virq,
 
 static hvmm_status_t guest_interrupt_save(vcpuid_t vmid)
 {
-    return vgic_save_status(&(vcpu_arr[vmid].status));
+    return vgic_save_status(&(vcpu_arr[vmid].status), vmid);
 }
 
 static hvmm_status_t guest_interrupt_restore(vcpuid_t vmid)
@@ -113,6 +123,7 @@ struct interrupt_ops _host_interrupt_ops = {
     .enable = host_interrupt_enable,
     .disable = host_interrupt_disable,
     .configure = host_interrupt_configure,
+    .set_target = host_interrupt_set_target,
     .end = host_interrupt_end,
     .dump = host_interrupt_dump,
     .sgi = host_sgi,
@@ -121,6 +132,7 @@ struct interrupt_ops _host_interrupt_ops = {
 struct interrupt_ops _guest_interrupt_ops = {
     .init = guest_interrupt_init,
     .end = guest_interrupt_end,
+    .deactivate = guest_interrupt_deactivate,
     .inject = guest_interrupt_inject,
     .save = guest_interrupt_save,
     .restore = guest_interrupt_restore,
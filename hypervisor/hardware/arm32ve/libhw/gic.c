@@ -359,6 +359,20 @@ hvmm_status_t gic_configure_irq(uint32_t irq,
 }
 
 
+hvmm_status_t gic_set_irq_target(uint32_t irq, uint8_t cpumask)
+{
+    volatile uint8_t *reg8;
+
+    /* SGIs and PPIs are private to each CPU interface */
+    if (irq < 32 || irq >= _gic.lines)
+        return HVMM_STATUS_BAD_ACCESS;
+
+    reg8 = (uint8_t *) &(_gic.ba_gicd[GICD_ITARGETSR]);
+    reg8[irq] = cpumask;
+
+    return HVMM_STATUS_SUCCESS;
+}
+
 uint32_t gic_get_irq_number(void)
 {
     /*
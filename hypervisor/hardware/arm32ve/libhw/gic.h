@@ -17,6 +17,7 @@ enum gic_int_polarity {
 
 enum gic_sgi {
     GIC_SGI_SLOT_CHECK = 1,
+    GIC_SGI_PROFILE = 2,
 };
 
 void gic_interrupt(int fiq, void *regs);
@@ -55,6 +56,15 @@ hvmm_status_t gic_configure_irq(uint32_t irq,
                 enum gic_int_polarity polarity, uint8_t cpumask,
                 uint8_t priority);
 
+/**
+ * @brief           Routes a shared peripheral interrupt.
+ * @param irq       Interrupt number, SPIs only.
+ * @param cpumask   Targets processor mask for the interrupt.
+ * @return  If irq is not a valid SPI then return "bad access",
+ *          otherwise return success.
+ */
+hvmm_status_t gic_set_irq_target(uint32_t irq, uint8_t cpumask);
+
 uint32_t gic_get_irq_number(void);
 
 /**
@@ -2,6 +2,7 @@
 #include <armv7_p15.h>
 #include <gic.h>
 #include <trap.h>
+#include <trap_mmio.h>
 #include <vcpu.h>
 #include <vdev.h>
 #include <smp.h>
@@ -9,6 +10,11 @@
 #define DEBUG
 #include <log/print.h>
 #include <interrupt.h>
+#include <trace.h>
+#include <console.h>
+#include <exit_stats.h>
+#include <timer.h>
+#include <probe.h>
 /**\defgroup ARM
  * <pre> ARM registers.
  * ARM registers include 13 general purpose registers r0-r12, 1 Stack Pointer,
@@ -36,10 +42,13 @@ hvmm_status_t _hyp_dabort(struct arch_regs *regs)
  */
 hvmm_status_t _hyp_irq(struct arch_regs *regs)
 {
+    uint32_t exit_stamp = timer_stamp();
+    vcpuid_t vmid = guest_current_vmid();
     uint32_t irq;
 
     irq = gic_get_irq_number();
     interrupt_service_routine(irq, (void *)regs, 0);
+    exit_stats_irq(vmid, exit_stamp);
     guest_perform_switch(regs);
     return HVMM_STATUS_SUCCESS;
 }
@@ -129,6 +138,8 @@ static void _trap_dump_bregs(void)
  */
 enum hyp_hvc_result _hyp_hvc_service(struct arch_regs *regs)
 {
+    uint32_t exit_stamp = timer_stamp();
+    vcpuid_t vmid = guest_current_vmid();
     int32_t vdev_num = -1;
     uint32_t hsr = read_hsr();
     uint32_t ec = (hsr & HSR_EC_BIT) >> EXTRACT_EC;
@@ -138,6 +149,7 @@ enum hyp_hvc_result _hyp_hvc_service(struct arch_regs *regs)
     uint32_t srt;
     struct arch_vdev_trigger_info info;
     int level = VDEV_LEVEL_LOW;
+    uint32_t start;
 
     fipa = (read_hpfar() & HPFAR_FIPA_MASK) >> HPFAR_FIPA_SHIFT;
     fipa = fipa << HPFAR_FIPA_PAGE_SHIFT;
@@ -148,6 +160,7 @@ enum hyp_hvc_result _hyp_hvc_service(struct arch_regs *regs)
     info.sas = (iss & ISS_SAS_MASK) >> ISS_SAS_SHIFT;
     srt = (iss & ISS_SRT_MASK) >> ISS_SRT_SHIFT;
     info.value = &(regs->gpr[srt]);
+    trace_event(TRACE_EV_TRAP, ec, iss, regs->pc);
     switch (ec) {
     case TRAP_EC_ZERO_UNKNOWN:
     case TRAP_EC_ZERO_WFI_WFE:
@@ -170,8 +183,11 @@ enum hyp_hvc_result _hyp_hvc_service(struct arch_regs *regs)
         level = VDEV_LEVEL_MIDDLE;
         break;
     case TRAP_EC_NON_ZERO_DATA_ABORT_FROM_OTHER_MODE:
-        level = VDEV_LEVEL_LOW;
-        break;
+        if (trap_mmio_emulate(regs, iss, fipa) < 0)
+            goto trap_error;
+        exit_stats_trap(vmid, ec, exit_stamp);
+        guest_perform_switch(regs);
+        return HYP_RESULT_ERET;
     default:
         printH("[hyp] _hyp_hvc_service:unknown hsr.iss= %x\n", iss);
         printH("[hyp] hsr.ec= %x\n", ec);
@@ -180,21 +196,32 @@ enum hyp_hvc_result _hyp_hvc_service(struct arch_regs *regs)
         goto trap_error;
     }
 
+    start = probe_start();
     vdev_num = vdev_find(level, &info, regs);
+    probe_end(PROBE_VDEV_FIND, start);
     if (vdev_num < 0) {
         printH("[hvc] cann't search vdev number\n\r");
         goto trap_error;
     }
 
-    if (iss & ISS_WNR) {
+    /* An HVC has no direction, its services are dispatched to write */
+    start = probe_start();
+    if (level == VDEV_LEVEL_MIDDLE || (iss & ISS_WNR)) {
         if (vdev_write(level, vdev_num, &info, regs) < 0)
             goto trap_error;
+        probe_end(PROBE_VDEV_WRITE, start);
     } else {
         if (vdev_read(level, vdev_num, &info, regs) < 0)
             goto trap_error;
+        probe_end(PROBE_VDEV_READ, start);
     }
+    start = probe_start();
     vdev_post(level, vdev_num, &info, regs);
+    probe_end(PROBE_VDEV_POST, start);
 
+    if (level == VDEV_LEVEL_MIDDLE)
+        exit_stats_hvc(vmid, iss & 0xFFFF, exit_stamp);
+    exit_stats_trap(vmid, ec, exit_stamp);
     guest_perform_switch(regs);
 
     return HYP_RESULT_ERET;
@@ -0,0 +1,375 @@
+/*
+ * trap_mmio.c
+ * --------------------------------------
+ * Decoding and emulation of guest accesses to emulated devices
+ */
+
+#include <trap_mmio.h>
+#include <trap.h>
+#include <vdev.h>
+#include <armv7_p15.h>
+#define DEBUG
+#include <log/print.h>
+
+#define MMIO_CACHE_ENTRIES  16
+#define MMIO_CACHE_MASK     (MMIO_CACHE_ENTRIES - 1)
+
+#define MMIO_PAGE_MASK      (~HPFAR_FIPA_PAGE_MASK)
+#define MMIO_NO_REG         0xFF
+/* r0 - r12, the banked sp, lr and the pc are not transferred */
+#define MMIO_GPR_MASK       ((1 << ARCH_REGS_NUM_GPR) - 1)
+
+#define CPSR_THUMB          0x20
+
+/* PAR in the long-descriptor format */
+#define PAR_F               0x1
+#define PAR_PA_MASK         0xFFFFF000
+
+struct mmio_access {
+    uint32_t valid;
+    uint32_t pc;
+    uint32_t page;
+    uint32_t iss;
+    /* Decoded instruction, without a valid syndrome only */
+    uint32_t inst;
+    uint32_t thumb;
+    /* Target vdev, range.size is 0 if it is not looked up by range */
+    int32_t vdev_num;
+    struct vdev_memory_map range;
+    /* Transferred registers, the lowest one at the lowest address */
+    uint32_t reglist;
+    uint8_t wnr;
+    uint8_t sas;
+    /* Byte and halfword loads sign extend */
+    uint8_t sign;
+    /* Base register writeback, rn += imm or rn +/-= rm */
+    uint8_t wb_rn;
+    uint8_t wb_rm;
+    uint8_t wb_sub;
+    int32_t wb_imm;
+};
+
+/* Accessed only by the cpu the guest runs on */
+static struct mmio_access _mmio_cache[NUM_GUESTS_STATIC][MMIO_CACHE_ENTRIES];
+
+static inline uint32_t mmio_cache_index(uint32_t pc, uint32_t page)
+{
+    return ((pc >> 1) ^ (page >> 12)) & MMIO_CACHE_MASK;
+}
+
+static inline uint32_t mmio_num_regs(uint32_t reglist)
+{
+    uint32_t n = 0;
+
+    for (; reglist; reglist &= reglist - 1)
+        n++;
+
+    return n;
+}
+
+/*
+ * Loads the instruction at guest virtual address 'va' through the
+ * stage 1 and 2 translation of the current guest.
+ */
+static hvmm_status_t mmio_fetch_inst(uint32_t va, uint32_t thumb,
+        uint32_t *inst)
+{
+    uint64_t par;
+    uint32_t pa;
+
+    write_ats12nsopr(va);
+    par = read_par64();
+    if (par & PAR_F)
+        return HVMM_STATUS_BAD_ACCESS;
+
+    pa = ((uint32_t)par & PAR_PA_MASK) | (va & ~PAR_PA_MASK);
+    if (thumb)
+        *inst = *(volatile uint16_t *)pa;
+    else
+        *inst = *(volatile uint32_t *)pa;
+
+    return HVMM_STATUS_SUCCESS;
+}
+
+/*
+ * ARM state loads and stores that do not report a valid syndrome:
+ * LDM/STM, LDR/STR{B}, LDRH/STRH, LDRSB/LDRSH and LDRD/STRD with
+ * an immediate or an unshifted register offset.
+ */
+static hvmm_status_t mmio_decode_arm(uint32_t inst, struct mmio_access *acc)
+{
+    uint32_t rn = (inst >> 16) & 0xF;
+    uint32_t rt = (inst >> 12) & 0xF;
+    uint32_t p = inst & (1 << 24);
+    uint32_t u = inst & (1 << 23);
+    uint32_t w = inst & (1 << 21);
+    uint32_t l = inst & (1 << 20);
+    uint32_t imm;
+
+    acc->wnr = !l;
+    if ((inst & 0x0E000000) == 0x08000000) {
+        /* LDM/STM, no user registers nor exception return */
+        if (inst & (1 << 22))
+            return HVMM_STATUS_UNSUPPORTED_FEATURE;
+        acc->reglist = inst & 0xFFFF;
+        acc->sas = VDEV_ACCESS_WORD;
+        if (w) {
+            acc->wb_rn = rn;
+            imm = 4 * mmio_num_regs(acc->reglist);
+            acc->wb_imm = u ? imm : -imm;
+        }
+    } else if ((inst & 0x0C000000) == 0x04000000) {
+        /* LDR/STR{B}, bit 4 set with a register offset is a media op */
+        if (inst & (1 << 25)) {
+            if (inst & 0x00000FF0)
+                return HVMM_STATUS_UNSUPPORTED_FEATURE;
+            acc->wb_rm = inst & 0xF;
+            acc->wb_sub = !u;
+        } else {
+            imm = inst & 0xFFF;
+            acc->wb_imm = u ? imm : -imm;
+        }
+        acc->reglist = 1 << rt;
+        acc->sas = (inst & (1 << 22)) ? VDEV_ACCESS_BYTE : VDEV_ACCESS_WORD;
+        if (!p || w)
+            acc->wb_rn = rn;
+    } else if ((inst & 0x0E000090) == 0x00000090 && (inst & 0x60)) {
+        /* Extra load/store */
+        if (inst & (1 << 22)) {
+            imm = ((inst >> 4) & 0xF0) | (inst & 0xF);
+            acc->wb_imm = u ? imm : -imm;
+        } else {
+            if (inst & 0x00000F00)
+                return HVMM_STATUS_UNSUPPORTED_FEATURE;
+            acc->wb_rm = inst & 0xF;
+            acc->wb_sub = !u;
+        }
+        acc->reglist = 1 << rt;
+        switch ((inst >> 5) & 0x3) {
+        case 1:
+            /* LDRH/STRH */
+            acc->sas = VDEV_ACCESS_HWORD;
+            break;
+        case 2:
+            /* LDRSB, LDRD */
+            acc->sas = l ? VDEV_ACCESS_BYTE : VDEV_ACCESS_WORD;
+            acc->sign = l ? 1 : 0;
+            break;
+        case 3:
+            /* LDRSH, STRD */
+            acc->sas = l ? VDEV_ACCESS_HWORD : VDEV_ACCESS_WORD;
+            acc->sign = l ? 1 : 0;
+            break;
+        }
+        if (!l && (inst & (1 << 5)) == 0) {
+            /* LDRD */
+            acc->wnr = 0;
+        }
+        if (!l) {
+            /* LDRD/STRD transfer an even/odd register pair */
+            if (rt & 1)
+                return HVMM_STATUS_UNSUPPORTED_FEATURE;
+            acc->reglist = 3 << rt;
+        }
+        if (!p || w)
+            acc->wb_rn = rn;
+    } else {
+        return HVMM_STATUS_UNSUPPORTED_FEATURE;
+    }
+
+    return HVMM_STATUS_SUCCESS;
+}
+
+/* Thumb state, 16-bit LDMIA/STMIA */
+static hvmm_status_t mmio_decode_thumb(uint32_t inst, struct mmio_access *acc)
+{
+    uint32_t rn = (inst >> 8) & 0x7;
+
+    if ((inst & 0xF000) != 0xC000)
+        return HVMM_STATUS_UNSUPPORTED_FEATURE;
+
+    acc->wnr = !(inst & (1 << 11));
+    acc->reglist = inst & 0xFF;
+    acc->sas = VDEV_ACCESS_WORD;
+    if (acc->wnr || !(acc->reglist & (1 << rn))) {
+        acc->wb_rn = rn;
+        acc->wb_imm = 4 * mmio_num_regs(acc->reglist);
+    }
+
+    return HVMM_STATUS_SUCCESS;
+}
+
+static hvmm_status_t mmio_decode(struct arch_regs *regs, uint32_t iss,
+        uint32_t page, struct mmio_access *acc)
+{
+    uint32_t thumb = regs->cpsr & CPSR_THUMB;
+    uint32_t inst;
+    hvmm_status_t result;
+
+    acc->valid = 0;
+    acc->pc = regs->pc;
+    acc->page = page;
+    acc->iss = iss;
+    acc->inst = 0;
+    acc->thumb = thumb;
+    acc->sign = 0;
+    acc->range.size = 0;
+    acc->wb_rn = MMIO_NO_REG;
+    acc->wb_rm = MMIO_NO_REG;
+    acc->wb_sub = 0;
+    acc->wb_imm = 0;
+
+    if (iss & ISS_VALID) {
+        acc->reglist = 1 << ((iss & ISS_SRT_MASK) >> ISS_SRT_SHIFT);
+        acc->sas = (iss & ISS_SAS_MASK) >> ISS_SAS_SHIFT;
+        acc->wnr = (iss & ISS_WNR) ? 1 : 0;
+        acc->sign = (iss & ISS_SSE_MASK) ? 1 : 0;
+    } else {
+        result = mmio_fetch_inst(regs->pc, thumb, &inst);
+        if (result) {
+            printh("[mmio] could not load the instruction at %x\n", regs->pc);
+            return result;
+        }
+        acc->inst = inst;
+        if (thumb)
+            result = mmio_decode_thumb(inst, acc);
+        else
+            result = mmio_decode_arm(inst, acc);
+        if (result) {
+            printh("[mmio] unsupported instruction %x at %x\n", inst,
+                    regs->pc);
+            return result;
+        }
+    }
+
+    if (!acc->reglist || (acc->reglist & ~MMIO_GPR_MASK))
+        return HVMM_STATUS_UNSUPPORTED_FEATURE;
+    if (acc->wb_rn != MMIO_NO_REG) {
+        /* Writeback of a loaded base is unpredictable */
+        if (acc->wb_rn >= ARCH_REGS_NUM_GPR ||
+                (!acc->wnr && (acc->reglist & (1 << acc->wb_rn))))
+            return HVMM_STATUS_UNSUPPORTED_FEATURE;
+        if (acc->wb_rm != MMIO_NO_REG && acc->wb_rm >= ARCH_REGS_NUM_GPR)
+            return HVMM_STATUS_UNSUPPORTED_FEATURE;
+    }
+
+    acc->valid = 1;
+
+    return HVMM_STATUS_SUCCESS;
+}
+
+/*
+ * An entry decoded from the instruction is reused only while the same
+ * instruction is at its pc: another process or a reloaded module may have
+ * mapped something else at the same virtual address.
+ */
+static uint32_t mmio_cache_hit(struct mmio_access *acc,
+        struct arch_regs *regs, uint32_t iss, uint32_t page)
+{
+    uint32_t thumb = regs->cpsr & CPSR_THUMB;
+    uint32_t inst;
+
+    if (!acc->valid || acc->pc != regs->pc || acc->page != page ||
+            acc->iss != iss)
+        return 0;
+    if (iss & ISS_VALID)
+        return 1;
+    if (acc->thumb != thumb || mmio_fetch_inst(regs->pc, thumb, &inst))
+        return 0;
+
+    return inst == acc->inst;
+}
+
+static uint32_t mmio_sign_extend(struct mmio_access *acc, uint32_t value)
+{
+    if (acc->sas == VDEV_ACCESS_BYTE)
+        return (int32_t)(signed char)value;
+    if (acc->sas == VDEV_ACCESS_HWORD)
+        return (int32_t)(short)value;
+
+    return value;
+}
+
+int32_t trap_mmio_emulate(struct arch_regs *regs, uint32_t iss,
+        uint32_t fipa)
+{
+    vcpuid_t vmid = guest_current_vmid();
+    uint32_t page = fipa & MMIO_PAGE_MASK;
+    struct arch_vdev_trigger_info info;
+    struct mmio_access *acc;
+    uint32_t reglist, size, i;
+
+    if (vmid >= NUM_GUESTS_STATIC)
+        return VDEV_ERROR;
+
+    acc = &_mmio_cache[vmid][mmio_cache_index(regs->pc, page)];
+    if (!mmio_cache_hit(acc, regs, iss, page)) {
+        if (mmio_decode(regs, iss, page, acc))
+            return VDEV_ERROR;
+    }
+
+    info.ec = TRAP_EC_NON_ZERO_DATA_ABORT_FROM_OTHER_MODE;
+    info.iss = iss;
+    info.fipa = fipa;
+    info.il = 0;
+    info.sas = acc->sas;
+    info.value = &regs->gpr[0];
+
+    if (!acc->range.size || fipa - acc->range.base >= acc->range.size) {
+        acc->vdev_num = vdev_find_mapped(fipa, &acc->range);
+        if (acc->vdev_num == VDEV_NOT_FOUND) {
+            acc->range.size = 0;
+            acc->vdev_num = vdev_find(VDEV_LEVEL_LOW, &info, regs);
+            if (acc->vdev_num < 0) {
+                printh("[mmio] cann't search vdev number\n");
+                return VDEV_ERROR;
+            }
+        }
+    }
+
+    /* Multiple transfers must stay within the device */
+    size = 4 * mmio_num_regs(acc->reglist);
+    if (size > 4 && acc->range.size &&
+            fipa - acc->range.base + size > acc->range.size)
+        return VDEV_ERROR;
+
+    for (i = 0, reglist = acc->reglist; reglist; i++, reglist >>= 1) {
+        if (!(reglist & 1))
+            continue;
+        info.value = &regs->gpr[i];
+        if (acc->wnr) {
+            if (vdev_write(VDEV_LEVEL_LOW, acc->vdev_num, &info, regs) < 0)
+                return VDEV_ERROR;
+        } else {
+            if (vdev_read(VDEV_LEVEL_LOW, acc->vdev_num, &info, regs) < 0)
+                return VDEV_ERROR;
+            if (acc->sign)
+                regs->gpr[i] = mmio_sign_extend(acc, regs->gpr[i]);
+        }
+        info.fipa += 4;
+    }
+
+    if (acc->wb_rn != MMIO_NO_REG) {
+        if (acc->wb_rm == MMIO_NO_REG)
+            regs->gpr[acc->wb_rn] += acc->wb_imm;
+        else if (acc->wb_sub)
+            regs->gpr[acc->wb_rn] -= regs->gpr[acc->wb_rm];
+        else
+            regs->gpr[acc->wb_rn] += regs->gpr[acc->wb_rm];
+    }
+
+    vdev_post(VDEV_LEVEL_LOW, acc->vdev_num, &info, regs);
+
+    return 0;
+}
+
+void trap_mmio_flush(vcpuid_t vmid)
+{
+    int i;
+
+    if (vmid >= NUM_GUESTS_STATIC)
+        return;
+
+    for (i = 0; i < MMIO_CACHE_ENTRIES; i++)
+        _mmio_cache[vmid][i].valid = 0;
+}
@@ -0,0 +1,28 @@
+#ifndef __TRAP_MMIO_H__
+#define __TRAP_MMIO_H__
+
+#include <hvmm_types.h>
+#include <vcpu.h>
+
+/**
+ * @brief   Emulates a guest data abort on an emulated device.
+ *
+ * The decoded access (registers, access size, direction, base register
+ * writeback and the target vdev) is cached per guest, keyed by the guest
+ * PC and the faulting page. Accesses without a valid instruction syndrome
+ * (LDM/STM, LDRD/STRD and writeback forms of LDR/STR) are decoded from
+ * the guest instruction, once per cache entry.
+ * @param regs  ARM registers of the current guest.
+ * @param iss   Instruction Specific Syndrome of the HSR.
+ * @param fipa  Faulting intermediate physical address.
+ * @return  0 on success, VDEV_ERROR if the access can not be emulated.
+ */
+int32_t trap_mmio_emulate(struct arch_regs *regs, uint32_t iss,
+        uint32_t fipa);
+
+/**
+ * @brief   Drops the cached accesses of 'vmid', when its image is reloaded.
+ */
+void trap_mmio_flush(vcpuid_t vmid);
+
+#endif
@@ -6,6 +6,10 @@
 #include <vcpu.h>
 #include <k-hypervisor-config.h>
 #include <asm-arm_inline.h>
+#include <smp.h>
+#include <interrupt_stats.h>
+#include <trace.h>
+#include <profile.h>
 
 #include <log/print.h>
 
@@ -36,6 +40,16 @@
             (_vgic.initialized == VGIC_SIGNATURE_INITIALIZED)
 #define SLOT_INVALID        0xFFFFFFFF
 #define VIRQ_MAX_ENTRIES    128
+#define VIRQ_PENDING_WORDS  (MAX_IRQS / 32)
+/* Entries per (target, source) CPU mailbox, must be a power of 2 */
+#define VIRQ_MAILBOX_ENTRIES    32
+/* Priorities of the virqs injected by virq_inject() */
+#define VIRQ_PRIORITY_HW    GIC_INT_PRIORITY_DEFAULT
+#define VIRQ_PRIORITY_SW    0x00
+
+/* Software virqs below 16 are virtual SGIs, 'pirq' carries the source */
+#define VIRQ_NUM_SGIS       16
+#define VIRQ_IS_SGI(virq)   ((virq) < VIRQ_NUM_SGIS)
 
 /*
  * Operations:
@@ -58,10 +72,18 @@
  *  - [*] ISR: Maintenance IRQ
  *      Check VICH_MISR
  *          [V] EOI - At least one VIRQ EOI
- *          [ ] U - Underflow - Non or one valid interrupt in LRs
+ *          [V] U - Underflow - Non or one valid interrupt in LRs
  *          [ ] LRENP - LI Entry Not Present (
  *                              no valid interrupt for an EOI request)
- *          [ ] NP - No Pending Interrupt
+ *          [V] NP - No Pending Interrupt
+ *  - [V] LR overflow: the highest priority virqs are kept in LRs, the rest
+ *      are queued and refilled by U/NP maintenance interrupts
+ *  - [V] Cross-CPU injection: virqs for a guest hosted by another CPU are
+ *      posted to that CPU's mailbox, kicked by GIC_SGI_SLOT_CHECK only
+ *      while the guest is running there
+ *  - [V] Virtual SGIs: pending per (target, sgi, source); the source is
+ *      carried in the LR CPUID field, one source at a time is in flight
+ *      and the next one is injected on its EOI
  *          [ ] VGrp[0/1][E/D]
  *  - [V] Context Switch:
  *  Saved/Restored Registers:
@@ -90,14 +112,50 @@ struct virq_entry {
     uint32_t virq;
     uint8_t hw;
     uint8_t valid;
+    uint8_t priority;
+};
+
+struct virq_post {
+    uint32_t virq;
+    uint32_t pirq;
+    vcpuid_t vmid;
+    uint8_t hw;
+};
+
+/*
+ * Single-producer/single-consumer ring of virqs posted by one CPU to
+ * another. Hyp mode is not reentrant, so each ring is lock-free.
+ */
+struct virq_mailbox {
+    /** Written by the source CPU only */
+    volatile uint32_t head;
+    /** Written by the target CPU only */
+    volatile uint32_t tail;
+    struct virq_post post[VIRQ_MAILBOX_ENTRIES];
 };
 
 static struct vgic _vgic;
 
+/* [target cpu][source cpu] */
+static struct virq_mailbox _virq_mailbox[NUM_CPUS][NUM_CPUS];
+/* Set once a kick SGI is in flight, cleared by the target on drain */
+static volatile uint32_t _virq_kick_pending[NUM_CPUS];
+
 static uint32_t _guest_pirqatslot[NUM_GUESTS_STATIC][VGIC_NUM_MAX_SLOTS];
 static uint32_t _guest_virqatslot[NUM_GUESTS_STATIC][VGIC_NUM_MAX_SLOTS];
 
 static struct virq_entry _guest_virqs[NUM_GUESTS_STATIC][VIRQ_MAX_ENTRIES + 1];
+static uint32_t _guest_virq_pending[NUM_GUESTS_STATIC][VIRQ_PENDING_WORDS];
+static uint32_t _guest_virq_num_queued[NUM_GUESTS_STATIC];
+/*
+ * The queue of a guest is drained by its own CPU only, but the other CPUs
+ * queue into it when their mailbox to that CPU is full.
+ */
+static DEFINE_SPINLOCK(_guest_virq_lock);
+
+/* Pending sources of virtual SGIs, one bit per source vCPU */
+static uint8_t _guest_sgi_pending[NUM_GUESTS_STATIC][VIRQ_NUM_SGIS];
+static DEFINE_SPINLOCK(_guest_sgi_lock);
 
 void vgic_slotpirq_init(void)
 {
@@ -166,12 +224,194 @@ void vgic_slotvirq_clear(vcpuid_t vmid, uint32_t slot)
     vgic_slotvirq_set(vmid, slot, VIRQ_INVALID);
 }
 
-hvmm_status_t virq_inject(vcpuid_t vmid, uint32_t virq,
-                uint32_t pirq, uint8_t hw)
+/*
+ * Queue a virq that could not be placed in a List Register. The pending
+ * bitmap merges repeated requests for a virq that is already queued.
+ * May be called from any CPU.
+ */
+static hvmm_status_t virq_queue(vcpuid_t vmid, uint32_t virq,
+                uint32_t pirq, uint8_t hw, uint8_t priority)
 {
     hvmm_status_t result = HVMM_STATUS_BUSY;
+    struct virq_entry *q = &_guest_virqs[vmid][0];
+    uint32_t *pending = &_guest_virq_pending[vmid][0];
     int i;
+
+    if (virq >= MAX_IRQS)
+        return HVMM_STATUS_BAD_ACCESS;
+
+    spin_lock(&_guest_virq_lock);
+    if (pending[virq >> 5] & (1 << (virq & 0x1F))) {
+        spin_unlock(&_guest_virq_lock);
+        return HVMM_STATUS_SUCCESS;
+    }
+
+    for (i = 0; i < VIRQ_MAX_ENTRIES; i++) {
+        if (q[i].valid == 0) {
+            q[i].pirq = pirq;
+            q[i].virq = virq;
+            q[i].hw = hw;
+            q[i].priority = priority;
+            q[i].valid = 1;
+            pending[virq >> 5] |= (1 << (virq & 0x1F));
+            _guest_virq_num_queued[vmid]++;
+            result = HVMM_STATUS_SUCCESS;
+            break;
+        }
+    }
+    spin_unlock(&_guest_virq_lock);
+    if (result == HVMM_STATUS_SUCCESS)
+        trace_event(TRACE_EV_VIRQ_QUEUE, vmid, virq, pirq);
+    else
+        printh("virq: queueing virq %d pirq %d to vmid %d failed\n",
+                virq, pirq, vmid);
+    return result;
+}
+
+static void virq_dequeue(vcpuid_t vmid, int index)
+{
+    struct virq_entry *entry = &_guest_virqs[vmid][index];
+    uint32_t virq = entry->virq;
+
+    spin_lock(&_guest_virq_lock);
+    entry->valid = 0;
+    _guest_virq_pending[vmid][virq >> 5] &= ~(1 << (virq & 0x1F));
+    _guest_virq_num_queued[vmid]--;
+    spin_unlock(&_guest_virq_lock);
+}
+
+/*
+ * Return the index of the queued virq with the highest priority
+ * (lowest value), or -1 if the queue is empty.
+ */
+static int virq_queue_highest(vcpuid_t vmid)
+{
     struct virq_entry *q = &_guest_virqs[vmid][0];
+    int found = -1;
+    int i;
+
+    if (_guest_virq_num_queued[vmid] == 0)
+        return found;
+
+    /*
+     * Entries found here stay valid until virq_dequeue(), only the owner
+     * CPU removes them.
+     */
+    spin_lock(&_guest_virq_lock);
+    for (i = 0; i < VIRQ_MAX_ENTRIES; i++) {
+        if (q[i].valid && (found < 0 || q[i].priority < q[found].priority))
+            found = i;
+    }
+    spin_unlock(&_guest_virq_lock);
+    return found;
+}
+
+/*
+ * All List Registers are in use. Spill the lowest priority virq that is
+ * only pending (not yet acknowledged by the guest) back to the queue if
+ * it is less urgent than 'priority'.
+ *
+ * @return  freed slot index, or VGIC_SLOT_NOTFOUND
+ */
+static uint32_t vgic_evict_slot(vcpuid_t vmid, uint32_t priority)
+{
+    uint64_t elsr;
+    uint32_t lr;
+    uint32_t lr_priority;
+    uint32_t victim = VGIC_SLOT_NOTFOUND;
+    uint32_t victim_priority = priority;
+    uint32_t virq;
+    uint32_t pirq;
+    int i;
+
+    elsr = ((uint64_t)_vgic.base[GICH_ELSR1] << 32) | _vgic.base[GICH_ELSR0];
+    for (i = 0; i < _vgic.num_lr; i++) {
+        if (elsr & (1ULL << i))
+            continue;
+        lr = _vgic.base[GICH_LR + i];
+        if ((lr & GICH_LR_STATE_MASK) != GICH_LR_STATE_PENDING)
+            continue;
+        lr_priority = ((lr & GICH_LR_PRIORITY_MASK) >>
+                GICH_LR_PRIORITY_SHIFT) << 3;
+        if (lr_priority > victim_priority) {
+            victim = i;
+            victim_priority = lr_priority;
+        }
+    }
+    if (victim == VGIC_SLOT_NOTFOUND)
+        return victim;
+
+    lr = _vgic.base[GICH_LR + victim];
+    virq = lr & GICH_LR_VIRTUALID_MASK;
+    pirq = vgic_slotpirq_get(vmid, victim);
+    if (virq_queue(vmid, virq, pirq, pirq != PIRQ_INVALID,
+                victim_priority) != HVMM_STATUS_SUCCESS)
+        return VGIC_SLOT_NOTFOUND;
+
+    _vgic.base[GICH_LR + victim] = 0;
+    vgic_slotpirq_clear(vmid, victim);
+    vgic_slotvirq_clear(vmid, victim);
+    printh("vgic: spilled virq %d at slot %d\n", virq, victim);
+    return victim;
+}
+
+/*
+ * Place a virq in a List Register of the running guest, spilling a less
+ * urgent pending virq if all List Registers are in use.
+ *
+ * @return  slot index, or VGIC_SLOT_NOTFOUND
+ */
+static uint32_t vgic_inject_entry(vcpuid_t vmid, uint32_t virq,
+                uint32_t pirq, uint8_t hw, uint32_t priority)
+{
+    uint32_t slot;
+    int retry;
+
+    for (retry = 0; retry < 2; retry++) {
+        if (hw) {
+            slot = vgic_inject_virq_hw(virq, VIRQ_STATE_PENDING,
+                    priority, pirq);
+            if (slot != VGIC_SLOT_NOTFOUND)
+                vgic_slotpirq_set(vmid, slot, pirq);
+        } else {
+            slot = vgic_inject_virq_sw(virq, VIRQ_STATE_PENDING, priority,
+                    VIRQ_IS_SGI(virq) ? pirq : smp_processor_id(), 1);
+        }
+        if (slot != VGIC_SLOT_NOTFOUND) {
+            vgic_slotvirq_set(vmid, slot, virq);
+            irq_stats_injected(vmid, slot,
+                    (hw || !VIRQ_IS_SGI(virq)) ? pirq : PIRQ_INVALID);
+            break;
+        }
+        if (vgic_evict_slot(vmid, priority) == VGIC_SLOT_NOTFOUND)
+            break;
+    }
+    return slot;
+}
+
+/*
+ * Request a maintenance interrupt as soon as List Registers drain while
+ * virqs are still queued, instead of waiting for the next switch.
+ */
+static void vgic_refill_enable(uint8_t enable)
+{
+    uint32_t hcr = _vgic.base[GICH_HCR];
+
+    if (enable)
+        hcr |= (GICH_HCR_UIE | GICH_HCR_NPIE);
+    else
+        hcr &= ~(GICH_HCR_UIE | GICH_HCR_NPIE);
+    _vgic.base[GICH_HCR] = hcr;
+}
+
+/*
+ * Injects a virq to a guest hosted by the current CPU.
+ */
+static hvmm_status_t virq_inject_local(vcpuid_t vmid, uint32_t virq,
+                uint32_t pirq, uint8_t hw)
+{
+    hvmm_status_t result = HVMM_STATUS_BUSY;
+    uint8_t priority = hw ? VIRQ_PRIORITY_HW : VIRQ_PRIORITY_SW;
 
     /* Interrupt occurs to the same virtual machine running guest;Then,
      * we directly inject into guest. If it's not running guest's interrupt,
@@ -180,79 +420,240 @@ hvmm_status_t virq_inject(vcpuid_t vmid, uint32_t virq,
      */
     if (vmid == guest_current_vmid()) {
         uint32_t slot;
-        if (hw) {
-            slot = vgic_inject_virq_hw(virq,
-                    VIRQ_STATE_PENDING, GIC_INT_PRIORITY_DEFAULT,
-                    pirq);
-            if (slot != VGIC_SLOT_NOTFOUND)
-                vgic_slotpirq_set(vmid, slot, pirq);
+        /* Keep ordering: queued virqs of higher priority go first */
+        vgic_flush_virqs(vmid);
+        slot = vgic_inject_entry(vmid, virq, pirq, hw, priority);
+        if (slot != VGIC_SLOT_NOTFOUND) {
+            result = HVMM_STATUS_SUCCESS;
         } else {
-            slot = vgic_inject_virq_sw(virq,
-                    VIRQ_STATE_PENDING, 0,
-                    vmid, 1);
+            /* List Registers are full of more urgent virqs */
+            result = virq_queue(vmid, virq, pirq, hw, priority);
+            if (result == HVMM_STATUS_SUCCESS)
+                vgic_refill_enable(1);
         }
-        if (slot == VGIC_SLOT_NOTFOUND)
-            return result;
-
-        vgic_slotvirq_set(vmid, slot, virq);
-        result = HVMM_STATUS_SUCCESS;
     } else {
         int slot = vgic_slotvirq_getslot(vmid, virq);
         if (slot == SLOT_INVALID) {
             /* Inject only the same virq is not present in a slot */
-            for (i = 0; i < VIRQ_MAX_ENTRIES; i++) {
-                if (q[i].valid == 0) {
-                    q[i].pirq = pirq;
-                    q[i].virq = virq;
-                    q[i].hw = hw;
-                    q[i].valid = 1;
-                    result = HVMM_STATUS_SUCCESS;
-                    break;
-                }
-            }
-            printh("virq: queueing virq %d pirq %d to vmid %d %s\n",
-                    virq, pirq, vmid,
-                    result == HVMM_STATUS_SUCCESS ? "done" : "failed");
+            result = virq_queue(vmid, virq, pirq, hw, priority);
         } else {
             printh("virq: rejected queueing duplicated virq %d pirq %d to "
                     "vmid %d %s\n", virq, pirq, vmid);
         }
-        if ((result == HVMM_STATUS_SUCCESS) && (virq < 16) ) {
-            gic_set_sgi(1<<vmid, GIC_SGI_SLOT_CHECK);
-        }
     }
     return result;
 }
+
+/*
+ * Posts a virq to the mailbox of the remote CPU hosting 'vmid'. The target
+ * is kicked by an SGI only if the guest is running there right now,
+ * otherwise the mailbox is drained when the guest is switched in.
+ * Kicks are coalesced until the target drains its mailboxes.
+ *
+ * If the mailbox is full the virq goes straight to the queue of the guest,
+ * which the target flushes on the same kick or switch. A virq that fits
+ * neither is dropped and counted in the interrupt statistics.
+ */
+static hvmm_status_t virq_post(uint32_t target, vcpuid_t vmid,
+                uint32_t virq, uint32_t pirq, uint8_t hw)
+{
+    struct virq_mailbox *mbox;
+    struct virq_post *post;
+    uint32_t head;
+    hvmm_status_t result;
+
+    mbox = &_virq_mailbox[target][smp_processor_id()];
+    head = mbox->head;
+    if (head - mbox->tail >= VIRQ_MAILBOX_ENTRIES) {
+        result = virq_queue(vmid, virq, pirq, hw,
+                hw ? VIRQ_PRIORITY_HW : VIRQ_PRIORITY_SW);
+        if (result != HVMM_STATUS_SUCCESS) {
+            irq_stats_dropped(vmid);
+            printH("virq: cpu %d full, virq %d to vmid %d dropped\n",
+                    target, virq, vmid);
+            return result;
+        }
+    } else {
+        post = &mbox->post[head & (VIRQ_MAILBOX_ENTRIES - 1)];
+        post->vmid = vmid;
+        post->virq = virq;
+        post->pirq = pirq;
+        post->hw = hw;
+        smp_wmb();
+        mbox->head = head + 1;
+    }
+    /* Publish the post before looking at the target's running guest */
+    smp_mb();
+
+    if (guest_is_running(vmid) && !_virq_kick_pending[target]) {
+        _virq_kick_pending[target] = 1;
+        gic_set_sgi(1 << target, GIC_SGI_SLOT_CHECK);
+    }
+    return HVMM_STATUS_SUCCESS;
+}
+
+/*
+ * Injects virqs posted to the current CPU by the other CPUs.
+ */
+static void virq_mailbox_drain(void)
+{
+    uint32_t cpu = smp_processor_id();
+    struct virq_mailbox *mbox;
+    struct virq_post *post;
+    uint32_t tail;
+    int src;
+
+    _virq_kick_pending[cpu] = 0;
+    /* Pairs with the barrier in virq_post() */
+    smp_mb();
+    for (src = 0; src < NUM_CPUS; src++) {
+        mbox = &_virq_mailbox[cpu][src];
+        tail = mbox->tail;
+        while (tail != mbox->head) {
+            smp_rmb();
+            post = &mbox->post[tail & (VIRQ_MAILBOX_ENTRIES - 1)];
+            virq_inject_local(post->vmid, post->virq, post->pirq, post->hw);
+            tail++;
+        }
+        smp_mb();
+        mbox->tail = tail;
+    }
+}
+
+hvmm_status_t virq_inject(vcpuid_t vmid, uint32_t virq,
+                uint32_t pirq, uint8_t hw)
+{
+    uint32_t target;
+
+    if (vmid >= NUM_GUESTS_STATIC)
+        return HVMM_STATUS_BAD_ACCESS;
+
+    target = guest_vmid_to_cpu(vmid);
+    if (target != smp_processor_id())
+        return virq_post(target, vmid, virq, pirq, hw);
+
+    return virq_inject_local(vmid, virq, pirq, hw);
+}
+
+hvmm_status_t virq_inject_sgi(vcpuid_t vmid, uint32_t sgi, uint32_t source)
+{
+    uint8_t pending;
+
+    if (vmid >= NUM_GUESTS_STATIC || !VIRQ_IS_SGI(sgi) || source > 7)
+        return HVMM_STATUS_BAD_ACCESS;
+
+    spin_lock(&_guest_sgi_lock);
+    pending = _guest_sgi_pending[vmid][sgi];
+    _guest_sgi_pending[vmid][sgi] |= (1 << source);
+    spin_unlock(&_guest_sgi_lock);
+
+    /* Another source is in flight, this one follows its EOI */
+    if (pending)
+        return HVMM_STATUS_SUCCESS;
+
+    return virq_inject(vmid, sgi, source, 0);
+}
+
+uint8_t virq_is_pending(vcpuid_t vmid, uint32_t virq)
+{
+    if (vmid >= NUM_GUESTS_STATIC || virq >= MAX_IRQS)
+        return 0;
+
+    if (_guest_virq_pending[vmid][virq >> 5] & (1 << (virq & 0x1F)))
+        return 1;
+
+    return vgic_slotvirq_getslot(vmid, virq) != SLOT_INVALID;
+}
+
+uint8_t virq_sgi_pending(vcpuid_t vmid, uint32_t sgi)
+{
+    uint8_t pending;
+
+    if (vmid >= NUM_GUESTS_STATIC || !VIRQ_IS_SGI(sgi))
+        return 0;
+
+    spin_lock(&_guest_sgi_lock);
+    pending = _guest_sgi_pending[vmid][sgi];
+    spin_unlock(&_guest_sgi_lock);
+
+    return pending;
+}
+
+void virq_sgi_clear(vcpuid_t vmid, uint32_t sgi, uint8_t sources)
+{
+    if (vmid >= NUM_GUESTS_STATIC || !VIRQ_IS_SGI(sgi))
+        return;
+
+    spin_lock(&_guest_sgi_lock);
+    _guest_sgi_pending[vmid][sgi] &= ~sources;
+    spin_unlock(&_guest_sgi_lock);
+}
+
+/*
+ * Retires the source of a virtual SGI whose List Register has been EOIed.
+ *
+ * @return  bit of the SGI if other sources are still pending
+ */
+static uint32_t virq_sgi_retire(vcpuid_t vmid, uint32_t lr)
+{
+    uint32_t sgi = lr & GICH_LR_VIRTUALID_MASK;
+    uint32_t source = (lr & GICH_LR_CPUID_MASK) >> GICH_LR_CPUID_SHIFT;
+    uint32_t more;
+
+    if (vmid >= NUM_GUESTS_STATIC || !VIRQ_IS_SGI(sgi) || (lr & GICH_LR_HW))
+        return 0;
+
+    spin_lock(&_guest_sgi_lock);
+    _guest_sgi_pending[vmid][sgi] &= ~(1 << source);
+    more = _guest_sgi_pending[vmid][sgi];
+    spin_unlock(&_guest_sgi_lock);
+
+    return more ? (1 << sgi) : 0;
+}
+
+/*
+ * Injects the next pending source of each SGI in 'sgis'. Senders on other
+ * CPUs update the pending sources concurrently, read them under the lock.
+ */
+static void virq_sgi_next(vcpuid_t vmid, uint32_t sgis)
+{
+    uint32_t sgi;
+    uint8_t pending;
+
+    while (sgis) {
+        sgi = 31 - asm_clz(sgis);
+        sgis &= ~(1 << sgi);
+        spin_lock(&_guest_sgi_lock);
+        pending = _guest_sgi_pending[vmid][sgi];
+        spin_unlock(&_guest_sgi_lock);
+        if (pending)
+            virq_inject(vmid, sgi, 31 - asm_clz(pending), 0);
+    }
+}
+
 hvmm_status_t vgic_flush_virqs(vcpuid_t vmid)
 {
     /* Actual injection of queued VIRQs takes place here */
     int i;
     int count = 0;
     struct virq_entry *entries = &_guest_virqs[vmid][0];
-    for (i = 0; i < VIRQ_MAX_ENTRIES; i++) {
-        if (entries[i].valid) {
-            uint32_t slot;
-            if (entries[i].hw) {
-                slot = vgic_inject_virq_hw(entries[i].virq,
-                        VIRQ_STATE_PENDING, GIC_INT_PRIORITY_DEFAULT,
-                        entries[i].pirq);
-                if (slot != VGIC_SLOT_NOTFOUND)
-                    vgic_slotpirq_set(vmid, slot, entries[i].pirq);
-            } else {
-                slot = vgic_inject_virq_sw(entries[i].virq,
-                        VIRQ_STATE_PENDING, GIC_INT_PRIORITY_DEFAULT,
-                        smp_processor_id(), 1);
-            }
-            if (slot == VGIC_SLOT_NOTFOUND)
-                break;
-            vgic_slotvirq_set(vmid, slot, entries[i].virq);
-            /* Forget */
-            entries[i].valid = 0;
-            count++;
-        }
+
+    /* Highest priority first, the rest stays queued */
+    while ((i = virq_queue_highest(vmid)) >= 0) {
+        uint32_t slot;
+        slot = vgic_inject_entry(vmid, entries[i].virq, entries[i].pirq,
+                entries[i].hw, entries[i].priority);
+        if (slot == VGIC_SLOT_NOTFOUND)
+            break;
+        /* Forget */
+        virq_dequeue(vmid, i);
+        count++;
     }
+    /* Refill as soon as the guest retires virqs in List Registers */
+    vgic_refill_enable(_guest_virq_num_queued[vmid] > 0);
+
     if (count > 0)
-        printh("virq: injected %d virqs to vmid %d\n", count, vmid);
+        trace_event(TRACE_EV_VIRQ_INJECT, vmid, count, 0);
 
     return HVMM_STATUS_SUCCESS;
 }
@@ -409,46 +810,64 @@ static void _vgic_dump_regs(void)
 
 static void _vgic_isr_maintenance_irq(int irq, void *pregs, void *pdata)
 {
+    uint32_t misr = _vgic.base[GICH_MISR];
+    vcpuid_t vmid;
+
     HVMM_TRACE_ENTER();
-    if (_vgic.base[GICH_MISR] & GICH_MISR_EOI) {
+    vmid = guest_current_vmid();
+    if (misr & GICH_MISR_EOI) {
         /* clean up invalid entries from List Registers */
         uint32_t eisr = _vgic.base[GICH_EISR0];
         uint32_t slot;
         uint32_t pirq;
-        vcpuid_t vmid;
-        vmid = guest_current_vmid();
+        uint32_t sgis = 0;
         while (eisr) {
             slot = (31 - asm_clz(eisr));
             eisr &= ~(1 << slot);
+            sgis |= virq_sgi_retire(vmid, _vgic.base[GICH_LR + slot]);
             _vgic.base[GICH_LR + slot] = 0;
+            irq_stats_eoi(vmid, slot);
             /* deactivate associated pirq at the slot */
             pirq = vgic_slotpirq_get(vmid, slot);
             if (pirq != PIRQ_INVALID) {
                 gic_deactivate_irq(pirq);
                 vgic_slotpirq_clear(vmid, slot);
-                printh("vgic: deactivated pirq %d at slot %d\n", pirq, slot);
-            } else {
-                printh("vgic: deactivated virq at slot %d\n", slot);
             }
+            trace_event(TRACE_EV_VIRQ_EOI, vmid, slot, pirq);
             vgic_slotvirq_clear(vmid, slot);
         }
         eisr = _vgic.base[GICH_EISR1];
         while (eisr) {
             slot = (31 - asm_clz(eisr));
             eisr &= ~(1 << slot);
-            _vgic.base[GICH_LR + slot + 32] = 0;
+            slot += 32;
+            sgis |= virq_sgi_retire(vmid, _vgic.base[GICH_LR + slot]);
+            _vgic.base[GICH_LR + slot] = 0;
+            irq_stats_eoi(vmid, slot);
             /* deactivate associated pirq at the slot */
-            pirq = vgic_slotpirq_get(vmid, slot + 32);
+            pirq = vgic_slotpirq_get(vmid, slot);
             if (pirq != PIRQ_INVALID) {
                 gic_deactivate_irq(pirq);
-                vgic_slotpirq_clear(vmid, slot + 32);
-                printh("vgic: deactivated pirq %d at slot %d\n", pirq, slot);
-            } else {
-                printh("vgic: deactivated virq at slot %d\n", slot);
+                vgic_slotpirq_clear(vmid, slot);
             }
+            trace_event(TRACE_EV_VIRQ_EOI, vmid, slot, pirq);
             vgic_slotvirq_clear(vmid, slot);
         }
-
+        /* Deliver the next source of retired virtual SGIs */
+        if (sgis)
+            virq_sgi_next(vmid, sgis);
+    }
+    if ((misr & (GICH_MISR_EOI | GICH_MISR_U | GICH_MISR_NP)) &&
+            vmid < NUM_GUESTS_STATIC) {
+        /* List Registers drained, refill them from the queue */
+        vgic_flush_virqs(vmid);
+        /*
+         * NP stays asserted while every List Register is active; do not
+         * keep it enabled if there was no room to refill, U will follow.
+         */
+        if (_guest_virq_num_queued[vmid] > 0 &&
+                vgic_find_free_slot() == VGIC_SLOT_NOTFOUND)
+            _vgic.base[GICH_HCR] &= ~(GICH_HCR_NPIE);
     }
 
     HVMM_TRACE_EXIT();
@@ -604,9 +1023,25 @@ static uint64_t _vgic_valid_lr_mask(uint32_t num_lr)
 hvmm_status_t virq_init(void)
 {
     int i, j;
-    for (i = 0; i < NUM_GUESTS_STATIC; i++)
+
+    /* Shared by all CPUs, the secondary CPUs must not reset it */
+    if (smp_processor_id())
+        return HVMM_STATUS_SUCCESS;
+
+    for (i = 0; i < NUM_CPUS; i++) {
+        for (j = 0; j < NUM_CPUS; j++) {
+            _virq_mailbox[i][j].head = 0;
+            _virq_mailbox[i][j].tail = 0;
+        }
+        _virq_kick_pending[i] = 0;
+    }
+    for (i = 0; i < NUM_GUESTS_STATIC; i++) {
         for (j = 0; j < (VIRQ_MAX_ENTRIES + 1); j++)
             _guest_virqs[i][j].valid = 0;
+        for (j = 0; j < VIRQ_PENDING_WORDS; j++)
+            _guest_virq_pending[i][j] = 0;
+        _guest_virq_num_queued[i] = 0;
+    }
 
     return HVMM_STATUS_SUCCESS;
 }
@@ -650,12 +1085,43 @@ hvmm_status_t vgic_init_status(struct vgic_status *status, vcpuid_t vmid)
     return result;
 }
 
-hvmm_status_t vgic_save_status(struct vgic_status *status)
+/*
+ * A PPI is banked per CPU: while a descheduled guest holds one HW-linked
+ * in a List Register, the physical PPI stays active and blocks it for the
+ * next guests on this CPU. Deactivate it and keep the virq as a software
+ * one, retired by the maintenance interrupt.
+ */
+static uint32_t vgic_unlink_ppi(vcpuid_t vmid, uint32_t slot, uint32_t lr)
+{
+    uint32_t pirq;
+
+    /* Without HW virqs the pirq is deactivated on the maintenance EOI */
+    if (lr & GICH_LR_HW)
+        pirq = (lr & GICH_LR_PHYSICALID_MASK) >> GICH_LR_PHYSICALID_SHIFT;
+    else
+        pirq = vgic_slotpirq_get(vmid, slot);
+    if (lr == 0 || pirq >= MAX_PPI_IRQS)
+        return lr;
+
+    vgic_slotpirq_clear(vmid, slot);
+    /* The EOI of a HW-linked virq has deactivated it already */
+    if (!(lr & GICH_LR_HW) ||
+            (lr & GICH_LR_STATE_MASK) != GICH_LR_STATE_INACTIVE)
+        gic_deactivate_irq(pirq);
+    if ((lr & GICH_LR_STATE_MASK) == GICH_LR_STATE_INACTIVE) {
+        vgic_slotvirq_clear(vmid, slot);
+        return 0;
+    }
+
+    return (lr & ~(GICH_LR_HW | GICH_LR_PHYSICALID_MASK)) | GICH_LR_EOI;
+}
+
+hvmm_status_t vgic_save_status(struct vgic_status *status, vcpuid_t vmid)
 {
     hvmm_status_t result = HVMM_STATUS_SUCCESS;
     int i;
     for (i = 0; i < _vgic.num_lr; i++)
-        status->lr[i] = _vgic.base[GICH_LR + i];
+        status->lr[i] = vgic_unlink_ppi(vmid, i, _vgic.base[GICH_LR + i]);
     status->hcr = _vgic.base[GICH_HCR];
     status->apr = _vgic.base[GICH_APR];
     status->vmcr = _vgic.base[GICH_VMCR];
@@ -673,6 +1139,8 @@ hvmm_status_t vgic_restore_status(struct vgic_status *status, vcpuid_t vmid)
     _vgic.base[GICH_APR] = status->apr;
     _vgic.base[GICH_VMCR] = status->vmcr;
     _vgic.base[GICH_HCR] = status->hcr;
+    /* Pick up virqs posted by the other CPUs */
+    virq_mailbox_drain();
     /* Inject queued virqs to the next guest */
     /*
      * Staying at the currently active guest.
@@ -693,12 +1161,19 @@ hvmm_status_t vgic_sgi(uint32_t cpu, enum gic_sgi sgi)
     vcpuid_t vmid;
     vmid = guest_current_vmid();
 
-    if(cpu != vmid)
+    if (cpu != smp_processor_id())
         return result;
 
     switch(sgi) {
         case GIC_SGI_SLOT_CHECK:
-            result = vgic_flush_virqs(vmid);
+            virq_mailbox_drain();
+            result = HVMM_STATUS_SUCCESS;
+            if (vmid != VMID_INVALID)
+                result = vgic_flush_virqs(vmid);
+            break;
+        case GIC_SGI_PROFILE:
+            profile_sync();
+            result = HVMM_STATUS_SUCCESS;
             break;
         default:
             printh("sgi: wrong sgi %d\n", sgi);
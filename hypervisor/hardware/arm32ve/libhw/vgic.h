@@ -47,7 +47,11 @@ hvmm_status_t vgic_init(void);
  * @return          Always returns "success".
  */
 hvmm_status_t vgic_init_status(struct vgic_status *status, vcpuid_t vmid);
-hvmm_status_t vgic_save_status(struct vgic_status *status);
+/**
+ * @brief   Saves the Virtual Interface Control state of a guest being
+ *          switched out. HW-linked PPIs are turned into software virqs.
+ */
+hvmm_status_t vgic_save_status(struct vgic_status *status, vcpuid_t vmid);
 hvmm_status_t vgic_restore_status(struct vgic_status *status, vcpuid_t vmid);
 hvmm_status_t vgic_flush_virqs(vcpuid_t vmid);
 /* returns slot index if successful, VGIC_SLOT_NOTFOUND otherwise */
@@ -80,6 +84,24 @@ void vgic_slotvirq_clear(vcpuid_t vmid, uint32_t slot);
 
 hvmm_status_t virq_inject(vcpuid_t vmid, uint32_t virq,
         uint32_t pirq, uint8_t hw);
+/**
+ * @brief           Sends a virtual SGI to a guest.
+ *
+ * The SGI stays pending per source until the guest EOIs it; while a
+ * source is in flight, sends from other sources are only recorded.
+ * @param source    Source vCPU, reported in GICC_IAR.CPUID.
+ */
+hvmm_status_t virq_inject_sgi(vcpuid_t vmid, uint32_t sgi, uint32_t source);
+/**
+ * @brief   Returns 1 if 'virq' is queued to 'vmid' or sits in one of its
+ *          List Registers, not yet retired.
+ */
+uint8_t virq_is_pending(vcpuid_t vmid, uint32_t virq);
+/**
+ * @brief   Returns pending sources of a virtual SGI, one bit per source.
+ */
+uint8_t virq_sgi_pending(vcpuid_t vmid, uint32_t sgi);
+void virq_sgi_clear(vcpuid_t vmid, uint32_t sgi, uint8_t sources);
 /**
  * @brief   Initializes virq_entry structure and
             Sets callback function about injection of queued VIRQs.
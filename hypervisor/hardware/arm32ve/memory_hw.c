@@ -1325,6 +1325,89 @@ static hvmm_status_t memory_hw_dump(void)
     return HVMM_STATUS_SUCCESS;
 }
 
+/**
+ * @brief Translates a guest IPA range by its memory map descriptors.
+ *
+ * Each entry of the guest's descriptor list maps one 1GB region of the
+ * IPA space, the va of a descriptor is an offset within the region.
+ *
+ * @param vmid Guest of the IPA.
+ * @param ipa Intermediate physical address.
+ * @param size Size of the range, it must be mapped by one descriptor.
+ * @return Physical address, 0 if the range is not mapped.
+ */
+static uint32_t memory_hw_ipa_to_pa(vcpuid_t vmid, uint32_t ipa,
+        uint32_t size)
+{
+    struct memmap_desc **mdlist;
+    struct memmap_desc *md;
+    uint32_t region = ipa >> 30;
+    uint32_t offset = ipa & 0x3FFFFFFF;
+    uint32_t i;
+
+    if (vmid >= NUM_GUESTS_STATIC || !vcpu_arr[vmid].memmap_desc)
+        return 0;
+
+    mdlist = vcpu_arr[vmid].memmap_desc;
+    for (i = 0; i < region; i++) {
+        if (!mdlist[i])
+            return 0;
+    }
+
+    for (md = mdlist[region]; md && md->label != 0; md++) {
+        if (offset >= md->va && size <= md->size &&
+                offset - md->va <= md->size - size)
+            return (uint32_t)md->pa + (offset - (uint32_t)md->va);
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Maps a physical range into the stage-2 translation of a guest.
+ *
+ * The level 2 table of a 1GB region without memory map descriptors is
+ * left invalid by guest_memory_init_ttbl(), it is initialized at its
+ * first mapping. Stale stage-2 TLB entries are invalidated on all cpus.
+ *
+ * @param vmid Target guest.
+ * @param ipa Intermediate physical address, page aligned.
+ * @param pa Physical address, page aligned.
+ * @param size Size of the range, page aligned, within one 1GB region.
+ * @param attr Memory attribute.
+ * @return HVMM_STATUS_SUCCESS, or HVMM_STATUS_BAD_ACCESS for a bad range.
+ */
+static hvmm_status_t memory_hw_map(vcpuid_t vmid, uint32_t ipa, uint32_t pa,
+        uint32_t size, enum memattr attr)
+{
+    union lpaed *ttbl;
+    union lpaed *ttbl2;
+    uint32_t region = ipa >> 30;
+    uint32_t offset = ipa & 0x3FFFFFFF;
+
+    if (vmid >= NUM_GUESTS_STATIC || !size ||
+            ((ipa | pa | size) & (LPAE_PAGE_SIZE - 1)) ||
+            size > 0x40000000 - offset)
+        return HVMM_STATUS_BAD_ACCESS;
+
+    ttbl = vcpu_arr[vmid].vttbr;
+    ttbl2 = TTBL_L2(ttbl, region);
+    if (!ttbl[region].p2m.valid) {
+        guest_memory_ttbl2_init_entries(ttbl2);
+        guest_memory_ttbl2_unmap(ttbl2, 0x00000000, 0x40000000);
+        lpaed_guest_stage2_conf_l1_table(&ttbl[region],
+                (uint64_t)((uint32_t) ttbl2), 1);
+    }
+    guest_memory_ttbl2_map(ttbl2, offset, pa, size, attr);
+
+    asm volatile("dsb");
+    invalidate_nsnh_tlb_is(0);
+    asm volatile("dsb");
+    asm volatile("isb");
+
+    return HVMM_STATUS_SUCCESS;
+}
+
 struct memory_ops _memory_ops = {
     .init = memory_hw_init,
     .alloc = memory_hw_alloc,
@@ -1332,6 +1415,8 @@ struct memory_ops _memory_ops = {
     .save = memory_hw_save,
     .restore = memory_hw_restore,
     .dump = memory_hw_dump,
+    .ipa_to_pa = memory_hw_ipa_to_pa,
+    .map = memory_hw_map,
 };
 
 struct memory_module _memory_module = {
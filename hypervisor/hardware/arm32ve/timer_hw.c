@@ -140,7 +140,7 @@ static inline uint64_t generic_timer_reg_read64(int reg)
         val = read_cnthp_cval();
         break;
     case GENERIC_TIMER_REG_PHYS_CVAL:
-        val = read_cntp_tval();
+        val = read_cntp_cval();
         break;
     case GENERIC_TIMER_REG_VIRT_CVAL:
         val = read_cntv_cval();
@@ -179,6 +179,28 @@ static hvmm_status_t generic_timer_set_tval(enum generic_timer_type timer_type,
     return result;
 }
 
+/** @brief Configures the absolute expiry by the CompareValue register of
+ *  the PL2 (CNTHP_CVAL) or the PL1 (CNTP_CVAL) physical timer.
+ *
+ *  The timer fires once the physical count reaches 'cval'. Unlike TVAL,
+ *  the expiry does not depend on when it is written.
+ */
+static hvmm_status_t generic_timer_set_cval(enum generic_timer_type timer_type,
+        uint64_t cval)
+{
+    hvmm_status_t result = HVMM_STATUS_UNSUPPORTED_FEATURE;
+
+    if (timer_type == GENERIC_TIMER_HYP) {
+        generic_timer_reg_write64(GENERIC_TIMER_REG_HYP_CVAL, cval);
+        result = HVMM_STATUS_SUCCESS;
+    } else if (timer_type == GENERIC_TIMER_NSP) {
+        generic_timer_reg_write64(GENERIC_TIMER_REG_PHYS_CVAL, cval);
+        result = HVMM_STATUS_SUCCESS;
+    }
+
+    return result;
+}
+
 /** @brief Enables the timer interrupt such as hypervisor timer event
  *  by PL2 Physical Timer Control register(VMSA : CNTHP_CTL)
  *  The Timer output signal is not masked.
@@ -249,6 +271,37 @@ static hvmm_status_t timer_set_tval(uint64_t tval)
     return generic_timer_set_tval(GENERIC_TIMER_HYP, tval);
 }
 
+static hvmm_status_t timer_set_cval(uint64_t cval)
+{
+    return generic_timer_set_cval(GENERIC_TIMER_HYP, cval);
+}
+
+/** @brief Saves the guest's virtual timer, then stops it so that it does
+ *  not fire while another guest is running.
+ */
+static hvmm_status_t generic_timer_vtimer_save(struct vtimer_context *vtimer)
+{
+    vtimer->ctl = generic_timer_reg_read(GENERIC_TIMER_REG_VIRT_CTRL);
+    vtimer->cval = generic_timer_reg_read64(GENERIC_TIMER_REG_VIRT_CVAL);
+    vtimer->offset = generic_timer_reg_read64(GENERIC_TIMER_REG_VIRT_OFF);
+    generic_timer_reg_write(GENERIC_TIMER_REG_VIRT_CTRL, 0);
+
+    return HVMM_STATUS_SUCCESS;
+}
+
+/** @brief Loads the guest's virtual timer. CNTVOFF goes first, so that
+ *  CVAL is compared against the guest's own virtual count.
+ */
+static hvmm_status_t generic_timer_vtimer_restore(
+        struct vtimer_context *vtimer)
+{
+    generic_timer_reg_write64(GENERIC_TIMER_REG_VIRT_OFF, vtimer->offset);
+    generic_timer_reg_write64(GENERIC_TIMER_REG_VIRT_CVAL, vtimer->cval);
+    generic_timer_reg_write(GENERIC_TIMER_REG_VIRT_CTRL,
+            vtimer->ctl & ~GENERIC_TIMER_CTRL_ISTATUS);
+
+    return HVMM_STATUS_SUCCESS;
+}
 
 /** @brief dump at time.
  *  @todo have to write dump with meaningful printing.
@@ -264,7 +317,10 @@ struct timer_ops _timer_ops = {
     .enable = timer_enable,
     .disable = timer_disable,
     .set_interval = timer_set_tval,
+    .set_cval = timer_set_cval,
     .dump = timer_dump,
+    .vtimer_save = generic_timer_vtimer_save,
+    .vtimer_restore = generic_timer_vtimer_restore,
 };
 
 struct timer_module _timer_module = {
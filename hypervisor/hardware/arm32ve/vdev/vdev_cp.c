@@ -4,6 +4,7 @@
 #include <trap.h>
 #include <vdev.h>
 #include <armv7_p15.h>
+#include <pmu.h>
 
 /* Common in EC, HSR[31:30] zero */
 #define EC_ZERO_CV_BIT 0x01000000
@@ -189,6 +190,44 @@ void emulate_wfi_wfe(unsigned int iss, unsigned int il)
 
 }
 
+/*
+ * Emulates the trapped MCR/MRC accesses to CP15 that have a virtual
+ * device, the Performance Monitors; the others are only reported.
+ */
+static int32_t vdev_cp_mcr_mrc_cp15(struct arch_vdev_trigger_info *info,
+                        struct arch_regs *regs)
+{
+    unsigned int iss = info->iss;
+    unsigned int Opc2, Opc1, CRn, Rt, CRm, dir;
+    uint32_t value;
+
+    dir = (iss & MCR_MRC_DIRECTION_BIT);
+    Opc2 = (iss & MCR_MRC_OPC2_BIT) >> MCR_MRC_OPC2_SHIFT;
+    Opc1 = (iss & MCR_MRC_OPC1_BIT) >> MCR_MRC_OPC1_SHIFT;
+    CRn = (iss & MCR_MRC_CRN_BIT) >> MCR_MRC_CRN_SHIFT;
+    Rt = (iss & MCR_MRC_RT_BIT) >> MCR_MRC_RT_SHIFT;
+    CRm = (iss & MCR_MRC_CRM_BIT) >> MCR_MRC_CRM_SHIFT;
+
+    /* Performance Monitors, trapped by HDCR.TPM and HDCR.TPMCR */
+    if (CRn == 9 && Opc1 == 0 && CRm >= 12) {
+        if (Rt >= ARCH_REGS_NUM_GPR) {
+            printh("vdev_cp: PMU access through r%d ignored\n", Rt);
+            return 0;
+        }
+        /* MCR writes the register, MRC reads it */
+        value = regs->gpr[Rt];
+        if (vdev_pmu_access(CRm, Opc2, &value, !dir) == HVMM_STATUS_SUCCESS) {
+            regs->gpr[Rt] = value;
+            return 0;
+        }
+    }
+
+    printh("Trapped MCR or MRC access to CP15: 0x%08x\n", read_hsr());
+    emulate_mcr_mrc_cp15(iss, 0);
+
+    return 0;
+}
+
 static int32_t vdev_cp_read(struct arch_vdev_trigger_info *info,
                         struct arch_regs *regs)
 {
@@ -203,8 +242,8 @@ static int32_t vdev_cp_read(struct arch_vdev_trigger_info *info,
         printh("Trapped WFI or WFE instruction: 0x%08x\n", hsr);
         break;
     case TRAP_EC_ZERO_MCR_MRC_CP15:
-        printh("Trapped MCR or MRC access to CP15: 0x%08x\n", hsr);
-        break;
+        /* ISS has no WnR for MCR/MRC, both directions come either way */
+        return vdev_cp_mcr_mrc_cp15(info, regs);
     case TRAP_EC_ZERO_MCRR_MRRC_CP15:
         printh("Trapped MCRR or MRRC access to CP15: 0x%08x\n", hsr);
         break;
@@ -250,8 +289,8 @@ static int32_t vdev_cp_write(struct arch_vdev_trigger_info *info,
         printh("Trapped WFI or WFE instruction: 0x%08x\n", hsr);
         break;
     case TRAP_EC_ZERO_MCR_MRC_CP15:
-        printh("Trapped MCR or MRC access to CP15: 0x%08x\n", hsr);
-        break;
+        /* ISS has no WnR for MCR/MRC, both directions come either way */
+        return vdev_cp_mcr_mrc_cp15(info, regs);
     case TRAP_EC_ZERO_MCRR_MRRC_CP15:
         printh("Trapped MCRR or MRRC access to CP15: 0x%08x\n", hsr);
         break;
@@ -288,7 +327,8 @@ static int32_t vdev_cp_post(struct arch_vdev_trigger_info *info,
 {
     uint8_t isize = 4;
 
-    if (regs->cpsr & 0x20) /* Thumb */
+    /* A trapped instruction may be a 32-bit Thumb one, e.g. MCR */
+    if (!(read_hsr() & HSR_IL_BIT))
         isize = 2;
 
     regs->pc += isize;
@@ -2,6 +2,7 @@
 #include <gic_regs.h>
 #include <vdev.h>
 #include <asm-arm_inline.h>
+#include <stddef.h>
 
 #define DEBUG
 #include <log/print.h>
@@ -22,11 +23,18 @@
 /* Priority of implementation
  - [V] CTLR, TYPER
  - [V] ICFGR
- - [V] ITARGETSR
+ - [V] ITARGETSR (SPIs are routed to the CPU hosting the vCPU)
  - [V] IPRIORITYR
  - [V] ISCENABLER
+ - [V] ISCPENDR, ISCACTIVER
+ - [V] SGIR, CPENDSGIR, SPENDSGIR (virtual SGIs, pending per source)
  -----------------------
- - [ ]
+ - [ ] PPISPISR, NSACR
+
+ Accesses are dispatched through _vgicd_regs[]: a register file is
+ described once (storage, banked words, set/clear semantics) and handled
+ by one byte/halfword/word read-modify-write helper. Registers with side
+ effects hook a 'changed' callback.
  */
 
 /* hard coding for arndale, fastmodel */
@@ -50,8 +58,6 @@
 
 #define VGICD_BANKED_NUM_IPRIORITYR  8
 #define VGICD_BANKED_NUM_ITARGETSR  8
-#define VGICD_BANKED_NUM_CPENDSGIR  VGICE_NUM_CPENDSGIR
-#define VGICD_BANKED_NUM_SPENDSGIR  VGICD_NUM_SPENDSGIR
 
 struct gicd_regs {
     uint32_t CTLR; /*0x000 RW*/
@@ -87,144 +93,270 @@ struct gicd_regs_banked
     uint32_t IPRIORITYR[VGICD_BANKED_NUM_IPRIORITYR];   //0~7
     uint32_t ITARGETSR[VGICD_BANKED_NUM_ITARGETSR]; //0~7
     uint32_t ICFGR; //1
-    uint32_t CPENDSGIR[VGICD_BANKED_NUM_CPENDSGIR]; //n
 };
 
-struct gicd_handler_entry {
-    uint32_t offset;
+/* Access semantics of a register file */
+enum vgicd_reg_type {
+    VGICD_REG_RW = 0,   /* read/write */
+    VGICD_REG_RO,       /* writes are ignored */
+    VGICD_REG_SET,      /* writing 1 sets a bit, e.g. ISENABLER */
+    VGICD_REG_CLEAR,    /* writing 1 clears a bit, e.g. ICENABLER */
+};
+
+/* Allowed access sizes, indexed by enum vdev_access_size */
+#define VGICD_ACCESS_WORD   (1 << VDEV_ACCESS_WORD)
+#define VGICD_ACCESS_ALL    ((1 << VDEV_ACCESS_BYTE) | \
+                             (1 << VDEV_ACCESS_HWORD) | \
+                             (1 << VDEV_ACCESS_WORD))
+
+#define VGICD_NO_STORAGE    0xFFFF
+#define VGICD_REG_NONE      0xFF
+
+/*
+ * Called after a write changed the word 'index' of a register file,
+ * 'old' and 'new' are the whole 32bit word.
+ */
+typedef void (*vgicd_changed_t)(vcpuid_t vmid, uint32_t index,
+        uint32_t old, uint32_t new);
+
+/**
+ * @brief   Describes one GICD register file.
+ *
+ * Words [banked_first, banked_first + banked_num) live in
+ * struct gicd_regs_banked at 'banked', the others in struct gicd_regs at
+ * 'storage', indexed by the word index within the register file.
+ */
+struct vgicd_reg_desc {
+    uint16_t offset;        /**< Byte offset of the first word */
+    uint16_t num;           /**< Number of words */
+    uint16_t storage;       /**< offsetof() in struct gicd_regs */
+    uint16_t banked;        /**< offsetof() in struct gicd_regs_banked */
+    uint8_t banked_first;
+    uint8_t banked_num;
+    uint8_t type;           /**< enum vgicd_reg_type */
+    uint8_t sizes;          /**< VGICD_ACCESS_* */
+    /** Banked words are read-only, e.g. ITARGETSR0~7 */
+    uint8_t banked_ro;
+    /** Side effect of a changed word, may be NULL */
+    vgicd_changed_t changed;
+    /** Registers that are not plain storage, overrides everything else */
     vdev_callback_t handler;
 };
 
-static hvmm_status_t
-handler_000(uint32_t write, uint32_t offset, uint32_t *pvalue,
-        enum vdev_access_size access_size);
-static hvmm_status_t
-handler_ISCENABLER(uint32_t write, uint32_t offset, uint32_t *pvalue,
-        enum vdev_access_size access_size);
-static hvmm_status_t
-handler_ISCPENDR(uint32_t write, uint32_t offset, uint32_t *pvalue,
-        enum vdev_access_size access_size);
-static hvmm_status_t
-handler_ISCACTIVER(uint32_t write, uint32_t offset, uint32_t *pvalue,
-        enum vdev_access_size access_size);
-static hvmm_status_t
-handler_IPRIORITYR(uint32_t write, uint32_t offset, uint32_t *pvalue,
-        enum vdev_access_size access_size);
-static hvmm_status_t
-handler_ITARGETSR(uint32_t write, uint32_t offset, uint32_t *pvalue,
-        enum vdev_access_size access_size);
-static hvmm_status_t
-handler_ICFGR(uint32_t write, uint32_t offset, uint32_t *pvalue,
-        enum vdev_access_size access_size);
-static hvmm_status_t
-handler_PPISPISR_CA15(uint32_t write, uint32_t offset,
+#define GICD_REG_OFFSET(member)     offsetof(struct gicd_regs, member)
+#define GICD_BANKED_OFFSET(member)  offsetof(struct gicd_regs_banked, member)
+
+static void vgicd_changed_istatus(vcpuid_t vmid, uint32_t index,
+        uint32_t old, uint32_t istatus);
+static void vgicd_changed_itargets(vcpuid_t vmid, uint32_t index,
+        uint32_t old, uint32_t targets);
+static hvmm_status_t handler_SGIR(uint32_t write, uint32_t offset,
+        uint32_t *pvalue, enum vdev_access_size access_size);
+static hvmm_status_t handler_PENDSGIR(uint32_t write, uint32_t offset,
         uint32_t *pvalue, enum vdev_access_size access_size);
-static hvmm_status_t
-handler_NSACR(uint32_t write, uint32_t offset, uint32_t *pvalue,
-        enum vdev_access_size access_size);
-static hvmm_status_t
-handler_F00(uint32_t write, uint32_t offset, uint32_t *pvalue,
-        enum vdev_access_size access_size);
 
 static struct vdev_memory_map _vdev_gicd_info = { .base =
         CFG_GIC_BASE_PA | GIC_OFFSET_GICD, .size = 4096, };
 static struct gicd_regs _regs[NUM_GUESTS_STATIC];
 static struct gicd_regs_banked _regs_banked[NUM_GUESTS_STATIC];
-
-static struct gicd_handler_entry _handler_map[0x10] = {
-/* 0x00 ~ 0x0F */
-{ 0x00, handler_000 }, /* CTLR, TYPER, IIDR, IGROUPR */
-{ 0x01, handler_ISCENABLER }, /* ISENABLER, ICENABLER */
-{ 0x02, handler_ISCPENDR }, /* ISPENDR, ICPENDR */
-{ 0x03, handler_ISCACTIVER }, /* ISACTIVER */
-{ 0x04, handler_IPRIORITYR }, /* IPRIORITYR */
-{ 0x05, handler_IPRIORITYR }, { 0x06, handler_IPRIORITYR }, { 0x07,
-        handler_IPRIORITYR }, { 0x08, handler_ITARGETSR }, /* ITARGETSR */
-{ 0x09, handler_ITARGETSR }, { 0x0A, handler_ITARGETSR }, { 0x0B,
-        handler_ITARGETSR }, { 0x0C, handler_ICFGR }, /* ICFGR */
-{ 0x0D, handler_PPISPISR_CA15 }, /* PPISPISR */
-{ 0x0E, handler_NSACR }, /* NSACR */
-{ 0x0F, handler_F00 }, /* SGIR, CPENDSGIR, SPENDGIR, ICPIDR2 */
+/* Physical CPU the SPIs of a guest are currently routed to */
+static uint32_t _vgicd_route_cpu[NUM_GUESTS_STATIC];
+
+static const struct vgicd_reg_desc _vgicd_regs[] = {
+    { GICD_OFFSET_CTLR, 1, GICD_REG_OFFSET(CTLR), VGICD_NO_STORAGE,
+        0, 0, VGICD_REG_RW, VGICD_ACCESS_WORD, 0, 0, 0 },
+    { GICD_OFFSET_TYPER, 1, GICD_REG_OFFSET(TYPER), VGICD_NO_STORAGE,
+        0, 0, VGICD_REG_RO, VGICD_ACCESS_WORD, 0, 0, 0 },
+    { GICD_OFFSET_IIDR, 1, GICD_REG_OFFSET(IIDR), VGICD_NO_STORAGE,
+        0, 0, VGICD_REG_RO, VGICD_ACCESS_WORD, 0, 0, 0 },
+    { GICD_OFFSET_IGROUPR, VGICD_NUM_IGROUPR, GICD_REG_OFFSET(IGROUPR),
+        GICD_BANKED_OFFSET(IGROUPR),
+        0, 1, VGICD_REG_RW, VGICD_ACCESS_WORD, 0, 0, 0 },
+    { GICD_OFFSET_ISENABLER, VGICD_NUM_IENABLER,
+        GICD_REG_OFFSET(ISCENABLER), GICD_BANKED_OFFSET(ISCENABLER),
+        0, 1, VGICD_REG_SET, VGICD_ACCESS_ALL, 0,
+        vgicd_changed_istatus, 0 },
+    { GICD_OFFSET_ICENABLER, VGICD_NUM_IENABLER,
+        GICD_REG_OFFSET(ISCENABLER), GICD_BANKED_OFFSET(ISCENABLER),
+        0, 1, VGICD_REG_CLEAR, VGICD_ACCESS_ALL, 0,
+        vgicd_changed_istatus, 0 },
+    { GICD_OFFSET_ISPENDR, VGICE_NUM_ISCPENDR, GICD_REG_OFFSET(ISCPENDR),
+        GICD_BANKED_OFFSET(ISCPENDR),
+        0, 1, VGICD_REG_SET, VGICD_ACCESS_ALL, 0, 0, 0 },
+    { GICD_OFFSET_ICPENDR, VGICE_NUM_ISCPENDR, GICD_REG_OFFSET(ISCPENDR),
+        GICD_BANKED_OFFSET(ISCPENDR),
+        0, 1, VGICD_REG_CLEAR, VGICD_ACCESS_ALL, 0, 0, 0 },
+    { GICD_OFFSET_ISCACTIVER, VGICE_NUM_ISCACTIVER,
+        GICD_REG_OFFSET(ISCACTIVER), GICD_BANKED_OFFSET(ISCACTIVER),
+        0, 1, VGICD_REG_SET, VGICD_ACCESS_ALL, 0, 0, 0 },
+    { GICD_OFFSET_ICACTIVER, VGICE_NUM_ISCACTIVER,
+        GICD_REG_OFFSET(ISCACTIVER), GICD_BANKED_OFFSET(ISCACTIVER),
+        0, 1, VGICD_REG_CLEAR, VGICD_ACCESS_ALL, 0, 0, 0 },
+    { GICD_OFFSET_IPRIORITYR, VGICE_NUM_IPRIORITYR,
+        GICD_REG_OFFSET(IPRIORITYR), GICD_BANKED_OFFSET(IPRIORITYR),
+        0, VGICD_BANKED_NUM_IPRIORITYR, VGICD_REG_RW, VGICD_ACCESS_ALL, 0,
+        0, 0 },
+    { GICD_OFFSET_ITARGETSR, VGICE_NUM_ITARGETSR,
+        GICD_REG_OFFSET(ITARGETSR), GICD_BANKED_OFFSET(ITARGETSR),
+        0, VGICD_BANKED_NUM_ITARGETSR, VGICD_REG_RW, VGICD_ACCESS_ALL, 1,
+        vgicd_changed_itargets, 0 },
+    { GICD_OFFSET_ICFGR, VGICE_NUM_ICFGR, GICD_REG_OFFSET(ICFGR),
+        GICD_BANKED_OFFSET(ICFGR),
+        1, 1, VGICD_REG_RW, VGICD_ACCESS_WORD, 0, 0, 0 },
+    { GICD_OFFSET_SGIR, 1, VGICD_NO_STORAGE, VGICD_NO_STORAGE,
+        0, 0, VGICD_REG_RW, VGICD_ACCESS_WORD, 0, 0, handler_SGIR },
+    { GICD_OFFSET_CPENDSGIR, 4, VGICD_NO_STORAGE, VGICD_NO_STORAGE,
+        0, 0, VGICD_REG_CLEAR, VGICD_ACCESS_ALL, 0, 0, handler_PENDSGIR },
+    { GICD_OFFSET_SPENDSGIR, 4, VGICD_NO_STORAGE, VGICD_NO_STORAGE,
+        0, 0, VGICD_REG_SET, VGICD_ACCESS_ALL, 0, 0, handler_PENDSGIR },
 };
 
-/* old status */
-static uint32_t old_vgicd_status[NUM_GUESTS_STATIC][NUM_STATUS_WORDS]
-    = { { 0, }, };
+#define VGICD_NUM_REG_DESCS \
+    (sizeof(_vgicd_regs) / sizeof(struct vgicd_reg_desc))
+
+/* Word offset -> index of _vgicd_regs[], built at init */
+static uint8_t _vgicd_reg_map[4096 / 4];
+
+static void vgicd_reg_map_init(void)
+{
+    int i, j;
+
+    for (i = 0; i < (4096 / 4); i++)
+        _vgicd_reg_map[i] = VGICD_REG_NONE;
+
+    for (i = 0; i < VGICD_NUM_REG_DESCS; i++) {
+        for (j = 0; j < _vgicd_regs[i].num; j++)
+            _vgicd_reg_map[(_vgicd_regs[i].offset >> 2) + j] = i;
+    }
+}
+
 /*
-static uint32_t old_vgicd_status_pervcpu[NUM_VCPU_STATIC] = {0, };
-static uint32_t old_vgicd_status_perguest[NUM_GUESTS_STATIC][NUM_STATUS_WORDS-1]
-    = { { 0, }, };
-*/
+ * Returns the storage of the word 'index' of a register file,
+ * or NULL if it has none.
+ */
+static uint32_t *vgicd_reg_word(const struct vgicd_reg_desc *desc,
+        vcpuid_t vmid, uint32_t index)
+{
+    uint8_t *base;
 
-static hvmm_status_t handler_000(uint32_t write, uint32_t offset,
-        uint32_t *pvalue, enum vdev_access_size access_size)
+    if (index >= desc->banked_first &&
+            index < (desc->banked_first + desc->banked_num)) {
+        base = (uint8_t *) &_regs_banked[vmid] + desc->banked;
+        return (uint32_t *) base + (index - desc->banked_first);
+    }
+    if (desc->storage == VGICD_NO_STORAGE)
+        return 0;
+
+    base = (uint8_t *) &_regs[vmid] + desc->storage;
+    return (uint32_t *) base + index;
+}
+
+/*
+ * Generic byte/halfword/word read-modify-write of a register file.
+ */
+static hvmm_status_t vgicd_reg_access(const struct vgicd_reg_desc *desc,
+        vcpuid_t vmid, uint32_t write, uint32_t offset, uint32_t *pvalue,
+        enum vdev_access_size access_size)
 {
-    /* CTLR;              0x000 RW*/
-    /* TYPER;             RO*/
-    /* IIDR;              RO*/
-    /* IGROUPR[32];       0x080 ~ 0x0FF */
-    hvmm_status_t result = HVMM_STATUS_BAD_ACCESS;
-    vcpuid_t vmid = guest_current_vmid();
-    struct gicd_regs *regs = &_regs[vmid];
-    struct gicd_regs_banked *regs_banked = &_regs_banked[vmid];
-    uint32_t woffset = offset / 4;
-    switch (woffset) {
-    case GICD_CTLR: /* RW */
-        if (write)
-            regs->CTLR = *pvalue;
-        else
-            *pvalue = regs->CTLR;
-        result = HVMM_STATUS_SUCCESS;
-        break;
-    case GICD_TYPER: /* RO */
-        if (write == 0) {
-            *pvalue = regs->TYPER;
-            result = HVMM_STATUS_SUCCESS;
-        }
+    uint32_t index = (offset - desc->offset) >> 2;
+    uint32_t shift = (offset & 0x3) * 8;
+    uint32_t mask;
+    uint32_t value;
+    uint32_t old;
+    uint32_t new;
+    uint32_t *preg;
+
+    if (!(desc->sizes & (1 << access_size)))
+        return HVMM_STATUS_BAD_ACCESS;
+    /* Unaligned accesses are not allowed by the GIC */
+    if (offset & ((1 << access_size) - 1))
+        return HVMM_STATUS_BAD_ACCESS;
+
+    preg = vgicd_reg_word(desc, vmid, index);
+    if (!preg)
+        return HVMM_STATUS_BAD_ACCESS;
+
+    mask = (access_size == VDEV_ACCESS_WORD) ? 0xFFFFFFFF :
+            (((1 << (8 << access_size)) - 1) << shift);
+    old = *preg;
+    if (!write) {
+        *pvalue = (old & mask) >> shift;
+        return HVMM_STATUS_SUCCESS;
+    }
+
+    if (desc->type == VGICD_REG_RO || (desc->banked_ro &&
+            index >= desc->banked_first &&
+            index < (desc->banked_first + desc->banked_num)))
+        return HVMM_STATUS_SUCCESS;
+
+    value = (*pvalue << shift) & mask;
+    switch (desc->type) {
+    case VGICD_REG_SET:
+        new = old | value;
         break;
-    case GICD_IIDR: /* RO */
-        if (write == 0) {
-            *pvalue = regs->IIDR;
-            result = HVMM_STATUS_SUCCESS;
-        }
+    case VGICD_REG_CLEAR:
+        new = old & ~value;
         break;
-    default: { /* RW GICD_IGROUPR */
-        int igroup = woffset - GICD_IGROUPR;
-        if ((igroup == 0) && (igroup < VGICD_NUM_IGROUPR)) {
-            if (write)
-                regs_banked->IGROUPR = *pvalue;
-            else
-                *pvalue = regs_banked->IGROUPR;
-
-            result = HVMM_STATUS_SUCCESS;
-        } else if ((igroup > 0) && (igroup < VGICD_NUM_IGROUPR)) {
-            if (write)
-                regs->IGROUPR[igroup] = *pvalue;
-            else
-                *pvalue = regs->IGROUPR[igroup];
-
-            result = HVMM_STATUS_SUCCESS;
-        }
-    }
+    default:
+        new = (old & ~mask) | value;
         break;
     }
-    if (result != HVMM_STATUS_SUCCESS)
-        printH("vgicd: invalid access offset:%x write:%d\n", offset,
-                write);
+    if (new == old)
+        return HVMM_STATUS_SUCCESS;
 
-    return result;
+    *preg = new;
+    if (desc->changed)
+        desc->changed(vmid, index, old, new);
+
+    return HVMM_STATUS_SUCCESS;
+}
+
+/*
+ * Routes the pirq behind a guest SPI to the physical CPU hosting the
+ * vCPUs named by its virtual ITARGETSR byte. A guest has a single vCPU,
+ * the virtual CPU interface 0.
+ */
+static void vgicd_route_spi(vcpuid_t vmid, uint32_t virq)
+{
+    uint8_t targets;
+    uint8_t cpumask = 0;
+    uint32_t pirq;
+
+    if (virq < 32 || virq >= VGICE_NUM_ITARGETSR * 4)
+        return;
+
+    pirq = interrupt_virq_to_pirq(vmid, virq);
+    if (pirq == PIRQ_INVALID)
+        return;
+
+    targets = ((uint8_t *) _regs[vmid].ITARGETSR)[virq];
+    if (targets & 0x1)
+        cpumask = 1 << _vgicd_route_cpu[vmid];
+    interrupt_host_set_target(pirq, cpumask);
 }
 
-static void vgicd_changed_istatus(vcpuid_t vmid, uint32_t istatus,
-        uint8_t word_offset)
+static void vgicd_changed_itargets(vcpuid_t vmid, uint32_t index,
+        uint32_t old, uint32_t targets)
+{
+    uint32_t cbytes = old ^ targets;
+    int i;
+
+    for (i = 0; i < 4; i++) {
+        if (cbytes & (0xFF << (i * 8)))
+            vgicd_route_spi(vmid, index * 4 + i);
+    }
+}
+
+static void vgicd_changed_istatus(vcpuid_t vmid, uint32_t index,
+        uint32_t old, uint32_t istatus)
 {
     uint32_t cstatus; /* changed bits only */
     uint32_t minirq;
     int bit;
     /* irq range: 0~31 + word_offset * size_of_istatus_in_bits */
-    minirq = word_offset * 32;
+    minirq = index * 32;
     /* find changed bits */
-    cstatus = old_vgicd_status[vmid][word_offset] ^ istatus;
+    cstatus = old ^ istatus;
     while (cstatus) {
         uint32_t virq;
         uint32_t pirq;
@@ -237,6 +369,7 @@ static void vgicd_changed_istatus(vcpuid_t vmid, uint32_t istatus,
                 printh("[%s : %d] enabled irq num is %d\n", __func__,
                         __LINE__, bit + minirq);
                 interrupt_host_configure(pirq);
+                vgicd_route_spi(vmid, virq);
                 interrupt_guest_enable(vmid, pirq);
             } else {
                 printh("[%s : %d] disabled irq num is %d\n", __func__,
@@ -249,369 +382,120 @@ static void vgicd_changed_istatus(vcpuid_t vmid, uint32_t istatus,
         }
         cstatus &= ~(1 << bit);
     }
-    old_vgicd_status[vmid][word_offset] = istatus;
 }
 
-static hvmm_status_t handler_ISCENABLER(uint32_t write,
-        uint32_t offset, uint32_t *pvalue,
-        enum vdev_access_size access_size)
-{
-    hvmm_status_t result = HVMM_STATUS_BAD_ACCESS;
-    vcpuid_t vmid = guest_current_vmid();
-    struct gicd_regs *regs = &_regs[vmid];
-    struct gicd_regs_banked *regs_banked = &_regs_banked[vmid];
-    uint32_t *preg_s;
-    uint32_t *preg_c;
-    if (write && *pvalue == 0) {
-        /* Writes 0 -> Has no effect. */
-        result = HVMM_STATUS_SUCCESS;
-        return result;
-    }
-    if (((offset >> 2) - GICD_ISENABLER) == 0 ||
-        ((offset >> 2) - GICD_ICENABLER) == 0) {
-        preg_s = &(regs_banked->ISCENABLER);
-        preg_c = &(regs_banked->ISCENABLER);
-    } else {
-        preg_s = &(regs->ISCENABLER[(offset >> 2) - GICD_ISENABLER]);
-        preg_c = &(regs->ISCENABLER[(offset >> 2) - GICD_ICENABLER]);
-    }
-    if (access_size == VDEV_ACCESS_WORD) {
-        if ((offset >> 2) < (GICD_ISENABLER + VGICD_NUM_IENABLER)) {
-            /* ISENABLER */
-            if (write) {
-                *preg_s |= *pvalue;
-                vgicd_changed_istatus(vmid, *preg_s,
-                        (offset >> 2) - GICD_ISENABLER);
-            } else
-                *pvalue = *preg_s;
-
-            result = HVMM_STATUS_SUCCESS;
-        } else if ((offset >> 2) >= GICD_ICENABLER
-                && (offset >> 2)
-                        < (GICD_ICENABLER + VGICD_NUM_IENABLER)) {
-            /* ICENABLER */
-            if (write) {
-                *preg_c &= ~(*pvalue);
-                vgicd_changed_istatus(vmid, *preg_c,
-                        (offset >> 2) - GICD_ICENABLER);
-            } else
-                *pvalue = *preg_c;
-
-            result = HVMM_STATUS_SUCCESS;
-        }
-    } else if (access_size == VDEV_ACCESS_HWORD) {
-        if ((offset >> 2) < (GICD_ISENABLER + VGICD_NUM_IENABLER)) {
-            uint16_t *preg_s16 = (uint16_t *) preg_s;
-            preg_s16 += (offset & 0x3) >> 1;
-            if (write) {
-                *preg_s16 |= (uint16_t) (*pvalue & 0xFFFF);
-                vgicd_changed_istatus(vmid, *preg_s,
-                        (offset >> 2) - GICD_ISENABLER);
-            } else
-                *pvalue = (uint32_t) *preg_s16;
-
-            result = HVMM_STATUS_SUCCESS;
-        } else if ((offset >> 2) >= GICD_ICENABLER
-                && (offset >> 2)
-                        < (GICD_ICENABLER + VGICD_NUM_IENABLER)) {
-            uint16_t *preg_c16 = (uint16_t *) preg_c;
-            preg_c16 += (offset & 0x3) >> 1;
-            if (write) {
-                *preg_c16 &= ~((uint16_t) (*pvalue & 0xFFFF));
-                vgicd_changed_istatus(vmid, *preg_c,
-                        (offset >> 2) - GICD_ICENABLER);
-            } else
-                *pvalue = (uint32_t) *preg_c16;
-
-            result = HVMM_STATUS_SUCCESS;
-        }
-    } else if (access_size == VDEV_ACCESS_BYTE) {
-        if ((offset >> 2) < (GICD_ISENABLER + VGICD_NUM_IENABLER)) {
-            uint8_t *preg_s8 = (uint8_t *) preg_s;
-            preg_s8 += (offset & 0x3);
-            if (write) {
-                *preg_s8 |= (uint8_t) (*pvalue & 0xFF);
-                vgicd_changed_istatus(vmid, *preg_s,
-                        (offset >> 2) - GICD_ISENABLER);
-            } else
-                *pvalue = (uint32_t) *preg_s8;
-
-            result = HVMM_STATUS_SUCCESS;
-        } else if ((offset >> 2) >= GICD_ICENABLER
-                && (offset >> 2)
-                        < (GICD_ICENABLER + VGICD_NUM_IENABLER)) {
-            uint8_t *preg_c8 = (uint8_t *) preg_c;
-            preg_c8 += (offset & 0x3);
-            if (write) {
-                *preg_c8 &= ~((uint8_t) (*pvalue & 0xFF));
-                vgicd_changed_istatus(vmid, *preg_c,
-                        (offset >> 2) - GICD_ICENABLER);
-            } else
-                *pvalue = (uint32_t) *preg_c8;
-
-            result = HVMM_STATUS_SUCCESS;
-        }
-    }
-    return result;
-}
+/*
+ * SGI targets and sources are vCPUs of the sending guest, numbered within
+ * that guest. Every guest runs a single vCPU, vCPU 0, so an SGI can only
+ * reach its sender; targets naming other vCPUs are dropped.
+ */
+#define VGICD_VCPU_MASK     0x1
+#define VGICD_VCPU_SELF     0
 
-static hvmm_status_t handler_ISCPENDR(uint32_t write, uint32_t offset,
+static hvmm_status_t handler_SGIR(uint32_t write, uint32_t offset,
         uint32_t *pvalue, enum vdev_access_size access_size)
 {
     hvmm_status_t result = HVMM_STATUS_BAD_ACCESS;
-    vcpuid_t vmid = guest_current_vmid();
-    struct gicd_regs *regs = &_regs[vmid];
-    struct gicd_regs_banked *regs_banked = &_regs_banked[vmid];
-    uint32_t *preg_s;
-    uint32_t *preg_c;
-    if(((offset >> 2) - GICD_ISPENDR) == 0 ||
-       ((offset >> 2) - GICD_ICPENDR) == 0) {
-        preg_s = &(regs_banked->ISCPENDR);
-        preg_c = &(regs_banked->ISCPENDR);
-    }
-    else {
-        preg_s = &(regs->ISCPENDR[(offset >> 2) - GICD_ISPENDR]);
-        preg_c = &(regs->ISCPENDR[(offset >> 2) - GICD_ICPENDR]);
-    }
-    offset >>= 2;
-    if (access_size == VDEV_ACCESS_WORD) {
-        if ((offset >> 2) < (GICD_ISPENDR + VGICD_NUM_IENABLER)) {
-            /* ISPEND */
-            if (write)
-                *preg_s |= *pvalue;
-            else
-                *pvalue = *preg_s;
-            result = HVMM_STATUS_SUCCESS;
-        } else if ((offset >> 2) >= GICD_ICPENDR
-                && (offset >> 2)
-                        < (GICD_ICPENDR + VGICD_NUM_IENABLER)) {
-            /* ICPEND */
-            if (write)
-                *preg_c &= ~(*pvalue);
-            else
-                *pvalue = *preg_c;
-            result = HVMM_STATUS_SUCCESS;
-        }
-    }
-    printh("vgicd:%s: not implemented\n", __func__);
-    return result;
-}
+    vcpuid_t vmid;
+    uint32_t target = 0;
+    uint32_t sgi_id = *pvalue & GICD_SGIR_SGI_INT_ID_MASK;
 
-static hvmm_status_t handler_ISCACTIVER(uint32_t write,
-        uint32_t offset, uint32_t *pvalue,
-        enum vdev_access_size access_size)
-{
-    hvmm_status_t result = HVMM_STATUS_BAD_ACCESS;
-    printh("vgicd:%s: not implemented\n", __func__);
-    return result;
-}
+    /* WO */
+    if (!write)
+        return result;
 
-static hvmm_status_t handler_IPRIORITYR(uint32_t write,
-        uint32_t offset, uint32_t *pvalue,
-        enum vdev_access_size access_size)
-{
-    hvmm_status_t result = HVMM_STATUS_BAD_ACCESS;
-    vcpuid_t vmid;
-    struct gicd_regs *regs;
-    struct gicd_regs_banked *regs_banked;
-    uint32_t *preg;
     vmid = guest_current_vmid();
-    regs = &_regs[vmid];
-    regs_banked = &_regs_banked[vmid];
-    /* FIXME: Support 8/16/32bit access */
-    offset >>= 2;
-    if((offset - GICD_IPRIORITYR) < VGICD_BANKED_NUM_IPRIORITYR)
-        preg = &(regs_banked->ICFGR);
-    else
-        preg = &(regs->IPRIORITYR[offset - GICD_IPRIORITYR]);
 
-    if (write)
-        *preg = *pvalue;
-    else
-        *pvalue = *preg;
+    // Filter Mask
+    switch (*pvalue & GICD_SGIR_TARGET_LIST_FILTER_MASK) {
+    case GICD_SGIR_TARGET_LIST:
+        target = ((*pvalue & GICD_SGIR_CPU_TARGET_LIST_MASK)
+                >> GICD_SGIR_CPU_TARGET_LIST_OFFSET);
+        break;
+    case GICD_SGIR_TARGET_OTHER:
+        target = ~(0x1 << VGICD_VCPU_SELF);
+        break;
+    case GICD_SGIR_TARGET_SELF:
+        target = (0x1 << VGICD_VCPU_SELF);
+        break;
+    default:
+        return result;
+    }
+    target &= VGICD_VCPU_MASK;
 
     result = HVMM_STATUS_SUCCESS;
+    if (target & (0x1 << VGICD_VCPU_SELF))
+        result = virq_inject_sgi(vmid, sgi_id, VGICD_VCPU_SELF);
     return result;
 }
 
-static hvmm_status_t handler_ITARGETSR(uint32_t write,
-        uint32_t offset, uint32_t *pvalue,
-        enum vdev_access_size access_size)
+/*
+ * CPENDSGIR/SPENDSGIR: one byte per SGI, one bit per source vCPU.
+ */
+static hvmm_status_t handler_PENDSGIR(uint32_t write, uint32_t offset,
+        uint32_t *pvalue, enum vdev_access_size access_size)
 {
-    hvmm_status_t result = HVMM_STATUS_BAD_ACCESS;
-    vcpuid_t vmid;
-    struct gicd_regs *regs;
-    struct gicd_regs_banked *regs_banked;
-    uint32_t *preg;
-    vmid = guest_current_vmid();
-    regs = &_regs[vmid];
-    regs_banked = &_regs_banked[vmid];
-    if (((offset >> 2) - GICD_ITARGETSR) < VGICD_BANKED_NUM_ITARGETSR)
-        preg = &(regs_banked->ITARGETSR[(offset >> 2) - GICD_ITARGETSR]);
-    else
-        preg = &(regs->ITARGETSR[(offset >> 2) - GICD_ITARGETSR]);
-
-    if (access_size == VDEV_ACCESS_WORD) {
-        offset >>= 2;
-        if (write) {
-            if (offset > (GICD_ITARGETSR + 7)) {
-                /* RO: ITARGETSR0 ~ 7 */
-                *preg = *pvalue;
-            }
-        } else {
-            *pvalue = *preg;
+    vcpuid_t vmid = guest_current_vmid();
+    uint32_t first = offset & 0xF;
+    uint32_t value = 0;
+    uint8_t sources;
+    int i, j;
+
+    if (offset & ((1 << access_size) - 1))
+        return HVMM_STATUS_BAD_ACCESS;
+
+    for (i = 0; i < (1 << access_size); i++) {
+        if (!write) {
+            value |= virq_sgi_pending(vmid, first + i) << (i * 8);
+            continue;
+        }
+        /* Only the guest's own vCPUs can be sources */
+        sources = (*pvalue >> (i * 8)) & VGICD_VCPU_MASK;
+        if ((offset & ~0xF) == GICD_OFFSET_CPENDSGIR) {
+            virq_sgi_clear(vmid, first + i, sources);
+            continue;
+        }
+        for (j = 0; j < 8; j++) {
+            if (sources & (1 << j))
+                virq_inject_sgi(vmid, first + i, j);
         }
-    } else if (access_size == VDEV_ACCESS_HWORD) {
-        uint16_t *preg16 = (uint16_t *) preg;
-        preg16 += (offset & 0x3) >> 1;
-        if (write) {
-            if ((offset >> 2) > (GICD_ITARGETSR + 7))
-                *preg16 = (uint16_t) (*pvalue & 0xFFFF);
-        } else
-            *pvalue = (uint32_t) *preg16;
-    } else if (access_size == VDEV_ACCESS_BYTE) {
-        uint8_t *preg8 = (uint8_t *) preg;
-        preg8 += (offset & 0x3);
-        if (write) {
-            if ((offset >> 2) > (GICD_ITARGETSR + 7))
-                *preg8 = (uint8_t) (*pvalue & 0xFF);
-        } else
-            *pvalue = (uint32_t) *preg8;
     }
-    result = HVMM_STATUS_SUCCESS;
-    return result;
-}
-
-static hvmm_status_t handler_ICFGR(uint32_t write, uint32_t offset,
-        uint32_t *pvalue, enum vdev_access_size access_size)
-{
-    hvmm_status_t result = HVMM_STATUS_BAD_ACCESS;
-    vcpuid_t vmid;
-    struct gicd_regs *regs;
-    struct gicd_regs_banked *regs_banked;
-    uint32_t *preg;
-    vmid = guest_current_vmid();
-    regs = &_regs[vmid];
-    regs_banked = &_regs_banked[vmid];
-    /* FIXME: Support 8/16/32bit access */
-    offset >>= 2;
-    if ((offset - GICD_ICFGR) == 1)
-        preg = &(regs_banked->ICFGR);
-    else
-        preg = &(regs->ICFGR[offset - GICD_ICFGR]);
+    if (!write)
+        *pvalue = value;
 
-    if (write)
-        *preg = *pvalue;
-    else
-        *pvalue = *preg;
-    result = HVMM_STATUS_SUCCESS;
-    return result;
+    return HVMM_STATUS_SUCCESS;
 }
 
-static hvmm_status_t handler_PPISPISR_CA15(uint32_t write,
+static hvmm_status_t vdev_gicd_access_handler(uint32_t write,
         uint32_t offset, uint32_t *pvalue,
         enum vdev_access_size access_size)
 {
+    const struct vgicd_reg_desc *desc;
+    uint8_t idx;
     hvmm_status_t result = HVMM_STATUS_BAD_ACCESS;
-    printh("vgicd:%s: not implemented\n", __func__);
-    return result;
-}
 
-static hvmm_status_t handler_NSACR(uint32_t write, uint32_t offset,
-        uint32_t *pvalue, enum vdev_access_size access_size)
-{
-    hvmm_status_t result = HVMM_STATUS_BAD_ACCESS;
-    printh("vgicd:%s: not implemented\n", __func__);
-    return result;
-}
+    printh("%s: %s offset:%x value:%x access_size : %d\n", __func__,
+            write ? "write" : "read", offset,
+            write ? *pvalue : (uint32_t) pvalue, access_size);
 
-static hvmm_status_t handler_F00(uint32_t write, uint32_t offset,
-        uint32_t *pvalue, enum vdev_access_size access_size)
-{
-    hvmm_status_t result = HVMM_STATUS_BAD_ACCESS;
-    vcpuid_t vmid;
-    struct gicd_regs_banked *regs_banked;
-    uint32_t target = 0;
-    uint32_t sgi_id = *pvalue & GICD_SGIR_SGI_INT_ID_MASK;
-    uint32_t i;
-    uint32_t *preg_s;
-    uint32_t *preg_c;
+    idx = _vgicd_reg_map[(offset & 0xFFF) >> 2];
+    if (idx == VGICD_REG_NONE) {
+        /* PPISPISR, NSACR, ID registers */
+        printh("vgicd: not implemented offset:%x\n", offset);
+        return result;
+    }
 
-    vmid = guest_current_vmid();
+    desc = &_vgicd_regs[idx];
+    if (desc->handler)
+        result = desc->handler(write, offset, pvalue, access_size);
+    else
+        result = vgicd_reg_access(desc, guest_current_vmid(), write,
+                offset, pvalue, access_size);
 
-    if(((offset >> 2) == GICD_CPENDSGIR) ||
-       ((offset >> 2) == GICD_SPENDSGIR)) {
-        regs_banked = &_regs_banked[vmid];
-        preg_s = &(regs_banked->CPENDSGIR[(offset >> 2) - GICD_SPENDSGIR]);
-        preg_c = &(regs_banked->CPENDSGIR[(offset >> 2) - GICD_CPENDSGIR]);
-    }
-    offset >>= 2;
-
-    if (offset == GICD_SGIR) {
-        // Filter Mask
-        switch(*pvalue & GICD_SGIR_TARGET_LIST_FILTER_MASK)
-        {
-            case GICD_SGIR_TARGET_LIST:
-                target = ((*pvalue & GICD_SGIR_CPU_TARGET_LIST_MASK)
-                        >>
-                        GICD_SGIR_CPU_TARGET_LIST_OFFSET);
-                break;
-            case GICD_SGIR_TARGET_OTHER:
-                target = ~(0x1<<vmid);
-                break;
-            case GICD_SGIR_TARGET_SELF:
-                target = (0x1<<vmid);
-                break;
-            default:
-                printh();
-                return result;
-        }
-        // after chagne architecture, NUM_VCPU_STATIC
-        // will be now guest's vcpu number
-        dsb();
-
-        for (i=0; i<NUM_GUESTS_STATIC;i++) {
-            uint8_t _target = target & 0x1;
-            if (_target) {
-                regs_banked = &_regs_banked[_target];
-                (regs_banked -> CPENDSGIR[(sgi_id>>2)]) = 0x1 << ((sgi_id&0x3) * 8);
-                result = virq_inject(i, sgi_id, sgi_id, 0);
-            }
-            target = target>>1;
-        }
-    } else if (offset == GICD_CPENDSGIR) {
-        if (write) {
-            if (*pvalue)
-                *preg_c |= ~(*pvalue);
-        } else // read
-            *pvalue = *preg_c;
-        result = HVMM_STATUS_SUCCESS;
-    } else if (offset == GICD_SPENDSGIR) {
-        if (write) {
-            if (*pvalue)
-                *preg_s |= *pvalue;
-        } else // read
-            *pvalue = *preg_s;
-        result = HVMM_STATUS_SUCCESS;
-    } else { //ICPIDR2 is not implemented
-        printH("vgicd:%s: not implemented\n", __func__);
-    }
-    return result;
-}
+    if (result != HVMM_STATUS_SUCCESS)
+        printH("vgicd: invalid access offset:%x write:%d\n", offset,
+                write);
 
-static hvmm_status_t vdev_gicd_access_handler(uint32_t write,
-        uint32_t offset, uint32_t *pvalue,
-        enum vdev_access_size access_size)
-{
-    uint32_t smp = smp_processor_id();
-    printh ("[%d]%s: %s offset:%x value:%x access_size : %d\n", smp, __func__,
-            write ? "write" : "read", offset,
-            write ? *pvalue : (uint32_t) pvalue, access_size);
-    hvmm_status_t result = HVMM_STATUS_BAD_ACCESS;
-    uint8_t offsetidx = (uint8_t) ((offset & 0xF00) >> 8);
-    printh("offset_idx : %d\n", offsetidx);
-    result = _handler_map[offsetidx].handler(write, offset, pvalue,
-            access_size);
     return result;
 }
 
@@ -643,186 +527,74 @@ static int32_t vdev_gicd_post(struct arch_vdev_trigger_info *info,
     return 0;
 }
 
-static int32_t vdev_gicd_check(struct arch_vdev_trigger_info *info,
-        struct arch_regs *regs)
-{
-    uint32_t offset = info->fipa - _vdev_gicd_info.base;
-
-    if (info->fipa >= _vdev_gicd_info.base
-            && offset < _vdev_gicd_info.size)
-        return 0;
-    return VDEV_NOT_FOUND;
-}
-
+/*
+ * Initial values of every guest come from the physical distributor,
+ * the banked ones from the CPU interface of the CPU initializing them.
+ */
 static hvmm_status_t vdev_gicd_reset_values(void)
 {
     hvmm_status_t result = HVMM_STATUS_SUCCESS;
-    //FIXME : mpidr must be changed to vcpu number
-    uint32_t mpidr = read_mpidr();
-    vcpuid_t vmid = mpidr & 0x0f;
-    int i;
+    volatile uint32_t *gicd = (volatile uint32_t *)
+            (CFG_GIC_BASE_PA + GIC_OFFSET_GICD);
+    const struct vgicd_reg_desc *desc;
+    uint32_t *preg;
+    int i, j, k;
 
     printh("vdev init:'%s'\n", __func__);
 
+    if (smp_processor_id())
+        return result;
+
+    vgicd_reg_map_init();
+
     for (i = 0; i < NUM_GUESTS_STATIC; i++) {
-        /*
-         * ITARGETS[0~ 7], CPU Targets are set to 0,
-         * due to current single-core support design
-         */
-        int j = 0;
-        uint32_t inc_address = 0x00000000;
-
-        _regs[i].CTLR =
-                (uint32_t) (*((volatile unsigned int*) (CFG_GIC_BASE_PA
-                        + GIC_OFFSET_GICD)));
-        _regs[i].TYPER =
-                (uint32_t) (*((volatile unsigned int*) (CFG_GIC_BASE_PA
-                        + GIC_OFFSET_GICD + GICD_OFFSET_TYPER)));
-        _regs[i].IIDR =
-                (uint32_t) (*((volatile unsigned int*) (CFG_GIC_BASE_PA
-                        + GIC_OFFSET_GICD + 0x8)));
+        _vgicd_route_cpu[i] = guest_vmid_to_cpu(i);
+        for (j = 0; j < VGICD_NUM_REG_DESCS; j++) {
+            desc = &_vgicd_regs[j];
+            if (desc->handler)
+                continue;
+            for (k = 0; k < desc->num; k++) {
+                preg = vgicd_reg_word(desc, i, k);
+                if (preg)
+                    *preg = gicd[(desc->offset >> 2) + k];
+            }
+        }
         printH("vdev init:'%s' vmid:%d, gicd TYPER:%x\n", __func__, i,
                 _regs[i].TYPER);
         printH("vdev init:'%s' vmid:%d, gicd IIDR:%x\n", __func__, i,
                 _regs[i].IIDR);
-        for (j = 0; j < VGICD_NUM_IGROUPR; j++) {
-            if (!j) {
-                _regs_banked[vmid].IGROUPR =
-                    (uint32_t) (*((volatile unsigned int*) (CFG_GIC_BASE_PA
-                            + GIC_OFFSET_GICD + inc_address)));
-            } else {
-                _regs[i].IGROUPR[j] =
-                    (uint32_t) (*((volatile unsigned int*) (CFG_GIC_BASE_PA
-                            + GIC_OFFSET_GICD + inc_address)));
-            }
-            inc_address += 0x00000004;
-        }
-
-        inc_address = 0x00000000;
-        for (j = 0; j < VGICE_NUM_ISCENABLER; j++) {
-            if (!j) {
-                _regs_banked[vmid].ISCENABLER = 
-                    (uint32_t) (*((volatile unsigned int*) (CFG_GIC_BASE_PA
-                            + GIC_OFFSET_GICD + GICD_OFFSET_ICENABLER
-                            + inc_address)));
-            } else {
-                _regs[i].ISCENABLER[j] =
-                    (uint32_t) (*((volatile unsigned int*) (CFG_GIC_BASE_PA
-                            + GIC_OFFSET_GICD + GICD_OFFSET_ICENABLER
-                            + inc_address)));
-            }
-            old_vgicd_status[i][(inc_address) >> 2] =
-                    _regs[i].ISCENABLER[j];
-            inc_address += 0x00000004;
-        }
-        inc_address = 0x00000000;
-        for (j = 0; j < VGICE_NUM_ISCPENDR; j++) {
-            if (!j) {
-                _regs_banked[vmid].ISCPENDR =
-                    (uint32_t) (*((volatile unsigned int*) (CFG_GIC_BASE_PA
-                            + GIC_OFFSET_GICD + GICD_OFFSET_ICPENDR
-                            + inc_address)));
-            } else {
-                _regs[i].ISCPENDR[j] =
-                    (uint32_t) (*((volatile unsigned int*) (CFG_GIC_BASE_PA
-                            + GIC_OFFSET_GICD + GICD_OFFSET_ICPENDR
-                            + inc_address)));
-            }
-            inc_address += 0x00000004;
-        }
-
-        inc_address = 0x00000000;
-        for (j = 0; j < VGICE_NUM_ISCACTIVER; j++) {
-            if (!j) {
-                _regs_banked[vmid].ISCACTIVER =
-                    (uint32_t) (*((volatile unsigned int*) (CFG_GIC_BASE_PA
-                            + GIC_OFFSET_GICD + GICD_OFFSET_ISCACTIVER
-                            + inc_address)));
-            } else {
-                _regs[i].ISCACTIVER[j] =
-                    (uint32_t) (*((volatile unsigned int*) (CFG_GIC_BASE_PA
-                            + GIC_OFFSET_GICD + GICD_OFFSET_ISCACTIVER
-                            + inc_address)));
-            }
-
-            inc_address += 0x00000004;
-        }
-
-        inc_address = 0x00000000;
-        for (j = 0; j < VGICE_NUM_IPRIORITYR; j++) {
-            if (j < VGICD_BANKED_NUM_IPRIORITYR) {
-                _regs_banked[vmid].IPRIORITYR[j] =
-                    (uint32_t) (*((volatile unsigned int*) (CFG_GIC_BASE_PA
-                            + GIC_OFFSET_GICD + GICD_OFFSET_IPRIORITYR
-                            + inc_address)));
-            } else {
-                _regs[i].IPRIORITYR[j] =
-                    (uint32_t) (*((volatile unsigned int*) (CFG_GIC_BASE_PA
-                            + GIC_OFFSET_GICD + GICD_OFFSET_IPRIORITYR
-                            + inc_address)));
-            }
-
-            inc_address += 0x00000004;
-        }
+    }
 
-        inc_address = 0x00000000;
-        for (j = 0; j < VGICE_NUM_ITARGETSR; j++) {
-            if (j < VGICD_BANKED_NUM_ITARGETSR) {
-                _regs_banked[vmid].ITARGETSR[j] =
-                    (uint32_t) (*((volatile unsigned int*) (CFG_GIC_BASE_PA
-                            + GIC_OFFSET_GICD + GICD_OFFSET_ITARGETSR
-                            + inc_address)));
-            } else {
-                _regs[i].ITARGETSR[j] = 
-                    (uint32_t) (*((volatile unsigned int*) (CFG_GIC_BASE_PA
-                            + GIC_OFFSET_GICD + GICD_OFFSET_ITARGETSR
-                            + inc_address)));
-            }
-            inc_address += 0x00000004;
-        }
+    return result;
+}
 
-        inc_address = 0x00000000;
-        for (j = 0; j < VGICE_NUM_ICFGR; j++) {
-            if (j == 1) {
-                _regs_banked[vmid].ICFGR = 
-                    (uint32_t) (*((volatile unsigned int*) (CFG_GIC_BASE_PA
-                            + GIC_OFFSET_GICD + GICD_OFFSET_ICFGR
-                            + inc_address)));
-            } else {
-                _regs[i].ICFGR[j] =
-                    (uint32_t) (*((volatile unsigned int*) (CFG_GIC_BASE_PA
-                            + GIC_OFFSET_GICD + GICD_OFFSET_ICFGR
-                            + inc_address)));
-            }
-            inc_address += 0x00000004;
-        }
+/*
+ * Follows a vCPU that is switched in on another physical CPU than its
+ * SPIs are routed to.
+ */
+static hvmm_status_t vdev_gicd_restore(vcpuid_t vmid)
+{
+    uint32_t cpu = smp_processor_id();
+    uint32_t virq;
 
-        _regs[i].SGIR =
-                (uint32_t) (*((volatile unsigned int*) (CFG_GIC_BASE_PA
-+                        + GIC_OFFSET_GICD + GICD_OFFSET_SGIR)));
-
-        inc_address = 0x00000000;
-        for (j = 0; j < VGICD_BANKED_NUM_CPENDSGIR; j++) {
-            _regs_banked[vmid].CPENDSGIR[j] =
-                    (uint32_t) (*((volatile unsigned int*) (CFG_GIC_BASE_PA
-                            + GIC_OFFSET_GICD + GICD_OFFSET_CPENDGIR
-                            + inc_address)));
-            inc_address += 0x00000004;
-        }
+    if (vmid >= NUM_GUESTS_STATIC || _vgicd_route_cpu[vmid] == cpu)
+        return HVMM_STATUS_SUCCESS;
 
-        inc_address = 0x00000000;
-    }
+    _vgicd_route_cpu[vmid] = cpu;
+    for (virq = 32; virq < VGICE_NUM_ITARGETSR * 4; virq++)
+        vgicd_route_spi(vmid, virq);
 
-    return result;
+    return HVMM_STATUS_SUCCESS;
 }
 
 struct vdev_ops _vdev_gicd_ops = { .init = vdev_gicd_reset_values,
-        .check = vdev_gicd_check, .read = vdev_gicd_read, .write =
-                vdev_gicd_write, .post = vdev_gicd_post, };
+        .read = vdev_gicd_read, .write = vdev_gicd_write,
+        .post = vdev_gicd_post,
+        .restore = vdev_gicd_restore, };
 
 struct vdev_module _vdev_gicd_module = { .name =
         "K-Hypervisor vDevice GICD Module", .author = "Kookmin Univ.",
-        .ops = &_vdev_gicd_ops, };
+        .ops = &_vdev_gicd_ops, .map = &_vdev_gicd_info, };
 
 hvmm_status_t vdev_gicd_init()
 {
@@ -0,0 +1,58 @@
+/*
+ * Doorbell of the inter-VM channels
+ * HVC #IVC_HVC_IMM_DOORBELL with the channel id in r0, the status of
+ * ivc_doorbell() is returned in r0.
+ */
+#include <vdev.h>
+#include <ivc.h>
+#include <log/print.h>
+
+static int32_t vdev_hvc_ivc_write(struct arch_vdev_trigger_info *info,
+                        struct arch_regs *regs)
+{
+    vcpuid_t vmid = guest_current_vmid();
+    hvmm_status_t result;
+
+    result = ivc_doorbell(regs->gpr[0], vmid);
+    if (result == HVMM_STATUS_BAD_ACCESS)
+        printh("ivc: guest %d is not an endpoint of channel %d\n", vmid,
+                regs->gpr[0]);
+    regs->gpr[0] = result;
+
+    return 0;
+}
+
+static hvmm_status_t vdev_hvc_ivc_reset(void)
+{
+    return HVMM_STATUS_SUCCESS;
+}
+
+struct vdev_ops _vdev_hvc_ivc_ops = {
+    .init = vdev_hvc_ivc_reset,
+    .write = vdev_hvc_ivc_write,
+};
+
+struct vdev_module _vdev_hvc_ivc_module = {
+    .name = "K-Hypervisor vDevice HVC IVC Doorbell Module",
+    .author = "Kookmin Univ.",
+    .ops = &_vdev_hvc_ivc_ops,
+};
+
+hvmm_status_t vdev_hvc_ivc_init()
+{
+    hvmm_status_t result = HVMM_STATUS_BUSY;
+
+    result = vdev_register(VDEV_LEVEL_MIDDLE, &_vdev_hvc_ivc_module);
+    if (result == HVMM_STATUS_SUCCESS)
+        result = vdev_hvc_bind(&_vdev_hvc_ivc_module,
+                IVC_HVC_IMM_DOORBELL, 0);
+    if (result == HVMM_STATUS_SUCCESS)
+        printh("vdev registered:'%s'\n", _vdev_hvc_ivc_module.name);
+    else {
+        printh("%s: Unable to register vdev:'%s' code=%x\n",
+                __func__, _vdev_hvc_ivc_module.name, result);
+    }
+
+    return result;
+}
+vdev_module_middle_init(vdev_hvc_ivc_init);
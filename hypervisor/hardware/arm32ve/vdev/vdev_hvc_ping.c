@@ -3,6 +3,8 @@
 #include <log/print.h>
 #include <asm-arm_inline.h>
 
+#define HVC_IMM_PING 0xFFFE
+
 static int32_t vdev_hvc_ping_write(struct arch_vdev_trigger_info *info,
                         struct arch_regs *regs)
 {
@@ -10,15 +12,6 @@ static int32_t vdev_hvc_ping_write(struct arch_vdev_trigger_info *info,
     return 0;
 }
 
-static int32_t vdev_hvc_ping_check(struct arch_vdev_trigger_info *info,
-                        struct arch_regs *regs)
-{
-    if ((info->iss & 0xFFFF) == 0xFFFE)
-        return 0;
-
-    return VDEV_NOT_FOUND;
-}
-
 static hvmm_status_t vdev_hvc_ping_reset(void)
 {
     return HVMM_STATUS_SUCCESS;
@@ -26,7 +19,6 @@ static hvmm_status_t vdev_hvc_ping_reset(void)
 
 struct vdev_ops _vdev_hvc_ping_ops = {
     .init = vdev_hvc_ping_reset,
-    .check = vdev_hvc_ping_check,
     .write = vdev_hvc_ping_write,
 };
 
@@ -41,6 +33,8 @@ hvmm_status_t vdev_hvc_ping_init()
     hvmm_status_t result = HVMM_STATUS_BUSY;
 
     result = vdev_register(VDEV_LEVEL_MIDDLE, &_vdev_hvc_ping_module);
+    if (result == HVMM_STATUS_SUCCESS)
+        result = vdev_hvc_bind(&_vdev_hvc_ping_module, HVC_IMM_PING, 0);
     if (result == HVMM_STATUS_SUCCESS)
         printh("vdev registered:'%s'\n", _vdev_hvc_ping_module.name);
     else {
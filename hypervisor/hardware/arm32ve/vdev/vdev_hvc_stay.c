@@ -3,6 +3,8 @@
 #include <log/print.h>
 #include <asm-arm_inline.h>
 
+#define HVC_IMM_STAY 0xFFFF
+
 static int32_t vdev_hvc_stay_write(struct arch_vdev_trigger_info *info,
                         struct arch_regs *regs)
 {
@@ -10,15 +12,6 @@ static int32_t vdev_hvc_stay_write(struct arch_vdev_trigger_info *info,
     return 0;
 }
 
-static int32_t vdev_hvc_stay_check(struct arch_vdev_trigger_info *info,
-                        struct arch_regs *regs)
-{
-    if ((info->iss & 0xFFFF) == 0xFFFF)
-        return 0;
-
-    return VDEV_NOT_FOUND;
-}
-
 static hvmm_status_t vdev_hvc_stay_reset_values(void)
 {
     return HVMM_STATUS_SUCCESS;
@@ -26,7 +19,6 @@ static hvmm_status_t vdev_hvc_stay_reset_values(void)
 
 struct vdev_ops _vdev_hvc_stay_ops = {
     .init = vdev_hvc_stay_reset_values,
-    .check = vdev_hvc_stay_check,
     .write = vdev_hvc_stay_write,
 };
 
@@ -42,6 +34,8 @@ hvmm_status_t vdev_hvc_stay_init()
 
 
     result = vdev_register(VDEV_LEVEL_MIDDLE, &_vdev_hvc_stay_module);
+    if (result == HVMM_STATUS_SUCCESS)
+        result = vdev_hvc_bind(&_vdev_hvc_stay_module, HVC_IMM_STAY, 0);
     if (result == HVMM_STATUS_SUCCESS)
         printh("vdev registered:'%s'\n", _vdev_hvc_stay_module.name);
     else {
@@ -2,6 +2,8 @@
 #define DEBUG
 #include <log/print.h>
 
+#define HVC_IMM_YIELD 0xFFFD
+
 static int32_t vdev_hvc_yield_write(struct arch_vdev_trigger_info *info,
                         struct arch_regs *regs)
 {
@@ -10,15 +12,6 @@ static int32_t vdev_hvc_yield_write(struct arch_vdev_trigger_info *info,
     return 0;
 }
 
-static int32_t vdev_hvc_yield_check(struct arch_vdev_trigger_info *info,
-                        struct arch_regs *regs)
-{
-    if ((info->iss & 0xFFFF) == 0xFFFD)
-        return 0;
-
-    return VDEV_NOT_FOUND;
-}
-
 static hvmm_status_t vdev_hvc_yield_reset_values(void)
 {
     return HVMM_STATUS_SUCCESS;
@@ -26,7 +19,6 @@ static hvmm_status_t vdev_hvc_yield_reset_values(void)
 
 struct vdev_ops _vdev_hvc_yield_ops = {
     .init = vdev_hvc_yield_reset_values,
-    .check = vdev_hvc_yield_check,
     .write = vdev_hvc_yield_write,
 };
 
@@ -41,6 +33,8 @@ hvmm_status_t vdev_hvc_yield_init()
     hvmm_status_t result = HVMM_STATUS_BUSY;
 
     result = vdev_register(VDEV_LEVEL_MIDDLE, &_vdev_hvc_yield_module);
+    if (result == HVMM_STATUS_SUCCESS)
+        result = vdev_hvc_bind(&_vdev_hvc_yield_module, HVC_IMM_YIELD, 0);
     if (result == HVMM_STATUS_SUCCESS)
         printh("vdev registered:'%s'\n", _vdev_hvc_yield_module.name);
     else {
@@ -11,6 +11,7 @@
 #include <vcpu.h>
 #include <timer.h>
 #define HVC_TRAP 0xe14fff7c
+#define HVC_IMM_MONITOR 0xFFFC
 
 uint32_t trapped_va, trapped_pa;
 void monitor_hvc_pre_handler(vcpuid_t vmid, struct arch_regs **regs)
@@ -111,15 +112,6 @@ static int32_t vdev_hvc_monitor_write(struct arch_vdev_trigger_info *info,
     return 0;
 }
 
-static int32_t vdev_hvc_monitor_check(struct arch_vdev_trigger_info *info,
-                        struct arch_regs *regs)
-{
-    if ((info->iss & 0xFFFF) == 0xFFFC)
-        return 0;
-
-    return VDEV_NOT_FOUND;
-}
-
 static hvmm_status_t vdev_hvc_monitor_reset(void)
 {
     return HVMM_STATUS_SUCCESS;
@@ -127,7 +119,6 @@ static hvmm_status_t vdev_hvc_monitor_reset(void)
 
 struct vdev_ops _vdev_hvc_monitor_ops = {
     .init = vdev_hvc_monitor_reset,
-    .check = vdev_hvc_monitor_check,
     .write = vdev_hvc_monitor_write,
 };
 
@@ -142,6 +133,8 @@ hvmm_status_t vdev_hvc_monitor_init()
     hvmm_status_t result = HVMM_STATUS_BUSY;
 
     result = vdev_register(VDEV_LEVEL_MIDDLE, &_vdev_hvc_monitor_module);
+    if (result == HVMM_STATUS_SUCCESS)
+        result = vdev_hvc_bind(&_vdev_hvc_monitor_module, HVC_IMM_MONITOR, 0);
     if (result == HVMM_STATUS_SUCCESS)
         printh("vdev registered:'%s'\n", _vdev_hvc_monitor_module.name);
     else {
@@ -38,7 +38,17 @@ static monitor_handler_t _monitor_handler[] = {
     monitor_register,                   /* offset : 0x0a */
     monitor_stop,                       /* offset : 0x0b */
     monitor_write_memory,               /* offset : 0x0c */
-    monitor_check_status                /* offset : 0x0d */
+    monitor_check_status,               /* offset : 0x0d */
+    monitor_irq_stats,                  /* offset : 0x0e */
+    monitor_irq_stats_reset,            /* offset : 0x0f */
+    monitor_irq_coalesce,               /* offset : 0x10 */
+    monitor_trace,                      /* offset : 0x11 */
+    monitor_exit_stats,                 /* offset : 0x12 */
+    monitor_exit_stats_reset,           /* offset : 0x13 */
+    monitor_profile_set,                /* offset : 0x14 */
+    monitor_profile,                    /* offset : 0x15 */
+    monitor_probe,                      /* offset : 0x16 */
+    monitor_probe_reset                 /* offset : 0x17 */
 };
 
 static hvmm_status_t vdev_monitor_access_handler(uint32_t write,
@@ -90,18 +100,6 @@ static int32_t vdev_monitor_post(struct arch_vdev_trigger_info *info,
     return 0;
 }
 
-static int32_t vdev_monitor_check(struct arch_vdev_trigger_info *info,
-                        struct arch_regs *regs)
-{
-    uint32_t offset = info->fipa - _vdev_monitor_info.base;
-
-    if (info->fipa >= _vdev_monitor_info.base &&
-        offset < _vdev_monitor_info.size)
-        return 0;
-
-    return VDEV_NOT_FOUND;
-}
-
 static hvmm_status_t vdev_monitor_reset(void)
 {
     printh("vdev init:'%s'\n", __func__);
@@ -115,7 +113,6 @@ static hvmm_status_t vdev_monitor_reset(void)
 
 struct vdev_ops _vdev_monitor_ops = {
     .init = vdev_monitor_reset,
-    .check = vdev_monitor_check,
     .read = vdev_monitor_read,
     .write = vdev_monitor_write,
     .post = vdev_monitor_post,
@@ -125,6 +122,7 @@ struct vdev_module _vdev_monitor_module = {
     .name = "K-Hypervisor vDevice monitoring Module",
     .author = "Kookmin Univ.",
     .ops = &_vdev_monitor_ops,
+    .map = &_vdev_monitor_info,
 };
 
 hvmm_status_t vdev_monitor_init()
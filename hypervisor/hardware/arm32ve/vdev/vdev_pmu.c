@@ -0,0 +1,351 @@
+/*
+ * Virtual Performance Monitors
+ * Every guest access to the PMU traps (HDCR.TPM, HDCR.TPMCR) and is
+ * applied to the hardware, which holds the counters of the running guest.
+ * The counters of a guest are saved and restored with the guest, so each
+ * guest only counts its own events.
+ */
+#include <vdev.h>
+#include <pmu.h>
+#include <interrupt.h>
+#include <smp.h>
+#include <armv7_p15.h>
+#include <asm-arm_inline.h>
+#include <k-hypervisor-config.h>
+#include <log/print.h>
+#include <log/string.h>
+
+#define PMU_COUNTERS_MAX    31
+/* PMSELR value selecting PMCCFILTR through PMXEVTYPER */
+#define PMU_SEL_CCFILTR     31
+
+#define PMCR_E              (0x1 << 0)
+#define PMCR_P              (0x1 << 1)
+#define PMCR_C              (0x1 << 2)
+#define PMCR_N_SHIFT        11
+#define PMCR_N_MASK         0x1F
+/* E, P, C, D and DP; no export of events to an external monitor */
+#define PMCR_GUEST_MASK     0x2F
+
+/* Counting in Non-secure PL2 would charge the hypervisor to the guest */
+#define PMXEVTYPER_NSH      (0x1 << 27)
+
+struct pmu_context {
+    uint32_t used;
+    uint32_t pmcr;
+    uint32_t cntenset;
+    /* As the guest sees it, including the masked interrupts */
+    uint32_t intenset;
+    uint32_t ovsr;
+    uint32_t selr;
+    uint32_t userenr;
+    uint32_t ccntr;
+    uint32_t ccfiltr;
+    uint32_t evtyper[PMU_COUNTERS_MAX];
+    uint32_t evcntr[PMU_COUNTERS_MAX];
+    /* Overflow interrupts held off until the guest clears their flags */
+    uint32_t masked;
+};
+
+static struct pmu_context _pmu[NUM_GUESTS_STATIC];
+/* Event counters implemented, the same on every cpu */
+static uint32_t _pmu_counters;
+
+/* Stops and clears the counters, as out of reset */
+static void pmu_hw_reset(void)
+{
+    uint32_t i;
+
+    write_pmcr(PMCR_P | PMCR_C);
+    write_pmcntenclr(~0);
+    write_pmintenclr(~0);
+    write_pmovsr(~0);
+    for (i = 0; i < _pmu_counters; i++) {
+        write_pmselr(i);
+        isb();
+        write_pmxevtyper(0);
+    }
+    write_pmselr(PMU_SEL_CCFILTR);
+    isb();
+    write_pmxevtyper(0);
+    write_pmselr(0);
+    write_pmuserenr(0);
+    isb();
+}
+
+/* Delivers the overflows of 'pending' once, until the guest clears them */
+static void pmu_raise(vcpuid_t vmid, uint32_t pending)
+{
+#ifdef CFG_PMU_VIRQ
+    _pmu[vmid].masked |= pending;
+    interrupt_guest_inject(vmid, CFG_PMU_VIRQ, 0, INJECT_SW);
+#endif
+}
+
+#ifdef CFG_PMU_IRQ_BASE
+/*
+ * The overflow irq of this cpu's PMU, raised by the counters of the
+ * running guest. It is level sensitive: the overflowing counters are
+ * masked until the guest clears their flags in PMOVSR.
+ */
+static void pmu_irq_handler(int irq, void *pregs, void *pdata)
+{
+    vcpuid_t vmid = guest_current_vmid();
+    uint32_t pending = read_pmovsr() & read_pmintenset();
+
+    write_pmintenclr(pending);
+    isb();
+    if (vmid < NUM_GUESTS_STATIC && pending)
+        pmu_raise(vmid, pending);
+}
+#endif
+
+/* Re-enables the masked overflow interrupts whose flags were cleared */
+static void pmu_unmask(struct pmu_context *pmu)
+{
+    uint32_t released = pmu->masked & ~read_pmovsr();
+
+    pmu->masked &= ~released;
+    write_pmintenset(released & pmu->intenset);
+}
+
+hvmm_status_t vdev_pmu_access(uint32_t crm, uint32_t opc2, uint32_t *value,
+        uint32_t write)
+{
+    vcpuid_t vmid = guest_current_vmid();
+    struct pmu_context *pmu;
+    uint32_t val = *value;
+
+    if (vmid >= NUM_GUESTS_STATIC)
+        return HVMM_STATUS_BAD_ACCESS;
+
+    pmu = &_pmu[vmid];
+    if (!pmu->used) {
+        pmu_hw_reset();
+        pmu->used = 1;
+    }
+
+    switch ((crm << 3) | opc2) {
+    case (12 << 3) | 0:
+        if (write)
+            write_pmcr(val & PMCR_GUEST_MASK);
+        else
+            *value = read_pmcr();
+        break;
+    case (12 << 3) | 1:
+        if (write)
+            write_pmcntenset(val);
+        else
+            *value = read_pmcntenset();
+        break;
+    case (12 << 3) | 2:
+        if (write)
+            write_pmcntenclr(val);
+        else
+            *value = read_pmcntenset();
+        break;
+    case (12 << 3) | 3:
+        if (write) {
+            write_pmovsr(val);
+            pmu_unmask(pmu);
+        } else
+            *value = read_pmovsr();
+        break;
+    case (12 << 3) | 4:
+        if (write)
+            write_pmswinc(val);
+        break;
+    case (12 << 3) | 5:
+        if (write)
+            write_pmselr(val);
+        else
+            *value = read_pmselr();
+        break;
+    case (12 << 3) | 6:
+        if (!write)
+            *value = read_pmceid0();
+        break;
+    case (12 << 3) | 7:
+        if (!write)
+            *value = read_pmceid1();
+        break;
+    case (13 << 3) | 0:
+        if (write)
+            write_pmccntr(val);
+        else
+            *value = read_pmccntr();
+        break;
+    case (13 << 3) | 1:
+        if (write)
+            write_pmxevtyper(val & ~PMXEVTYPER_NSH);
+        else
+            *value = read_pmxevtyper();
+        break;
+    case (13 << 3) | 2:
+        if (write)
+            write_pmxevcntr(val);
+        else
+            *value = read_pmxevcntr();
+        break;
+    case (14 << 3) | 0:
+        if (write)
+            write_pmuserenr(val);
+        else
+            *value = read_pmuserenr();
+        break;
+    case (14 << 3) | 1:
+        if (write) {
+            pmu->intenset |= val;
+            write_pmintenset(val & ~pmu->masked);
+        } else
+            *value = pmu->intenset;
+        break;
+    case (14 << 3) | 2:
+        if (write) {
+            pmu->intenset &= ~val;
+            pmu->masked &= ~val;
+            write_pmintenclr(val);
+        } else
+            *value = pmu->intenset;
+        break;
+    case (14 << 3) | 3:
+        if (write)
+            write_pmovsset(val);
+        else
+            *value = read_pmovsr();
+        break;
+    default:
+        return HVMM_STATUS_BAD_ACCESS;
+    }
+    isb();
+
+    return HVMM_STATUS_SUCCESS;
+}
+
+static hvmm_status_t vdev_pmu_reset(void)
+{
+    uint32_t hdcr;
+    int i;
+
+    _pmu_counters = (read_pmcr() >> PMCR_N_SHIFT) & PMCR_N_MASK;
+
+    for (i = guest_first_vmid(); i <= guest_last_vmid(); i++)
+        memset(&_pmu[i], 0, sizeof(struct pmu_context));
+
+    /* All counters to the guests, every access of theirs trapped */
+    hdcr = read_hdcr() & ~(HDCR_HPME | HDCR_HPMN_MASK);
+    write_hdcr(hdcr | _pmu_counters | HDCR_TPM | HDCR_TPMCR);
+    pmu_hw_reset();
+
+#ifdef CFG_PMU_IRQ_BASE
+    interrupt_request(CFG_PMU_IRQ_BASE + smp_processor_id(),
+            &pmu_irq_handler);
+    interrupt_host_configure(CFG_PMU_IRQ_BASE + smp_processor_id());
+#endif
+
+    return HVMM_STATUS_SUCCESS;
+}
+
+static hvmm_status_t vdev_pmu_save(vcpuid_t vmid)
+{
+    struct pmu_context *pmu;
+    uint32_t pending;
+    uint32_t i;
+
+    if (vmid >= NUM_GUESTS_STATIC || !_pmu[vmid].used)
+        return HVMM_STATUS_SUCCESS;
+
+    pmu = &_pmu[vmid];
+    /* Stop counting first, nothing after this point is the guest's */
+    pmu->pmcr = read_pmcr();
+    write_pmcr(pmu->pmcr & ~PMCR_E);
+    isb();
+
+    pmu->cntenset = read_pmcntenset();
+    pmu->ovsr = read_pmovsr();
+    pmu->selr = read_pmselr();
+    pmu->userenr = read_pmuserenr();
+    pmu->ccntr = read_pmccntr();
+    for (i = 0; i < _pmu_counters; i++) {
+        write_pmselr(i);
+        isb();
+        pmu->evtyper[i] = read_pmxevtyper();
+        pmu->evcntr[i] = read_pmxevcntr();
+    }
+    write_pmselr(PMU_SEL_CCFILTR);
+    isb();
+    pmu->ccfiltr = read_pmxevtyper();
+
+    /* An overflow not taken yet is delivered while the guest is out */
+    pending = pmu->ovsr & pmu->intenset & ~pmu->masked;
+    if (pending)
+        pmu_raise(vmid, pending);
+
+    write_pmcntenclr(~0);
+    write_pmintenclr(~0);
+    write_pmovsr(~0);
+    write_pmuserenr(0);
+    isb();
+
+    return HVMM_STATUS_SUCCESS;
+}
+
+static hvmm_status_t vdev_pmu_restore(vcpuid_t vmid)
+{
+    struct pmu_context *pmu;
+    uint32_t i;
+
+    if (vmid >= NUM_GUESTS_STATIC || !_pmu[vmid].used)
+        return HVMM_STATUS_SUCCESS;
+
+    pmu = &_pmu[vmid];
+    write_pmcr(pmu->pmcr & ~(PMCR_E | PMCR_P | PMCR_C));
+    for (i = 0; i < _pmu_counters; i++) {
+        write_pmselr(i);
+        isb();
+        write_pmxevtyper(pmu->evtyper[i]);
+        write_pmxevcntr(pmu->evcntr[i]);
+    }
+    write_pmselr(PMU_SEL_CCFILTR);
+    isb();
+    write_pmxevtyper(pmu->ccfiltr);
+    write_pmselr(pmu->selr);
+    write_pmccntr(pmu->ccntr);
+    write_pmuserenr(pmu->userenr);
+    write_pmovsset(pmu->ovsr);
+    write_pmcntenset(pmu->cntenset);
+    write_pmintenset(pmu->intenset & ~pmu->masked);
+    /* Counting resumes last */
+    write_pmcr(pmu->pmcr & ~(PMCR_P | PMCR_C));
+    isb();
+
+    return HVMM_STATUS_SUCCESS;
+}
+
+struct vdev_ops _vdev_pmu_ops = {
+    .init = vdev_pmu_reset,
+    .save = vdev_pmu_save,
+    .restore = vdev_pmu_restore,
+};
+
+struct vdev_module _vdev_pmu_module = {
+    .name = "K-Hypervisor vDevice PMU Module",
+    .author = "Kookmin Univ.",
+    .ops = &_vdev_pmu_ops,
+};
+
+hvmm_status_t vdev_pmu_init()
+{
+    hvmm_status_t result = HVMM_STATUS_BUSY;
+
+    result = vdev_register(VDEV_LEVEL_HIGH, &_vdev_pmu_module);
+    if (result == HVMM_STATUS_SUCCESS)
+        printh("vdev registered:'%s'\n", _vdev_pmu_module.name);
+    else {
+        printh("%s: Unable to register vdev:'%s' code=%x\n",
+                __func__, _vdev_pmu_module.name, result);
+    }
+
+    return result;
+}
+vdev_module_high_init(vdev_pmu_init);
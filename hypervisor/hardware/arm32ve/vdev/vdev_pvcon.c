@@ -0,0 +1,174 @@
+/*
+ * Paravirtual console
+ * Guests write into a ring in shared memory, the output of all guests is
+ * multiplexed onto the hypervisor's UART with a per-guest prefix.
+ */
+#include <vdev.h>
+#include <pvcon.h>
+#include <memory.h>
+#include <smp.h>
+#include <timer.h>
+#include <k-hypervisor-config.h>
+#include <log/print.h>
+#include <log/string.h>
+#include <log/uart_print.h>
+
+/* A kick is served this late, to drain the lines written meanwhile at once */
+#define PVCON_DRAIN_DELAY_US    1000
+
+struct pvcon {
+    struct pvcon_shared *shm;
+    /* The next byte starts a line, it is prefixed */
+    uint32_t line_start;
+    /* Armed on the guest's cpu by a kick */
+    struct timer_event drain;
+};
+
+static struct pvcon _pvcon[NUM_GUESTS_STATIC];
+
+/* Serializes the output of the cpus, a drain is never split */
+static DEFINE_SPINLOCK(_pvcon_lock);
+
+static void pvcon_drain(vcpuid_t vmid)
+{
+    struct pvcon *con = &_pvcon[vmid];
+    struct pvcon_shared *shm = con->shm;
+    char *buf = pvcon_buf(shm);
+    uint32_t head = shm->head;
+    uint32_t tail = shm->tail;
+    char c;
+
+    /* A corrupted index would make us print the whole buffer forever */
+    if (head - tail > PVCON_BUF_SIZE)
+        tail = head - PVCON_BUF_SIZE;
+
+    if (tail != head) {
+        /* Read the bytes after the index */
+        dmb();
+        spin_lock(&_pvcon_lock);
+        for (; tail != head; tail++) {
+            if (con->line_start) {
+                printH("[guest%d] ", vmid);
+                con->line_start = 0;
+            }
+            c = buf[tail % PVCON_BUF_SIZE];
+            uart_putc(c);
+            if (c == '\n')
+                con->line_start = 1;
+        }
+        spin_unlock(&_pvcon_lock);
+    }
+
+    /* Release the ring before allowing the next kick */
+    dmb();
+    shm->tail = tail;
+    shm->kicked = 0;
+}
+
+void vdev_pvcon_flush(vcpuid_t vmid)
+{
+    if (vmid >= NUM_GUESTS_STATIC || !_pvcon[vmid].shm)
+        return;
+
+    timer_event_cancel(&_pvcon[vmid].drain);
+    if (_pvcon[vmid].shm->kicked)
+        pvcon_drain(vmid);
+}
+
+/* A switched out guest has been drained by vdev_pvcon_save() */
+static void pvcon_drain_expired(void *pregs, void *data)
+{
+    vcpuid_t vmid = (struct pvcon *)data - _pvcon;
+
+    if (vmid == guest_current_vmid())
+        vdev_pvcon_flush(vmid);
+}
+
+static int32_t vdev_pvcon_write(struct arch_vdev_trigger_info *info,
+                        struct arch_regs *regs)
+{
+    vcpuid_t vmid = guest_current_vmid();
+
+    if (vmid >= NUM_GUESTS_STATIC || !_pvcon[vmid].shm)
+        return 0;
+
+    /* A kick is deferred, a flush is served at once */
+    if (regs->gpr[0] == PVCON_FLUSH)
+        pvcon_drain(vmid);
+    else if (!timer_event_pending(&_pvcon[vmid].drain))
+        timer_event_add(&_pvcon[vmid].drain, PVCON_DRAIN_DELAY_US, 0);
+
+    return 0;
+}
+
+static hvmm_status_t vdev_pvcon_save(vcpuid_t vmid)
+{
+    vdev_pvcon_flush(vmid);
+
+    return HVMM_STATUS_SUCCESS;
+}
+
+static hvmm_status_t vdev_pvcon_reset(void)
+{
+    struct pvcon *con;
+    uint32_t base;
+    int i;
+
+    for (i = guest_first_vmid(); i <= guest_last_vmid(); i++) {
+        con = &_pvcon[i];
+        con->line_start = 1;
+        if (!timer_event_pending(&con->drain))
+            timer_event_init(&con->drain, pvcon_drain_expired, con);
+        if (con->shm) {
+            memset(con->shm, 0, PVCON_SIZE);
+            continue;
+        }
+
+        /* The heap is identity mapped, align the console to a page */
+        base = (uint32_t)memory_alloc(PVCON_SIZE + SZ_4K);
+        if (!base) {
+            printh("pvcon: no memory for the console of guest %d\n", i);
+            continue;
+        }
+        base = (base + SZ_4K - 1) & ~(SZ_4K - 1);
+        memset((void *)base, 0, PVCON_SIZE);
+        if (memory_guest_map(i, PVCON_IPA, base, PVCON_SIZE,
+                    MEMATTR_NORMAL_OWB | MEMATTR_NORMAL_IWB)) {
+            printh("pvcon: console of guest %d could not be mapped\n", i);
+            continue;
+        }
+        con->shm = (struct pvcon_shared *)base;
+    }
+
+    return HVMM_STATUS_SUCCESS;
+}
+
+struct vdev_ops _vdev_pvcon_ops = {
+    .init = vdev_pvcon_reset,
+    .write = vdev_pvcon_write,
+    .save = vdev_pvcon_save,
+};
+
+struct vdev_module _vdev_pvcon_module = {
+    .name = "K-Hypervisor vDevice Paravirtual Console Module",
+    .author = "Kookmin Univ.",
+    .ops = &_vdev_pvcon_ops,
+};
+
+hvmm_status_t vdev_pvcon_init()
+{
+    hvmm_status_t result = HVMM_STATUS_BUSY;
+
+    result = vdev_register(VDEV_LEVEL_MIDDLE, &_vdev_pvcon_module);
+    if (result == HVMM_STATUS_SUCCESS)
+        result = vdev_hvc_bind(&_vdev_pvcon_module, PVCON_HVC_IMM, 0);
+    if (result == HVMM_STATUS_SUCCESS)
+        printh("vdev registered:'%s'\n", _vdev_pvcon_module.name);
+    else {
+        printh("%s: Unable to register vdev:'%s' code=%x\n",
+                __func__, _vdev_pvcon_module.name, result);
+    }
+
+    return result;
+}
+vdev_module_middle_init(vdev_pvcon_init);
@@ -15,6 +15,12 @@ static struct vdev_memory_map _vdev_sample_info = {
    .size = sizeof(struct vdev_sample_regs),
 };
 
+/* axis_x and axis_y, writes have no side effect */
+static struct vdev_memory_map _vdev_sample_coalesced = {
+   .base = SAMPLE_BASE_ADDR,
+   .size = 2 * sizeof(uint32_t),
+};
+
 static struct vdev_sample_regs sample_regs[NUM_GUESTS_STATIC];
 
 static hvmm_status_t vdev_sample_access_handler(uint32_t write, uint32_t offset,
@@ -90,17 +96,6 @@ static int32_t vdev_sample_post(struct arch_vdev_trigger_info *info,
     return 0;
 }
 
-static int32_t vdev_sample_check(struct arch_vdev_trigger_info *info,
-                        struct arch_regs *regs)
-{
-    uint32_t offset = info->fipa - _vdev_sample_info.base;
-
-    if (info->fipa >= _vdev_sample_info.base &&
-        offset < _vdev_sample_info.size)
-        return 0;
-    return VDEV_NOT_FOUND;
-}
-
 static hvmm_status_t vdev_sample_reset(void)
 {
     printh("vdev init:'%s'\n", __func__);
@@ -109,7 +104,6 @@ static hvmm_status_t vdev_sample_reset(void)
 
 struct vdev_ops _vdev_sample_ops = {
     .init = vdev_sample_reset,
-    .check = vdev_sample_check,
     .read = vdev_sample_read,
     .write = vdev_sample_write,
     .post = vdev_sample_post,
@@ -119,6 +113,7 @@ struct vdev_module _vdev_sample_module = {
     .name = "K-Hypervisor vDevice Sample Module",
     .author = "Kookmin Univ.",
     .ops = &_vdev_sample_ops,
+    .map = &_vdev_sample_info,
 };
 
 hvmm_status_t vdev_sample_init()
@@ -126,6 +121,8 @@ hvmm_status_t vdev_sample_init()
     hvmm_status_t result = HVMM_STATUS_BUSY;
 
     result = vdev_register(VDEV_LEVEL_LOW, &_vdev_sample_module);
+    if (result == HVMM_STATUS_SUCCESS)
+        result = vdev_coalesce(&_vdev_sample_module, &_vdev_sample_coalesced);
     if (result == HVMM_STATUS_SUCCESS)
         printh("vdev registered:'%s'\n", _vdev_sample_module.name);
     else {
@@ -3,10 +3,14 @@
 #include <log/print.h>
 #include <timer.h>
 #include <interrupt.h>
+#include <vgic.h>
 #include <smp.h>
 
 #define VTIMER_BASE_ADDR 0x3FFFE000
+/* Software tick of the legacy vtimer mask register */
 #define VTIMER_IRQ 30
+/* Architectural virtual timer, GENERIC_TIMER_VIR */
+#define VTIMER_PPI_IRQ 27
 
 struct vdev_vtimer_regs {
     uint32_t vtimer_mask;
@@ -19,6 +23,29 @@ static struct vdev_memory_map _vdev_timer_info = {
 
 static struct vdev_vtimer_regs vtimer_regs[NUM_GUESTS_STATIC];
 static int _timer_status[NUM_GUESTS_STATIC] = {0, };
+/* CNTV context of each guest, live in hardware while the guest runs */
+static struct vtimer_context _vtimer[NUM_GUESTS_STATIC];
+/* Expiry of the CNTV of a descheduled guest */
+static struct timer_event _vtimer_event[NUM_GUESTS_STATIC];
+
+/*
+ * Deadline whose expiry has been delivered as a software virq: injected
+ * while the guest was descheduled, or turned from a HW-linked virq when
+ * the guest was switched out. Until the guest reprograms its timer, CNTV
+ * is restored with IMASK set so that the same deadline does not raise the
+ * physical PPI again. Guest writes to CNTV do not trap, so a write is
+ * seen at the next save as a changed CTL or CVAL, which forgets the
+ * delivery. 'ctl' is the state the guest left, without our IMASK.
+ */
+struct vtimer_delivery {
+    uint32_t delivered;
+    uint32_t ctl;
+    uint64_t cval;
+};
+
+static struct vtimer_delivery _vtimer_delivery[NUM_GUESTS_STATIC];
+
+#define VTIMER_CTL_STATE    (VTIMER_CTL_ENABLE | VTIMER_CTL_IMASK)
 
 static void vtimer_changed_status(vcpuid_t vmid, uint32_t status)
 {
@@ -83,15 +110,30 @@ static int32_t vdev_vtimer_post(struct arch_vdev_trigger_info *info,
     return 0;
 }
 
-static int32_t vdev_vtimer_check(struct arch_vdev_trigger_info *info,
-                        struct arch_regs *regs)
+/*
+ * The virtual timer of a descheduled guest is stopped in hardware.
+ * An event armed at its deadline delivers the expiry as a software virq,
+ * once per deadline the guest programmed.
+ */
+static void vtimer_expired(void *pregs, void *data)
 {
-    uint32_t offset = info->fipa - _vdev_timer_info.base;
+    vcpuid_t vmid = (vcpuid_t)(uint32_t)data;
+    struct vtimer_context *vtimer = &_vtimer[vmid];
+    struct vtimer_delivery *delivery = &_vtimer_delivery[vmid];
+    uint32_t virq;
+
+    if (vmid == guest_current_vmid() || delivery->delivered ||
+            (vtimer->ctl & VTIMER_CTL_STATE) != VTIMER_CTL_ENABLE)
+        return;
+
+    virq = interrupt_pirq_to_enabled_virq(vmid, VTIMER_PPI_IRQ);
+    if (virq == VIRQ_INVALID)
+        return;
 
-    if (info->fipa >= _vdev_timer_info.base &&
-        offset < _vdev_timer_info.size)
-        return 0;
-    return VDEV_NOT_FOUND;
+    delivery->delivered = 1;
+    delivery->ctl = vtimer->ctl & VTIMER_CTL_STATE;
+    delivery->cval = vtimer->cval;
+    interrupt_guest_inject(vmid, virq, 0, INJECT_SW);
 }
 
 void callback_timer(void *pdata)
@@ -113,6 +155,17 @@ static hvmm_status_t vdev_vtimer_reset(void)
             _timer_status[i] = 1;
     }
 
+    /* Each guest's virtual counter starts from zero */
+    for (i = guest_first_vmid(); i <= guest_last_vmid(); i++) {
+        _vtimer[i].ctl = 0;
+        _vtimer[i].cval = 0;
+        _vtimer[i].offset = get_timer_curcnt();
+        _vtimer_delivery[i].delivered = 0;
+        timer_event_cancel(&_vtimer_event[i]);
+        timer_event_init(&_vtimer_event[i], vtimer_expired,
+                (void *)(uint32_t)i);
+    }
+
     timer.interval_us = GUEST_SCHED_TICK;
     timer.callback = &callback_timer;
 
@@ -121,18 +174,93 @@ static hvmm_status_t vdev_vtimer_reset(void)
     return HVMM_STATUS_SUCCESS;
 }
 
+static hvmm_status_t vdev_vtimer_save(vcpuid_t vmid)
+{
+    struct vtimer_context *vtimer;
+    struct vtimer_delivery *delivery;
+    hvmm_status_t result;
+    uint32_t virq;
+
+    if (vmid >= NUM_GUESTS_STATIC)
+        return HVMM_STATUS_SUCCESS;
+
+    vtimer = &_vtimer[vmid];
+    delivery = &_vtimer_delivery[vmid];
+    result = timer_vtimer_save(vtimer);
+    if (result)
+        return result;
+
+    if (delivery->delivered) {
+        /* Hide the IMASK set by vdev_vtimer_restore() */
+        if (!(delivery->ctl & VTIMER_CTL_IMASK) &&
+                (vtimer->ctl & VTIMER_CTL_STATE) ==
+                (delivery->ctl | VTIMER_CTL_IMASK))
+            vtimer->ctl &= ~VTIMER_CTL_IMASK;
+        /* The guest reprogrammed its timer since the last delivery */
+        if (delivery->cval != vtimer->cval ||
+                delivery->ctl != (vtimer->ctl & VTIMER_CTL_STATE))
+            delivery->delivered = 0;
+    }
+
+    /*
+     * An expiry the guest holds now, as a virq unlinked from the PPI by
+     * the interrupt save, is delivered. One only raised in hardware is
+     * not: the event below fires at once and injects it.
+     */
+    virq = interrupt_pirq_to_enabled_virq(vmid, VTIMER_PPI_IRQ);
+    if (!delivery->delivered &&
+            (vtimer->ctl & VTIMER_CTL_STATE) == VTIMER_CTL_ENABLE &&
+            (vtimer->ctl & VTIMER_CTL_ISTATUS) &&
+            virq != VIRQ_INVALID && virq_is_pending(vmid, virq)) {
+        delivery->delivered = 1;
+        delivery->ctl = vtimer->ctl & VTIMER_CTL_STATE;
+        delivery->cval = vtimer->cval;
+    }
+
+    /* A deadline beyond the physical counter range never expires */
+    if (!delivery->delivered &&
+            (vtimer->ctl & VTIMER_CTL_STATE) == VTIMER_CTL_ENABLE &&
+            vtimer->cval <= ~0ULL - vtimer->offset)
+        timer_event_add_abs(&_vtimer_event[vmid],
+                vtimer->cval + vtimer->offset, 0);
+
+    return HVMM_STATUS_SUCCESS;
+}
+
+static hvmm_status_t vdev_vtimer_restore(vcpuid_t vmid)
+{
+    struct vtimer_context vtimer;
+
+    if (vmid >= NUM_GUESTS_STATIC)
+        return HVMM_STATUS_SUCCESS;
+
+    timer_event_cancel(&_vtimer_event[vmid]);
+
+    /*
+     * A delivered deadline still meets the compare condition, keep the
+     * physical PPI quiet until the guest reprograms its timer.
+     */
+    vtimer = _vtimer[vmid];
+    if (_vtimer_delivery[vmid].delivered)
+        vtimer.ctl |= VTIMER_CTL_IMASK;
+
+    return timer_vtimer_restore(&vtimer);
+}
+
 struct vdev_ops _vdev_hvc_vtimer_ops = {
     .init = vdev_vtimer_reset,
-    .check = vdev_vtimer_check,
     .read = vdev_vtimer_read,
     .write = vdev_vtimer_write,
     .post = vdev_vtimer_post,
+    .save = vdev_vtimer_save,
+    .restore = vdev_vtimer_restore,
 };
 
 struct vdev_module _vdev_hvc_vtimer_module = {
     .name = "K-Hypervisor vDevice vTimer Module",
     .author = "Kookmin Univ.",
     .ops = &_vdev_hvc_vtimer_ops,
+    .map = &_vdev_timer_info,
 };
 
 hvmm_status_t vdev_vtimer_init()
@@ -0,0 +1,285 @@
+/*
+ * virtio block device
+ * Each guest gets its own RAM disk allocated from the hypervisor heap.
+ */
+#include <vdev.h>
+#include <virtio.h>
+#include <memory.h>
+#include <smp.h>
+#include <log/print.h>
+#include <log/string.h>
+
+#define VIRTIO_BLK_BASE_ADDR        0x3FFFB000
+#define VIRTIO_BLK_VIRQ             75
+#define VIRTIO_BLK_QUEUE_NUM        128
+#define VIRTIO_BLK_DISK_SIZE        (4 * 1024 * 1024)
+
+#define VIRTIO_BLK_SECTOR_SIZE      512
+#define VIRTIO_BLK_SECTOR_SHIFT     9
+
+/* Feature bits */
+#define VIRTIO_BLK_F_SEG_MAX        2
+#define VIRTIO_BLK_F_FLUSH          9
+
+/* Request types */
+#define VIRTIO_BLK_T_IN             0
+#define VIRTIO_BLK_T_OUT            1
+#define VIRTIO_BLK_T_FLUSH          4
+#define VIRTIO_BLK_T_GET_ID         8
+
+/* Request status */
+#define VIRTIO_BLK_S_OK             0
+#define VIRTIO_BLK_S_IOERR          1
+#define VIRTIO_BLK_S_UNSUPP         2
+
+#define VIRTIO_BLK_ID_BYTES         20
+
+/* Configuration space, offsets of struct virtio_blk_config */
+#define VIRTIO_BLK_CONFIG_CAPACITY_LOW  0x00
+#define VIRTIO_BLK_CONFIG_CAPACITY_HIGH 0x04
+#define VIRTIO_BLK_CONFIG_SIZE_MAX      0x08
+#define VIRTIO_BLK_CONFIG_SEG_MAX       0x0c
+#define VIRTIO_BLK_CONFIG_SIZE          0x10
+
+struct virtio_blk_req_hdr {
+    uint32_t type;
+    uint32_t reserved;
+    uint64_t sector;
+};
+
+struct virtio_blk_disk {
+    uint8_t *data;
+    uint32_t size;
+};
+
+static struct vdev_memory_map _vdev_virtio_blk_info = {
+   .base = VIRTIO_BLK_BASE_ADDR,
+   .size = VIRTIO_MMIO_SIZE,
+};
+
+static struct virtio_device _blk[NUM_GUESTS_STATIC];
+static struct virtio_blk_disk _blk_disk[NUM_GUESTS_STATIC];
+
+static uint32_t virtio_blk_read_config(struct virtio_device *dev,
+        uint32_t offset)
+{
+    struct virtio_blk_disk *disk = dev->priv;
+
+    switch (offset) {
+    case VIRTIO_BLK_CONFIG_CAPACITY_LOW:
+        return disk->size >> VIRTIO_BLK_SECTOR_SHIFT;
+    case VIRTIO_BLK_CONFIG_SEG_MAX:
+        /* The header and the status take a descriptor each */
+        return VIRTQ_MAX_SEGS - 2;
+    }
+
+    return 0;
+}
+
+/*
+ * Copies between the disk and the data buffers of a request, the buffers
+ * between the header and the status descriptor, which is always the last
+ * one whatever its length.
+ * @return Bytes transferred, or -1 if the request is out of the disk.
+ */
+static int32_t virtio_blk_transfer(struct virtio_blk_disk *disk,
+        struct virtq_chain *chain, uint64_t sector, uint32_t write)
+{
+    uint32_t offset, room, len = 0;
+    uint32_t i;
+
+    if (sector > disk->size >> VIRTIO_BLK_SECTOR_SHIFT)
+        return -1;
+    offset = sector << VIRTIO_BLK_SECTOR_SHIFT;
+
+    /* Every segment is checked against what is left, the sum could wrap */
+    room = disk->size - offset;
+    for (i = 1; i < chain->num - 1; i++) {
+        struct virtq_seg *seg = &chain->seg[i];
+
+        /* Data to the disk is device readable, from the disk writable */
+        if (!seg->write != !!write)
+            return -1;
+        if (seg->len > room)
+            return -1;
+        room -= seg->len;
+        len += seg->len;
+    }
+
+    for (i = 1; i < chain->num - 1; i++) {
+        struct virtq_seg *seg = &chain->seg[i];
+
+        if (write)
+            memcpy(disk->data + offset, seg->addr, seg->len);
+        else
+            memcpy(seg->addr, disk->data + offset, seg->len);
+        offset += seg->len;
+    }
+
+    return len;
+}
+
+static void virtio_blk_request(struct virtio_device *dev,
+        struct virtq_chain *chain)
+{
+    struct virtio_blk_disk *disk = dev->priv;
+    struct virtio_blk_req_hdr hdr;
+    struct virtq_seg *status = &chain->seg[chain->num - 1];
+    uint32_t written = 0;
+    int32_t len;
+    uint8_t result = VIRTIO_BLK_S_OK;
+
+    if (chain->num < 2 || chain->seg[0].write ||
+            chain->seg[0].len < sizeof(hdr) || !status->write ||
+            status->len < 1) {
+        printh("virtio: blk request of guest %d is malformed\n", dev->vmid);
+        virtq_push(dev, 0, chain, 0);
+        return;
+    }
+    memcpy(&hdr, chain->seg[0].addr, sizeof(hdr));
+
+    switch (hdr.type) {
+    case VIRTIO_BLK_T_IN:
+    case VIRTIO_BLK_T_OUT:
+        len = virtio_blk_transfer(disk, chain, hdr.sector,
+                hdr.type == VIRTIO_BLK_T_OUT);
+        if (len < 0)
+            result = VIRTIO_BLK_S_IOERR;
+        else if (hdr.type == VIRTIO_BLK_T_IN)
+            written = len;
+        break;
+    case VIRTIO_BLK_T_FLUSH:
+        /* Writes reach the RAM disk immediately */
+        break;
+    case VIRTIO_BLK_T_GET_ID:
+        if (chain->num > 2 && chain->seg[1].write) {
+            len = chain->seg[1].len < VIRTIO_BLK_ID_BYTES ?
+                chain->seg[1].len : VIRTIO_BLK_ID_BYTES;
+            memset(chain->seg[1].addr, 0, len);
+            memcpy(chain->seg[1].addr, "khypervisor-ramdisk",
+                    len < 19 ? len : 19);
+            written = len;
+        } else {
+            result = VIRTIO_BLK_S_IOERR;
+        }
+        break;
+    default:
+        result = VIRTIO_BLK_S_UNSUPP;
+        break;
+    }
+
+    status->addr[status->len - 1] = result;
+    virtq_push(dev, 0, chain, written + 1);
+}
+
+static void virtio_blk_notify(struct virtio_device *dev, uint32_t queue)
+{
+    struct virtq_chain chain;
+    int completed = 0;
+
+    while (virtq_pop(dev, queue, &chain) > 0) {
+        virtio_blk_request(dev, &chain);
+        completed = 1;
+    }
+
+    if (completed)
+        virtio_notify(dev, queue);
+}
+
+static const struct virtio_backend _virtio_blk_backend = {
+    .name = "blk",
+    .device_id = VIRTIO_ID_BLOCK,
+    .num_queues = 1,
+    .queue_num_max = VIRTIO_BLK_QUEUE_NUM,
+    .features = (1ULL << VIRTIO_BLK_F_SEG_MAX) | (1ULL << VIRTIO_BLK_F_FLUSH),
+    .config_size = VIRTIO_BLK_CONFIG_SIZE,
+    .read_config = virtio_blk_read_config,
+    .notify = virtio_blk_notify,
+};
+
+static int32_t vdev_virtio_blk_read(struct arch_vdev_trigger_info *info,
+                        struct arch_regs *regs)
+{
+    vcpuid_t vmid = guest_current_vmid();
+
+    return virtio_mmio_read(&_blk[vmid],
+            info->fipa - _vdev_virtio_blk_info.base, info->value,
+            info->sas);
+}
+
+static int32_t vdev_virtio_blk_write(struct arch_vdev_trigger_info *info,
+                        struct arch_regs *regs)
+{
+    vcpuid_t vmid = guest_current_vmid();
+
+    return virtio_mmio_write(&_blk[vmid],
+            info->fipa - _vdev_virtio_blk_info.base, *info->value,
+            info->sas);
+}
+
+static int32_t vdev_virtio_blk_post(struct arch_vdev_trigger_info *info,
+                        struct arch_regs *regs)
+{
+    uint8_t isize = 4;
+
+    if (regs->cpsr & 0x20) /* Thumb */
+        isize = 2;
+
+    regs->pc += isize;
+
+    return 0;
+}
+
+static hvmm_status_t vdev_virtio_blk_reset(void)
+{
+    int i;
+    struct virtio_blk_disk *disk;
+
+    for (i = guest_first_vmid(); i <= guest_last_vmid(); i++) {
+        disk = &_blk_disk[i];
+        if (!disk->data) {
+            disk->data = memory_alloc(VIRTIO_BLK_DISK_SIZE);
+            if (!disk->data) {
+                printh("virtio: no memory for the blk disk of guest %d\n", i);
+                disk->size = 0;
+            } else {
+                disk->size = VIRTIO_BLK_DISK_SIZE;
+                memset(disk->data, 0, disk->size);
+            }
+        }
+        virtio_device_init(&_blk[i], &_virtio_blk_backend, i,
+                VIRTIO_BLK_VIRQ, disk);
+    }
+
+    return HVMM_STATUS_SUCCESS;
+}
+
+struct vdev_ops _vdev_virtio_blk_ops = {
+    .init = vdev_virtio_blk_reset,
+    .read = vdev_virtio_blk_read,
+    .write = vdev_virtio_blk_write,
+    .post = vdev_virtio_blk_post,
+};
+
+struct vdev_module _vdev_virtio_blk_module = {
+    .name = "K-Hypervisor vDevice virtio Block Module",
+    .author = "Kookmin Univ.",
+    .ops = &_vdev_virtio_blk_ops,
+    .map = &_vdev_virtio_blk_info,
+};
+
+hvmm_status_t vdev_virtio_blk_init()
+{
+    hvmm_status_t result = HVMM_STATUS_BUSY;
+
+    result = vdev_register(VDEV_LEVEL_LOW, &_vdev_virtio_blk_module);
+    if (result == HVMM_STATUS_SUCCESS)
+        printh("vdev registered:'%s'\n", _vdev_virtio_blk_module.name);
+    else {
+        printh("%s: Unable to register vdev:'%s' code=%x\n",
+                __func__, _vdev_virtio_blk_module.name, result);
+    }
+
+    return result;
+}
+vdev_module_low_init(vdev_virtio_blk_init);
@@ -0,0 +1,136 @@
+/*
+ * virtio console
+ * Output of every guest goes to the hypervisor's UART. There is no input
+ * source: the receive queue is offered, as the device requires, but its
+ * buffers stay posted.
+ */
+#include <vdev.h>
+#include <virtio.h>
+#include <smp.h>
+#include <log/print.h>
+#include <log/uart_print.h>
+
+#define VIRTIO_CONSOLE_BASE_ADDR    0x3FFFC000
+#define VIRTIO_CONSOLE_VIRQ         74
+#define VIRTIO_CONSOLE_QUEUE_NUM    64
+
+#define VIRTIO_CONSOLE_RX           0
+#define VIRTIO_CONSOLE_TX           1
+
+static struct vdev_memory_map _vdev_virtio_console_info = {
+   .base = VIRTIO_CONSOLE_BASE_ADDR,
+   .size = VIRTIO_MMIO_SIZE,
+};
+
+static struct virtio_device _console[NUM_GUESTS_STATIC];
+
+static void virtio_console_transmit(struct virtio_device *dev)
+{
+    struct virtq_chain chain;
+    uint32_t i, j;
+    int sent = 0;
+
+    while (virtq_pop(dev, VIRTIO_CONSOLE_TX, &chain) > 0) {
+        for (i = 0; i < chain.num; i++) {
+            if (chain.seg[i].write)
+                continue;
+            for (j = 0; j < chain.seg[i].len; j++)
+                uart_putc(chain.seg[i].addr[j]);
+        }
+        virtq_push(dev, VIRTIO_CONSOLE_TX, &chain, 0);
+        sent = 1;
+    }
+
+    if (sent)
+        virtio_notify(dev, VIRTIO_CONSOLE_TX);
+}
+
+static void virtio_console_notify(struct virtio_device *dev, uint32_t queue)
+{
+    if (queue == VIRTIO_CONSOLE_TX)
+        virtio_console_transmit(dev);
+}
+
+static const struct virtio_backend _virtio_console_backend = {
+    .name = "console",
+    .device_id = VIRTIO_ID_CONSOLE,
+    .num_queues = 2,
+    .queue_num_max = VIRTIO_CONSOLE_QUEUE_NUM,
+    .features = 0,
+    .config_size = 0,
+    .notify = virtio_console_notify,
+};
+
+static int32_t vdev_virtio_console_read(struct arch_vdev_trigger_info *info,
+                        struct arch_regs *regs)
+{
+    vcpuid_t vmid = guest_current_vmid();
+
+    return virtio_mmio_read(&_console[vmid],
+            info->fipa - _vdev_virtio_console_info.base, info->value,
+            info->sas);
+}
+
+static int32_t vdev_virtio_console_write(struct arch_vdev_trigger_info *info,
+                        struct arch_regs *regs)
+{
+    vcpuid_t vmid = guest_current_vmid();
+
+    return virtio_mmio_write(&_console[vmid],
+            info->fipa - _vdev_virtio_console_info.base, *info->value,
+            info->sas);
+}
+
+static int32_t vdev_virtio_console_post(struct arch_vdev_trigger_info *info,
+                        struct arch_regs *regs)
+{
+    uint8_t isize = 4;
+
+    if (regs->cpsr & 0x20) /* Thumb */
+        isize = 2;
+
+    regs->pc += isize;
+
+    return 0;
+}
+
+static hvmm_status_t vdev_virtio_console_reset(void)
+{
+    int i;
+
+    for (i = guest_first_vmid(); i <= guest_last_vmid(); i++)
+        virtio_device_init(&_console[i], &_virtio_console_backend, i,
+                VIRTIO_CONSOLE_VIRQ, 0);
+
+    return HVMM_STATUS_SUCCESS;
+}
+
+struct vdev_ops _vdev_virtio_console_ops = {
+    .init = vdev_virtio_console_reset,
+    .read = vdev_virtio_console_read,
+    .write = vdev_virtio_console_write,
+    .post = vdev_virtio_console_post,
+};
+
+struct vdev_module _vdev_virtio_console_module = {
+    .name = "K-Hypervisor vDevice virtio Console Module",
+    .author = "Kookmin Univ.",
+    .ops = &_vdev_virtio_console_ops,
+    .map = &_vdev_virtio_console_info,
+};
+
+hvmm_status_t vdev_virtio_console_init()
+{
+    hvmm_status_t result = HVMM_STATUS_BUSY;
+
+    result = vdev_register(VDEV_LEVEL_LOW, &_vdev_virtio_console_module);
+    if (result == HVMM_STATUS_SUCCESS)
+        printh("vdev registered:'%s'\n", _vdev_virtio_console_module.name);
+    else {
+        printh("%s: Unable to register vdev:'%s' code=%x\n",
+                __func__, _vdev_virtio_console_module.name, result);
+    }
+
+    return result;
+}
+vdev_module_low_init(vdev_virtio_console_init);
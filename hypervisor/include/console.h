@@ -0,0 +1,22 @@
+#ifndef __CONSOLE_H__
+#define __CONSOLE_H__
+
+#include <hvmm_types.h>
+
+/**
+ * @brief   Buffered hypervisor console.
+ *
+ * Output written with uart_putc(), and so with printH(), is appended to
+ * a ring and moved to the UART only as far as its TX FIFO has room; the
+ * rest is drained at the next write or by a timer event of the writer's
+ * cpu. Writers wait for the UART only when the ring is full. Until
+ * console_init() and after console_flush() the console is synchronous.
+ */
+void console_putc(const char c);
+void console_flush(void);
+void console_init(void);
+
+/* Stops the cpu once the buffered output is written out */
+#define hyp_abort_infinite() { console_flush(); while (1) ; }
+
+#endif
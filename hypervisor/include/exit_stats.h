@@ -0,0 +1,28 @@
+#ifndef __EXIT_STATS_H__
+#define __EXIT_STATS_H__
+
+#include <hvmm_types.h>
+#include <arch_types.h>
+#include <k-hypervisor-config.h>
+#include <monitor_dump.h>
+
+/**
+ * @brief   Per guest counts and costs of the exits to the hypervisor.
+ *
+ * Every exit is accounted to the guest running when it was taken, by
+ * class: the exception class of a trap, irqs and guest switches. Traps
+ * are further broken down by HVC immediate and by the vdev module that
+ * serves them. Costs are counter ticks spent in the hypervisor, from
+ * the timer_stamp() taken when the exit started.
+ * The classes and the layout of the dump are in <monitor_dump.h>.
+ */
+
+void exit_stats_trap(vcpuid_t vmid, uint32_t ec, uint32_t stamp);
+void exit_stats_hvc(vcpuid_t vmid, uint32_t imm, uint32_t stamp);
+void exit_stats_irq(vcpuid_t vmid, uint32_t stamp);
+void exit_stats_switch(vcpuid_t vmid, uint32_t stamp);
+void exit_stats_vdev(vcpuid_t vmid, int level, int num, uint32_t stamp);
+void exit_stats_reset(void);
+uint32_t exit_stats_dump(uint32_t *buf, uint32_t max_words);
+
+#endif
@@ -29,6 +29,24 @@ struct guest_virqmap {
     struct virqmap_entry map[MAX_IRQS];
 };
 
+/**
+ * @brief   Coalescing parameters of a guest interrupt line.
+ *
+ * A virq is injected once 'threshold' arrivals have been counted, but not
+ * more often than once per 'interval_us'. A partial batch is flushed
+ * 'window_us' after its first arrival. While arrivals are held, the
+ * physical line is masked; arrivals latched by the distributor meanwhile
+ * are counted once it is enabled again.
+ * threshold <= 1 with interval_us == 0 turns coalescing off.
+ */
+struct irq_coalesce_param {
+    uint32_t vmid;
+    uint32_t virq;
+    uint32_t threshold;     /**< Arrivals per injection */
+    uint32_t window_us;     /**< Max delay of a partial batch */
+    uint32_t interval_us;   /**< Min interval between injections */
+};
+
 typedef void (*interrupt_handler_t)(int irq, void *regs, void *pdata);
 
 struct interrupt_ops {
@@ -44,9 +62,15 @@ struct interrupt_ops {
     /** Cofigure interrupt */
     hvmm_status_t (*configure)(uint32_t);
 
+    /** Route interrupt to a processor mask */
+    hvmm_status_t (*set_target)(uint32_t, uint8_t);
+
     /** End of interrupt */
     hvmm_status_t (*end)(uint32_t);
 
+    /** Deactivate interrupt */
+    hvmm_status_t (*deactivate)(uint32_t);
+
     /** Inject to guest */
     hvmm_status_t (*inject)(vcpuid_t, uint32_t, uint32_t, uint8_t);
 
@@ -113,6 +137,7 @@ hvmm_status_t interrupt_request(uint32_t irq, interrupt_handler_t handler);
 hvmm_status_t interrupt_host_enable(uint32_t irq);
 hvmm_status_t interrupt_host_disable(uint32_t irq);
 hvmm_status_t interrupt_host_configure(uint32_t irq);
+hvmm_status_t interrupt_host_set_target(uint32_t irq, uint8_t cpumask);
 hvmm_status_t interrupt_guest_inject(vcpuid_t vmid, uint32_t virq, uint32_t pirq,
                 uint8_t hw);
 hvmm_status_t interrupt_guest_enable(vcpuid_t vmid, uint32_t irq);
@@ -124,5 +149,6 @@ const int32_t interrupt_check_guest_irq(uint32_t pirq);
 const uint32_t interrupt_pirq_to_virq(vcpuid_t vmid, uint32_t pirq);
 const uint32_t interrupt_virq_to_pirq(vcpuid_t vmid, uint32_t virq);
 const uint32_t interrupt_pirq_to_enabled_virq(vcpuid_t vmid, uint32_t pirq);
+hvmm_status_t interrupt_guest_coalesce(struct irq_coalesce_param *param);
 
 #endif
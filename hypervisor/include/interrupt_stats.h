@@ -0,0 +1,26 @@
+#ifndef __INTERRUPT_STATS_H__
+#define __INTERRUPT_STATS_H__
+
+#include <hvmm_types.h>
+#include <arch_types.h>
+#include <k-hypervisor-config.h>
+#include <monitor_dump.h>
+
+/**
+ * @brief   Interrupt latency and rate statistics.
+ *
+ * Timestamps (CNTPCT) are taken at three points of a virq's life:
+ *  - arrival   : physical irq taken in interrupt_service_routine()
+ *  - injection : virq written into a List Register
+ *  - eoi       : guest EOI observed by the maintenance interrupt
+ * The histograms and the layout of the dump are in <monitor_dump.h>.
+ */
+
+void irq_stats_arrival(uint32_t pirq);
+void irq_stats_injected(vcpuid_t vmid, uint32_t slot, uint32_t pirq);
+void irq_stats_eoi(vcpuid_t vmid, uint32_t slot);
+void irq_stats_dropped(vcpuid_t vmid);
+void irq_stats_reset(void);
+uint32_t irq_stats_dump(uint32_t *buf, uint32_t max_words);
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef __IVC_H__
+#define __IVC_H__
+
+#include <hvmm_types.h>
+#include <arch_types.h>
+#include <ivc_ring.h>
+
+/**
+ * @brief   Inter-VM communication channels.
+ *
+ * A channel is a hypervisor allocated, zeroed memory area mapped into the
+ * stage-2 translation of two guests at IVC_CHANNEL_IPA(id), holding two
+ * single-producer/single-consumer rings laid out as in <ivc_ring.h>.
+ * Messages go through the shared memory without a trap, a guest traps
+ * only to ring the doorbell of its peer when the peer is not polling.
+ */
+#define IVC_MAX_CHANNELS        4
+
+/**
+ * @brief   Creates channel 'id' between 'vmid_a' and 'vmid_b' with 'size'
+ *          bytes of data per ring. Called on the boot cpu after the guest
+ *          memory is initialized and before the guests start.
+ * @param size  Power of 2, at least 4KB and at most
+ *              (IVC_CHANNEL_WINDOW - IVC_HEADER_SIZE) / 2.
+ */
+hvmm_status_t ivc_channel_create(uint32_t id, vcpuid_t vmid_a,
+        vcpuid_t vmid_b, uint32_t size);
+
+/**
+ * @brief   Rings the doorbell of channel 'id' on behalf of guest 'vmid',
+ *          injecting the channel's virq into the peer unless the peer
+ *          polls the ring 'vmid' produces into.
+ * @return  HVMM_STATUS_SUCCESS, HVMM_STATUS_IGNORED if the notification
+ *          was suppressed, HVMM_STATUS_BAD_ACCESS if 'vmid' is not an
+ *          endpoint of the channel.
+ */
+hvmm_status_t ivc_doorbell(uint32_t id, vcpuid_t vmid);
+
+#endif
@@ -0,0 +1,22 @@
+#ifndef __LZ4_H__
+#define __LZ4_H__
+
+#include <hvmm_types.h>
+#include <arch_types.h>
+
+/**
+ * @brief   Decompression of LZ4 frames, as written by the lz4 tool.
+ *
+ * Guest images may be stored compressed to cut the time spent reading
+ * them from flash; the hypervisor decompresses them at boot. Checksums
+ * in the frame are skipped and dictionaries are not supported.
+ */
+#define LZ4_FRAME_MAGIC     0x184D2204
+
+uint32_t lz4_frame_length(const uint8_t *src, uint32_t max);
+hvmm_status_t lz4_decompress(const uint8_t *src, uint32_t len,
+        uint8_t *dst, uint32_t dst_max, uint32_t *out_len);
+hvmm_status_t lz4_unpack_in_place(uint8_t *base, uint32_t size,
+        uint32_t *out_len);
+
+#endif
@@ -56,6 +56,13 @@ struct memory_ops {
 
     /** Dump state of the memory */
     hvmm_status_t (*dump)(void);
+
+    /** Translate a guest IPA range to the physical address */
+    uint32_t (*ipa_to_pa)(vcpuid_t vmid, uint32_t ipa, uint32_t size);
+
+    /** Map a physical range into the stage-2 translation of a guest */
+    hvmm_status_t (*map)(vcpuid_t vmid, uint32_t ipa, uint32_t pa,
+            uint32_t size, enum memattr attr);
 };
 
 struct memory_module {
@@ -97,5 +104,18 @@ hvmm_status_t memory_save(void);
 hvmm_status_t memory_restore(vcpuid_t vmid);
 hvmm_status_t memory_init(struct memmap_desc **guest0,
                     struct memmap_desc **guest1);
+/**
+ * @brief Translates the guest IPA range [ipa, ipa + size) of 'vmid'.
+ * @return Physical address of 'ipa', 0 if the range is not mapped by
+ *         a single memory map descriptor.
+ */
+uint32_t memory_guest_ipa_to_pa(vcpuid_t vmid, uint32_t ipa, uint32_t size);
+/**
+ * @brief Maps [pa, pa + size) at 'ipa' of 'vmid' after its translation
+ *        tables are built. The range must be page aligned and must not
+ *        overlap the memory map descriptors of the guest.
+ */
+hvmm_status_t memory_guest_map(vcpuid_t vmid, uint32_t ipa, uint32_t pa,
+        uint32_t size, enum memattr attr);
 
 #endif
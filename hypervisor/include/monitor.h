@@ -16,6 +16,11 @@
 #define MEMORY 2
 #define REGISTER 3
 #define BREAK 4
+#define IRQ_STATS 5
+#define TRACE 6
+#define EXIT_STATS 7
+#define PROFILE 8
+#define PROBE 9
 
 #define NOTFOUND 0
 #define FOUND 1
@@ -55,6 +60,28 @@ enum inst_index {
 #define MONITOR_WRITE_BREAK_GUEST           0x06
 #define MONITOR_WRITE_CLEAN_BREAK_GUEST     0x07
 
+#define MONITOR_READ_IRQ_STATS              0x0e
+#define MONITOR_READ_IRQ_STATS_RESET        0x0f
+#define MONITOR_WRITE_IRQ_COALESCE          0x10
+#define MONITOR_READ_TRACE                  0x11
+#define MONITOR_READ_EXIT_STATS             0x12
+#define MONITOR_READ_EXIT_STATS_RESET       0x13
+#define MONITOR_WRITE_PROFILE               0x14
+#define MONITOR_READ_PROFILE                0x15
+#define MONITOR_READ_PROBE                  0x16
+#define MONITOR_READ_PROBE_RESET            0x17
+
+/* Words of shared memory available to irq statistics dump */
+#define MONITOR_IRQ_STATS_WORDS     0x2000
+/* Words of shared memory available to trace records */
+#define MONITOR_TRACE_WORDS         0x2000
+/* Words of shared memory available to exit statistics snapshot */
+#define MONITOR_EXIT_STATS_WORDS    0x2000
+/* Words of shared memory available to profile samples */
+#define MONITOR_PROFILE_WORDS       0x2000
+/* Words of shared memory available to the probe snapshot */
+#define MONITOR_PROBE_WORDS         0x2000
+
 /* 0xEC00100 : memory dump, 0xEC000D0 : vmid info*/
 struct monitoring_data {
     uint8_t type;
@@ -109,4 +136,15 @@ hvmm_status_t monitor_reboot(struct monitor_vmid *mvmid, uint32_t va);
 hvmm_status_t monitor_init(void);
 hvmm_status_t monitor_recovery(struct monitor_vmid *mvmid, uint32_t va);
 hvmm_status_t monitor_check_status(struct monitor_vmid *mvmid, uint32_t va);
+hvmm_status_t monitor_irq_stats(struct monitor_vmid *mvmid, uint32_t va);
+hvmm_status_t monitor_irq_stats_reset(struct monitor_vmid *mvmid, uint32_t va);
+hvmm_status_t monitor_irq_coalesce(struct monitor_vmid *mvmid, uint32_t va);
+hvmm_status_t monitor_trace(struct monitor_vmid *mvmid, uint32_t va);
+hvmm_status_t monitor_exit_stats(struct monitor_vmid *mvmid, uint32_t va);
+hvmm_status_t monitor_exit_stats_reset(struct monitor_vmid *mvmid,
+                                                uint32_t va);
+hvmm_status_t monitor_profile_set(struct monitor_vmid *mvmid, uint32_t va);
+hvmm_status_t monitor_profile(struct monitor_vmid *mvmid, uint32_t va);
+hvmm_status_t monitor_probe(struct monitor_vmid *mvmid, uint32_t va);
+hvmm_status_t monitor_probe_reset(struct monitor_vmid *mvmid, uint32_t va);
 #endif
@@ -0,0 +1,17 @@
+#ifndef __PMU_H__
+#define __PMU_H__
+
+#include <hvmm_types.h>
+
+/**
+ * @brief   Emulates a guest access to the Performance Monitors, trapped by
+ *          HDCR.TPM and HDCR.TPMCR. 'crm' and 'opc2' select the register
+ *          of MRC/MCR p15, 0, <Rt>, c9, <crm>, <opc2>; a read stores the
+ *          value in 'value'. Called on the cpu of the current guest.
+ * @return  HVMM_STATUS_SUCCESS, or HVMM_STATUS_BAD_ACCESS if the register
+ *          is not a Performance Monitors register.
+ */
+hvmm_status_t vdev_pmu_access(uint32_t crm, uint32_t opc2, uint32_t *value,
+        uint32_t write);
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef __PROBE_H__
+#define __PROBE_H__
+
+#include <hvmm_types.h>
+#include <arch_types.h>
+#include <k-hypervisor-config.h>
+#include <monitor_dump.h>
+#include <timer.h>
+
+/**
+ * @brief   Cost probes around the hypervisor's own subsystems.
+ *
+ * A probe site accumulates the count, min, max and total counter ticks
+ * of the code between probe_start() and probe_end(), per cpu. Probes are
+ * compiled in by CFG_PROBE only; without it they compile to nothing.
+ *
+ *  uint32_t start = probe_start();
+ *  ...
+ *  probe_end(PROBE_VDEV_FIND, start);
+ *
+ * The sites and the layout of the dump are in <monitor_dump.h>.
+ */
+
+#ifdef CFG_PROBE
+#define probe_start()               timer_stamp()
+void probe_end(enum probe_site site, uint32_t start);
+#else
+#define probe_start()               0
+#define probe_end(site, start)      do { (void)(start); } while (0)
+#endif
+
+void probe_reset(void);
+uint32_t probe_dump(uint32_t *buf, uint32_t max_words);
+
+#endif
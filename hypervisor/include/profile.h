@@ -0,0 +1,30 @@
+#ifndef __PROFILE_H__
+#define __PROFILE_H__
+
+#include <hvmm_types.h>
+#include <arch_types.h>
+#include <k-hypervisor-config.h>
+#include <monitor_dump.h>
+
+/**
+ * @brief   Statistical profiler of the guests.
+ *
+ * While enabled, a periodic event of every cpu samples the pc, mode and
+ * vmid of the guest it interrupts into the buffer of the cpu. Samples are
+ * taken out by the monitor, which symbolises them. The layout of the
+ * dump is in <monitor_dump.h>.
+ */
+
+/* Samples per cpu, a power of 2 */
+#define PROFILE_SAMPLES         2048
+#define PROFILE_MIN_PERIOD_US   100
+
+hvmm_status_t profile_set_period(uint32_t period_us);
+/**
+ * @brief   Re-arms the sampling event of the current cpu, called on the
+ *          cpu that sets the period and on GIC_SGI_PROFILE on the others.
+ */
+void profile_sync(void);
+uint32_t profile_drain(uint32_t *buf, uint32_t max_words);
+
+#endif
@@ -0,0 +1,14 @@
+#ifndef __PVCON_H__
+#define __PVCON_H__
+
+#include <hvmm_types.h>
+#include <pvcon_ring.h>
+
+/**
+ * @brief   Drains the paravirtual console of 'vmid' into the hypervisor
+ *          console if the guest kicked it. Called on the cpu of the guest
+ *          when it is switched out, or shortly after its kick.
+ */
+void vdev_pvcon_flush(vcpuid_t vmid);
+
+#endif
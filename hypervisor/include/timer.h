@@ -15,6 +15,42 @@ struct timer_val {
     timer_callback_t callback;
 };
 
+/**
+ * @brief   Software timer, kept in a per-CPU min-heap ordered by expiry.
+ *
+ * The hypervisor timer of a CPU is always programmed to the earliest
+ * expiry of its heap. Callbacks run in the timer interrupt with the
+ * trapped registers and 'data'. An event belongs to the CPU it was added
+ * on and is only modified or canceled there. A periodic event is re-armed
+ * from its previous expiry before its callback runs, the callback may
+ * cancel or modify it.
+ */
+typedef void (*timer_event_callback_t)(void *pregs, void *data);
+
+struct timer_event {
+    uint64_t expires;       /**< Physical counter value of the expiry */
+    uint64_t period;        /**< In counter ticks, 0 for a one-shot */
+    timer_event_callback_t callback;
+    void *data;
+    uint32_t slot;          /**< Heap position + 1, 0 when not armed */
+    uint32_t cpu;
+};
+
+#define TIMER_MAX_EVENTS    32
+
+/**
+ * @brief   Architectural virtual timer (CNTV) state of a guest.
+ */
+struct vtimer_context {
+    uint32_t ctl;       /**< CNTV_CTL */
+    uint64_t cval;      /**< CNTV_CVAL */
+    uint64_t offset;    /**< CNTVOFF, virtual = physical - offset */
+};
+
+#define VTIMER_CTL_ENABLE       (1 << 0)
+#define VTIMER_CTL_IMASK        (1 << 1)
+#define VTIMER_CTL_ISTATUS      (1 << 2)
+
 struct timer_ops {
     /** The init function should only be used in the entire system */
     hvmm_status_t (*init)(void);
@@ -28,9 +64,18 @@ struct timer_ops {
     /** Set timer duration */
     hvmm_status_t (*set_interval)(uint64_t);
 
+    /** Set the absolute expiry, in physical counter ticks */
+    hvmm_status_t (*set_cval)(uint64_t);
+
     /** Dump state of the timer */
     hvmm_status_t (*dump)(void);
 
+    /** Save and stop the virtual timer of the outgoing guest */
+    hvmm_status_t (*vtimer_save)(struct vtimer_context *);
+
+    /** Load the virtual timer of the incoming guest */
+    hvmm_status_t (*vtimer_restore)(struct vtimer_context *);
+
 };
 
 struct timer_module {
@@ -68,12 +113,71 @@ extern struct timer_module _timer_module;
  * prior to calls to other functions of Timer module.
  */
 hvmm_status_t timer_init(uint32_t irq);
+/**
+ * @brief   Sets the tick callback of this CPU. The host timer ticks every
+ *          'interval_us', which must not be 0. The guest callback runs at
+ *          the same tick, its 'interval_us' is not used.
+ */
 hvmm_status_t timer_set(struct timer_val *timer, uint32_t host);
 
+void timer_event_init(struct timer_event *ev, timer_event_callback_t callback,
+        void *data);
+/**
+ * @brief   Arms 'ev' to expire in 'delay_us', then every 'period_us' if it
+ *          is not 0.
+ * @return  HVMM_STATUS_BUSY if 'ev' is armed or the heap of this CPU is
+ *          full.
+ */
+hvmm_status_t timer_event_add(struct timer_event *ev, uint32_t delay_us,
+        uint32_t period_us);
+/**
+ * @brief   Same as timer_event_add(), expiring when the physical counter
+ *          reaches 'expires'.
+ */
+hvmm_status_t timer_event_add_abs(struct timer_event *ev, uint64_t expires,
+        uint32_t period_us);
+/**
+ * @brief   Changes the expiry and period of 'ev', armed or not.
+ */
+hvmm_status_t timer_event_modify(struct timer_event *ev, uint32_t delay_us,
+        uint32_t period_us);
+hvmm_status_t timer_event_cancel(struct timer_event *ev);
+
+static inline uint32_t timer_event_pending(struct timer_event *ev)
+{
+    return ev->slot != 0;
+}
+/**
+ * @brief   Saves the guest's virtual timer and stops it on this CPU.
+ */
+hvmm_status_t timer_vtimer_save(struct vtimer_context *vtimer);
+/**
+ * @brief   Loads the guest's virtual timer, CNTVOFF included.
+ */
+hvmm_status_t timer_vtimer_restore(struct vtimer_context *vtimer);
+
 
 void set_timer_cnt(void);
 uint64_t get_timer_savecnt(void);
 uint64_t get_timer_curcnt(void);
 uint64_t get_timer_cnt(void);
-uint32_t get_timer_interval_us(uint64_t after, uint64_t before);
+/**
+ * @brief   Lower 32 bits of the physical counter. Deltas of two stamps are
+ *          valid modulo 2^32, for intervals far below its wrap.
+ */
+uint32_t timer_stamp(void);
+/**
+ * @brief   Divides 'n' by 'd' without libgcc.
+ */
+uint64_t timer_div64(uint64_t n, uint32_t d);
+/**
+ * @brief   Converts physical counter ticks to microseconds, over the whole
+ *          64-bit range.
+ */
+uint64_t timer_count_to_us(uint64_t count);
+/**
+ * @brief   Converts microseconds to physical counter ticks, saturating at
+ *          the largest count.
+ */
+uint64_t timer_us_to_count(uint64_t time_us);
 #endif
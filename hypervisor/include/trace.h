@@ -0,0 +1,41 @@
+#ifndef __TRACE_H__
+#define __TRACE_H__
+
+#include <hvmm_types.h>
+#include <arch_types.h>
+#include <k-hypervisor-config.h>
+#include <monitor_dump.h>
+
+/**
+ * @brief   Binary trace of hypervisor events.
+ *
+ * Every cpu records into its own ring of fixed-size records, without locks
+ * and without formatting. The ring keeps the latest TRACE_RING_RECORDS
+ * records, older ones are overwritten. Records are drained by the monitor,
+ * see trace_drain().
+ *
+ * Events are enabled at compile time by CFG_TRACE_EVENT_MASK, a disabled
+ * trace_event() compiles to nothing. The events, the record and the
+ * layout of the dump are in <monitor_dump.h>.
+ */
+
+#define TRACE_EV_BIT(id)        (1 << (id))
+#define TRACE_EV_ALL            (TRACE_EV_BIT(TRACE_EV_NUM) - 1)
+
+#ifndef CFG_TRACE_EVENT_MASK
+#define CFG_TRACE_EVENT_MASK    0
+#endif
+
+/* Records per cpu, a power of 2 */
+#define TRACE_RING_RECORDS      512
+
+#define trace_event(id, a0, a1, a2)                         \
+    do {                                                    \
+        if (CFG_TRACE_EVENT_MASK & TRACE_EV_BIT(id))        \
+            trace_record((id), (a0), (a1), (a2));           \
+    } while (0)
+
+void trace_record(uint32_t event, uint32_t a0, uint32_t a1, uint32_t a2);
+uint32_t trace_drain(uint32_t *buf, uint32_t max_words);
+
+#endif
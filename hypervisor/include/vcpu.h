@@ -172,11 +172,20 @@ void guest_sched_start(void);
 vcpuid_t guest_first_vmid(void);
 vcpuid_t guest_last_vmid(void);
 vcpuid_t guest_next_vmid(vcpuid_t ofvmid);
+/**
+ * @brief   Returns the physical CPU that hosts the guest 'vmid'.
+ */
+uint32_t guest_vmid_to_cpu(vcpuid_t vmid);
+/**
+ * @brief   Returns 1 if the guest 'vmid' is currently running on its CPU.
+ */
+uint8_t guest_is_running(vcpuid_t vmid);
 vcpuid_t guest_current_vmid(void);
 vcpuid_t guest_waiting_vmid(void);
 hvmm_status_t guest_switchto(vcpuid_t vmid, uint8_t locked);
 extern void __mon_switch_to_guest_context(struct arch_regs *regs);
 hvmm_status_t guest_init();
+hvmm_status_t guest_image_unpack(vcpuid_t vmid, uint32_t base);
 struct vcpu get_guest(uint32_t guest_num);
 void reboot_guest(vcpuid_t vmid, uint32_t pc, struct arch_regs **regs);
 void set_manually_select_vmid(vcpuid_t vmid);
@@ -21,6 +21,12 @@ enum vdev_level {
 #define VDEV_ERROR -1
 #define VDEV_NOT_FOUND -1
 
+/*
+ * HVC immediate of SMCCC style calls, the service is selected by the
+ * function ID in r0.
+ */
+#define VDEV_HVC_IMM_SMCCC  0x0
+
 struct arch_vdev_trigger_info {
     /** Exception Class */
     uint32_t ec;
@@ -128,17 +134,62 @@ struct vdev_module {
     /** Virtual Device Operation */
     struct vdev_ops *ops;
 
+    /**
+     * MMIO range emulated by the module, VDEV_LEVEL_LOW only.
+     * Faults in the range are dispatched without calling ops->check().
+     */
+    struct vdev_memory_map *map;
+
 };
 
 hvmm_status_t vdev_register(int level, struct vdev_module *module);
 int32_t vdev_find(int level, struct arch_vdev_trigger_info *info,
         struct arch_regs *regs);
+/**
+ * @brief   Looks up the VDEV_LEVEL_LOW module whose mapped range, of
+ *          struct vdev_module.map or vdev_map_guest(), contains 'fipa' for
+ *          the current guest. The range is returned in 'range' if not NULL.
+ * @return  Virtual device number or VDEV_NOT_FOUND.
+ */
+int32_t vdev_find_mapped(uint32_t fipa, struct vdev_memory_map *range);
 int32_t vdev_read(int level, int num, struct arch_vdev_trigger_info *info,
             struct arch_regs *regs);
 int32_t vdev_write(int level, int num, struct arch_vdev_trigger_info *info,
             struct arch_regs *regs);
 hvmm_status_t vdev_post(int level, int num, struct arch_vdev_trigger_info *info,
             struct arch_regs *regs);
+/**
+ * @brief   Maps an MMIO range of a registered VDEV_LEVEL_LOW module for one
+ *          guest only. Guest ranges take precedence over the ranges of
+ *          struct vdev_module.map.
+ */
+hvmm_status_t vdev_map_guest(vcpuid_t vmid, struct vdev_module *module,
+        struct vdev_memory_map *map);
+/**
+ * @brief   Binds an HVC to a registered VDEV_LEVEL_MIDDLE module. Calls
+ *          with immediate 'imm' are dispatched to ops->write() without
+ *          calling ops->check(). 'fid' is the function ID in r0 when 'imm'
+ *          is VDEV_HVC_IMM_SMCCC and is ignored otherwise.
+ */
+hvmm_status_t vdev_hvc_bind(struct vdev_module *module, uint32_t imm,
+        uint32_t fid);
+/**
+ * @brief   Marks an MMIO range of a registered VDEV_LEVEL_LOW module as
+ *          coalesced. Guest writes to the range are appended to a per-guest
+ *          ring instead of calling ops->write(), and are replayed in order
+ *          by vdev_coalesced_flush(). Only for registers whose writes have
+ *          no immediate side effect; the replayed ops->write() is called
+ *          with a NULL arch_regs.
+ */
+hvmm_status_t vdev_coalesce(struct vdev_module *module,
+        struct vdev_memory_map *map);
+/**
+ * @brief   Replays the buffered writes of 'vmid', in the context of 'vmid'.
+ *          Called at the next read of an emulated device, when the guest
+ *          is switched out, and at the latest 1ms after the first write
+ *          buffered while the guest keeps running.
+ */
+void vdev_coalesced_flush(vcpuid_t vmid);
 hvmm_status_t vdev_save(vcpuid_t vmid);
 hvmm_status_t vdev_restore(vcpuid_t vmid);
 hvmm_status_t vdev_init(void);
@@ -0,0 +1,186 @@
+#ifndef __VIRTIO_H__
+#define __VIRTIO_H__
+
+#include <hvmm_types.h>
+#include <arch_types.h>
+#include <vdev.h>
+
+/**
+ * @brief   virtio-mmio transport, version 2 (virtio 1.0) register map.
+ *
+ * A device model is a VDEV_LEVEL_LOW module whose MMIO window is served by
+ * virtio_mmio_read()/virtio_mmio_write(). The driver's split virtqueues
+ * live in guest memory and are accessed in place: a QueueNotify write
+ * calls the backend, which pops descriptor chains, completes them and
+ * raises the device's virq.
+ */
+#define VIRTIO_MMIO_MAGIC_VALUE         0x000
+#define VIRTIO_MMIO_VERSION             0x004
+#define VIRTIO_MMIO_DEVICE_ID           0x008
+#define VIRTIO_MMIO_VENDOR_ID           0x00c
+#define VIRTIO_MMIO_DEVICE_FEATURES     0x010
+#define VIRTIO_MMIO_DEVICE_FEATURES_SEL 0x014
+#define VIRTIO_MMIO_DRIVER_FEATURES     0x020
+#define VIRTIO_MMIO_DRIVER_FEATURES_SEL 0x024
+#define VIRTIO_MMIO_QUEUE_SEL           0x030
+#define VIRTIO_MMIO_QUEUE_NUM_MAX       0x034
+#define VIRTIO_MMIO_QUEUE_NUM           0x038
+#define VIRTIO_MMIO_QUEUE_READY         0x044
+#define VIRTIO_MMIO_QUEUE_NOTIFY        0x050
+#define VIRTIO_MMIO_INTERRUPT_STATUS    0x060
+#define VIRTIO_MMIO_INTERRUPT_ACK       0x064
+#define VIRTIO_MMIO_STATUS              0x070
+#define VIRTIO_MMIO_QUEUE_DESC_LOW      0x080
+#define VIRTIO_MMIO_QUEUE_DESC_HIGH     0x084
+#define VIRTIO_MMIO_QUEUE_AVAIL_LOW     0x090
+#define VIRTIO_MMIO_QUEUE_AVAIL_HIGH    0x094
+#define VIRTIO_MMIO_QUEUE_USED_LOW      0x0a0
+#define VIRTIO_MMIO_QUEUE_USED_HIGH     0x0a4
+#define VIRTIO_MMIO_CONFIG_GENERATION   0x0fc
+#define VIRTIO_MMIO_CONFIG              0x100
+#define VIRTIO_MMIO_SIZE                0x200
+
+#define VIRTIO_MMIO_MAGIC               0x74726976
+#define VIRTIO_MMIO_VERSION_2           2
+#define VIRTIO_MMIO_VENDOR              0x4B48
+
+/* Device status */
+#define VIRTIO_STATUS_ACKNOWLEDGE       0x01
+#define VIRTIO_STATUS_DRIVER            0x02
+#define VIRTIO_STATUS_DRIVER_OK         0x04
+#define VIRTIO_STATUS_FEATURES_OK       0x08
+#define VIRTIO_STATUS_NEEDS_RESET       0x40
+#define VIRTIO_STATUS_FAILED            0x80
+
+/* Interrupt status */
+#define VIRTIO_INT_USED_RING            0x1
+#define VIRTIO_INT_CONFIG               0x2
+
+/* Device independent feature bits */
+#define VIRTIO_F_VERSION_1              32
+
+/* Device IDs */
+#define VIRTIO_ID_BLOCK                 2
+#define VIRTIO_ID_CONSOLE               3
+
+/* Split virtqueue layout */
+#define VIRTQ_DESC_F_NEXT               0x1
+#define VIRTQ_DESC_F_WRITE              0x2
+#define VIRTQ_AVAIL_F_NO_INTERRUPT      0x1
+
+struct virtq_desc {
+    uint64_t addr;
+    uint32_t len;
+    uint16_t flags;
+    uint16_t next;
+};
+
+struct virtq_avail {
+    uint16_t flags;
+    uint16_t idx;
+    uint16_t ring[];
+};
+
+struct virtq_used_elem {
+    uint32_t id;
+    uint32_t len;
+};
+
+struct virtq_used {
+    uint16_t flags;
+    uint16_t idx;
+    struct virtq_used_elem ring[];
+};
+
+#define VIRTIO_MAX_QUEUES               2
+#define VIRTQ_MAX_SEGS                  16
+#define VIRTQ_ERROR                     -1
+
+struct virtqueue {
+    uint32_t num;
+    uint32_t ready;
+    uint32_t desc_addr[2];
+    uint32_t avail_addr[2];
+    uint32_t used_addr[2];
+    /* Hypervisor addresses of the rings, valid while ready */
+    volatile struct virtq_desc *desc;
+    volatile struct virtq_avail *avail;
+    volatile struct virtq_used *used;
+    uint16_t last_avail;
+};
+
+/* Buffer of a descriptor chain, at its hypervisor address */
+struct virtq_seg {
+    uint8_t *addr;
+    uint32_t len;
+    uint32_t write;
+};
+
+struct virtq_chain {
+    uint16_t head;
+    uint16_t num;
+    struct virtq_seg seg[VIRTQ_MAX_SEGS];
+};
+
+struct virtio_device;
+
+struct virtio_backend {
+    const char *name;
+    uint32_t device_id;
+    uint32_t num_queues;
+    uint32_t queue_num_max;
+    /** Device specific feature bits, VIRTIO_F_VERSION_1 is implied */
+    uint64_t features;
+    uint32_t config_size;
+
+    /** Reads the aligned word at 'offset' of the configuration space */
+    uint32_t (*read_config)(struct virtio_device *dev, uint32_t offset);
+
+    /** The driver made buffers available in 'queue' */
+    void (*notify)(struct virtio_device *dev, uint32_t queue);
+
+    /** The driver reset the device */
+    void (*reset)(struct virtio_device *dev);
+};
+
+struct virtio_device {
+    const struct virtio_backend *backend;
+    vcpuid_t vmid;
+    uint32_t virq;
+    uint32_t status;
+    uint32_t device_features_sel;
+    uint32_t driver_features_sel;
+    uint32_t driver_features[2];
+    uint32_t queue_sel;
+    uint32_t interrupt_status;
+    struct virtqueue vq[VIRTIO_MAX_QUEUES];
+    void *priv;
+};
+
+void virtio_device_init(struct virtio_device *dev,
+        const struct virtio_backend *backend, vcpuid_t vmid,
+        uint32_t virq, void *priv);
+int32_t virtio_mmio_read(struct virtio_device *dev, uint32_t offset,
+        uint32_t *value, enum vdev_access_size sas);
+int32_t virtio_mmio_write(struct virtio_device *dev, uint32_t offset,
+        uint32_t value, enum vdev_access_size sas);
+
+/**
+ * @brief   Takes the next available descriptor chain of 'queue'.
+ * @return  1 if a chain was taken, 0 if the queue is empty, VIRTQ_ERROR if
+ *          the chain is malformed, the device then needs a reset.
+ */
+int virtq_pop(struct virtio_device *dev, uint32_t queue,
+        struct virtq_chain *chain);
+/**
+ * @brief   Returns a chain to the used ring, 'len' bytes were written to
+ *          its device writable buffers.
+ */
+void virtq_push(struct virtio_device *dev, uint32_t queue,
+        struct virtq_chain *chain, uint32_t len);
+/**
+ * @brief   Raises the used buffer interrupt unless the driver suppressed it.
+ */
+void virtio_notify(struct virtio_device *dev, uint32_t queue);
+
+#endif
@@ -5,6 +5,9 @@
 #include <log/uart_print.h>
 #include <interrupt.h>
 #include <smp.h>
+#include <interrupt_stats.h>
+#include <trace.h>
+#include <timer.h>
 
 #define VIRQ_MIN_VALID_PIRQ 16
 #define VIRQ_NUM_MAX_PIRQS  MAX_IRQS
@@ -22,6 +25,27 @@ static struct guest_virqmap *_guest_virqmap;
 static interrupt_handler_t _host_ppi_handlers[NUM_CPUS][MAX_PPI_IRQS];
 static interrupt_handler_t _host_spi_handlers[MAX_IRQS];
 
+#define IRQ_COALESCE_ENTRIES    16
+
+/**
+ * @brief   Coalescing state of a (guest, virq) line.
+ */
+struct irq_coalesce {
+    struct irq_coalesce_param param;
+    uint8_t in_use;
+    uint8_t masked;         /**< Physical line masked while arrivals are held */
+    uint32_t pirq;
+    uint32_t cpu;           /**< CPU that took the held arrivals */
+    uint32_t count;         /**< Arrivals not injected yet */
+    uint64_t first;         /**< Arrival of the oldest held event */
+    uint64_t last_inject;
+    struct timer_event flush;   /**< Injects the held batch, on 'cpu' */
+};
+
+static struct irq_coalesce _irq_coalesce[IRQ_COALESCE_ENTRIES];
+static uint32_t _irq_coalesce_num;
+static DEFINE_SPINLOCK(_irq_coalesce_lock);
+
 const int32_t interrupt_check_guest_irq(uint32_t pirq)
 {
     int i;
@@ -119,6 +143,17 @@ hvmm_status_t interrupt_host_configure(uint32_t irq)
     return ret;
 }
 
+hvmm_status_t interrupt_host_set_target(uint32_t irq, uint8_t cpumask)
+{
+    hvmm_status_t ret = HVMM_STATUS_UNKNOWN_ERROR;
+
+    /* host_interrupt_set_target() */
+    if (_host_ops->set_target)
+        ret = _host_ops->set_target(irq, cpumask);
+
+    return ret;
+}
+
 hvmm_status_t interrupt_guest_enable(vcpuid_t vmid, uint32_t irq)
 {
     hvmm_status_t ret = HVMM_STATUS_UNKNOWN_ERROR;
@@ -139,16 +174,210 @@ hvmm_status_t interrupt_guest_disable(vcpuid_t vmid, uint32_t irq)
     return ret;
 }
 
+static struct irq_coalesce *irq_coalesce_find(vcpuid_t vmid, uint32_t virq)
+{
+    int i;
+
+    for (i = 0; i < IRQ_COALESCE_ENTRIES; i++) {
+        if (_irq_coalesce[i].in_use && _irq_coalesce[i].param.vmid == vmid &&
+                _irq_coalesce[i].param.virq == virq)
+            return &_irq_coalesce[i];
+    }
+    return 0;
+}
+
+static inline uint8_t irq_coalesce_rate_ok(struct irq_coalesce *c,
+                uint64_t now)
+{
+    return (now - c->last_inject) >=
+        (uint64_t)c->param.interval_us * COUNT_PER_USEC;
+}
+
+/*
+ * Injects the held arrivals of a batch at once. The physical irq has
+ * already been deactivated, so the virq is not linked to it.
+ */
+static void irq_coalesce_flush(struct irq_coalesce *c, uint64_t now)
+{
+    if (c->masked) {
+        _host_ops->enable(c->pirq);
+        c->masked = 0;
+    }
+    if (c->count) {
+        c->count = 0;
+        c->last_inject = now;
+        interrupt_guest_inject(c->param.vmid, c->param.virq, c->pirq,
+                INJECT_SW);
+    }
+}
+
+/* Counter value at which the held batch of 'c' is due */
+static uint64_t irq_coalesce_due(struct irq_coalesce *c)
+{
+    uint64_t due = c->last_inject +
+        (uint64_t)c->param.interval_us * COUNT_PER_USEC;
+    uint64_t window = c->first +
+        (uint64_t)c->param.window_us * COUNT_PER_USEC;
+
+    if (c->count < c->param.threshold && window > due)
+        due = window;
+
+    return due;
+}
+
+/*
+ * (Re)arms the flush event of 'c' on this CPU. An event still armed on
+ * another CPU is left alone, its callback re-evaluates the batch there.
+ */
+static void irq_coalesce_arm(struct irq_coalesce *c)
+{
+    if (timer_event_cancel(&c->flush))
+        return;
+    timer_event_add_abs(&c->flush, irq_coalesce_due(c), 0);
+}
+
+static void irq_coalesce_expired(void *pregs, void *data)
+{
+    struct irq_coalesce *c = data;
+    uint64_t now = get_timer_curcnt();
+
+    spin_lock(&_irq_coalesce_lock);
+    if (c->in_use && c->count) {
+        if (now >= irq_coalesce_due(c))
+            irq_coalesce_flush(c, now);
+        else
+            irq_coalesce_arm(c);
+    }
+    spin_unlock(&_irq_coalesce_lock);
+}
+
+/*
+ * Injects a physical irq arrival to a guest, or holds it back if the line
+ * is coalesced. Held arrivals are acknowledged and their line masked here,
+ * and delivered by the flush event of the line, armed for the end of the
+ * window or of the minimum interval.
+ */
+static void interrupt_guest_inject_coalesced(vcpuid_t vmid, uint32_t virq,
+                uint32_t pirq)
+{
+    struct irq_coalesce *c = 0;
+    uint64_t now;
+
+    if (_irq_coalesce_num) {
+        spin_lock(&_irq_coalesce_lock);
+        c = irq_coalesce_find(vmid, virq);
+        if (!c)
+            spin_unlock(&_irq_coalesce_lock);
+    }
+    if (!c) {
+        interrupt_guest_inject(vmid, virq, pirq, INJECT_HW);
+        return;
+    }
+
+    now = get_timer_curcnt();
+    c->pirq = pirq;
+    c->cpu = smp_processor_id();
+    if (c->count++ == 0)
+        c->first = now;
+
+    if (c->count >= c->param.threshold && irq_coalesce_rate_ok(c, now)) {
+        c->count = 0;
+        c->last_inject = now;
+        timer_event_cancel(&c->flush);
+        spin_unlock(&_irq_coalesce_lock);
+        interrupt_guest_inject(vmid, virq, pirq, INJECT_HW);
+        return;
+    }
+
+    /*
+     * Keep the line quiet while the arrival is held: a level triggered
+     * device would raise it again as soon as it is deactivated. It is
+     * enabled again when the batch is injected.
+     */
+    if (!c->masked) {
+        _host_ops->disable(pirq);
+        c->masked = 1;
+    }
+    if (c->count == 1 || c->count == c->param.threshold)
+        irq_coalesce_arm(c);
+    _guest_ops->deactivate(pirq);
+    spin_unlock(&_irq_coalesce_lock);
+}
+
+hvmm_status_t interrupt_guest_coalesce(struct irq_coalesce_param *param)
+{
+    hvmm_status_t ret = HVMM_STATUS_SUCCESS;
+    struct irq_coalesce *c;
+    int i;
+
+    if (param->vmid >= NUM_GUESTS_STATIC || param->virq >= MAX_IRQS)
+        return HVMM_STATUS_BAD_ACCESS;
+
+    spin_lock(&_irq_coalesce_lock);
+    c = irq_coalesce_find(param->vmid, param->virq);
+    if (param->threshold <= 1 && param->interval_us == 0) {
+        /* Coalescing off, deliver what is still held */
+        if (c) {
+            irq_coalesce_flush(c, get_timer_curcnt());
+            timer_event_cancel(&c->flush);
+            c->in_use = 0;
+            _irq_coalesce_num--;
+        }
+    } else {
+        for (i = 0; !c && i < IRQ_COALESCE_ENTRIES; i++) {
+            if (!_irq_coalesce[i].in_use) {
+                c = &_irq_coalesce[i];
+                c->count = 0;
+                c->masked = 0;
+                c->last_inject = 0;
+                /* Still armed on another CPU if torn down from here */
+                if (!timer_event_pending(&c->flush))
+                    timer_event_init(&c->flush, irq_coalesce_expired, c);
+                c->in_use = 1;
+                _irq_coalesce_num++;
+            }
+        }
+        if (c) {
+            c->param = *param;
+            if (c->param.threshold == 0)
+                c->param.threshold = 1;
+        } else
+            ret = HVMM_STATUS_BUSY;
+    }
+    spin_unlock(&_irq_coalesce_lock);
+
+    return ret;
+}
+
 static void interrupt_inject_enabled_guest(int num_of_guests, uint32_t irq)
 {
     int i;
     uint32_t virq;
 
+    /*
+     * A PPI is private to this CPU, e.g. the virtual timer; it belongs
+     * to the guest running here if that guest has it enabled. No other
+     * guest may take it: their EOI would deactivate the PPI of another
+     * CPU, or of a guest that is not running.
+     */
+    if (irq < MAX_PPI_IRQS) {
+        i = guest_current_vmid();
+        if (i < num_of_guests) {
+            virq = interrupt_pirq_to_enabled_virq(i, irq);
+            if (virq != VIRQ_INVALID) {
+                interrupt_guest_inject_coalesced(i, virq, irq);
+                return;
+            }
+        }
+        _guest_ops->deactivate(irq);
+        return;
+    }
+
     for (i = 0; i < num_of_guests; i++) {
         virq = interrupt_pirq_to_enabled_virq(i, irq);
         if (virq == VIRQ_INVALID)
             continue;
-        interrupt_guest_inject(i, virq, irq, INJECT_HW);
+        interrupt_guest_inject_coalesced(i, virq, irq);
     }
 }
 
@@ -184,6 +413,8 @@ void interrupt_service_routine(int irq, void *current_regs, void *pdata)
                 }
             }
 #endif
+            irq_stats_arrival(irq);
+            trace_event(TRACE_EV_IRQ, irq, 0, 0);
             /* IRQ INJECTION */
             /* priority drop only for hanlding irq in guest */
             /* guest_interrupt_end() */
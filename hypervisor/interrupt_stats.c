@@ -0,0 +1,195 @@
+/*
+ * interrupt_stats.c
+ * --------------------------------------
+ * Interrupt latency and rate statistics
+ */
+
+#include <interrupt_stats.h>
+#include <timer.h>
+#include <vgic.h>
+#include <smp.h>
+#include <asm-arm_inline.h>
+
+struct irq_stats_guest {
+    uint32_t injected;
+    uint32_t eoi;
+    uint32_t dropped;
+    uint32_t hist[IRQ_STATS_NUM_STAGES][IRQ_STATS_BUCKETS];
+};
+
+struct irq_stats_pirq {
+    uint32_t arrived;
+    uint32_t injected;
+    uint32_t max_latency;
+};
+
+static struct irq_stats_guest _guest_stats[NUM_GUESTS_STATIC];
+static struct irq_stats_pirq _pirq_stats[MAX_IRQS];
+
+/*
+ * Lower 32 bits of CNTPCT, deltas are computed modulo 2^32.
+ * An SPI may be taken on one CPU and injected by another through the
+ * mailboxes, so its arrival is kept per pirq. SGIs and PPIs are banked
+ * per CPU and injected by the CPU that took them.
+ */
+#define IRQ_STATS_NUM_BANKED    32
+static uint32_t _arrival_stamp[MAX_IRQS];
+static uint32_t _banked_arrival_stamp[NUM_CPUS][IRQ_STATS_NUM_BANKED];
+static uint32_t _inject_stamp[NUM_GUESTS_STATIC][VGIC_NUM_MAX_SLOTS];
+static uint64_t _reset_stamp;
+
+static inline uint32_t *irq_stats_arrival_stamp(uint32_t pirq)
+{
+    if (pirq < IRQ_STATS_NUM_BANKED)
+        return &_banked_arrival_stamp[smp_processor_id()][pirq];
+
+    return &_arrival_stamp[pirq];
+}
+
+static inline uint32_t irq_stats_bucket(uint32_t ticks)
+{
+    if (ticks == 0)
+        return 0;
+
+    return 31 - asm_clz(ticks);
+}
+
+static void irq_stats_account(vcpuid_t vmid, enum irq_stats_stage stage,
+                uint32_t ticks)
+{
+    _guest_stats[vmid].hist[stage][irq_stats_bucket(ticks)]++;
+}
+
+/**
+ * @brief   Records the arrival of a physical irq routed to a guest.
+ */
+void irq_stats_arrival(uint32_t pirq)
+{
+    if (pirq >= MAX_IRQS)
+        return;
+
+    *irq_stats_arrival_stamp(pirq) = timer_stamp();
+    _pirq_stats[pirq].arrived++;
+}
+
+/**
+ * @brief   Records a virq written into List Register 'slot' of 'vmid'.
+ *
+ * The arrival to injection latency is accounted only for virqs backed by
+ * a physical irq whose arrival has been recorded.
+ */
+void irq_stats_injected(vcpuid_t vmid, uint32_t slot, uint32_t pirq)
+{
+    uint32_t now = timer_stamp();
+    uint32_t *arrival;
+
+    if (vmid >= NUM_GUESTS_STATIC || slot >= VGIC_NUM_MAX_SLOTS)
+        return;
+
+    _guest_stats[vmid].injected++;
+    _inject_stamp[vmid][slot] = now;
+
+    if (pirq >= MAX_IRQS)
+        return;
+
+    arrival = irq_stats_arrival_stamp(pirq);
+    if (*arrival) {
+        uint32_t ticks = now - *arrival;
+
+        *arrival = 0;
+        irq_stats_account(vmid, IRQ_STATS_ARRIVAL_TO_INJECT, ticks);
+        _pirq_stats[pirq].injected++;
+        if (ticks > _pirq_stats[pirq].max_latency)
+            _pirq_stats[pirq].max_latency = ticks;
+    }
+}
+
+/**
+ * @brief   Records the guest EOI of the virq in List Register 'slot'.
+ */
+void irq_stats_eoi(vcpuid_t vmid, uint32_t slot)
+{
+    uint32_t now = timer_stamp();
+
+    if (vmid >= NUM_GUESTS_STATIC || slot >= VGIC_NUM_MAX_SLOTS)
+        return;
+
+    _guest_stats[vmid].eoi++;
+    if (_inject_stamp[vmid][slot]) {
+        irq_stats_account(vmid, IRQ_STATS_INJECT_TO_EOI,
+                now - _inject_stamp[vmid][slot]);
+        _inject_stamp[vmid][slot] = 0;
+    }
+}
+
+/**
+ * @brief   Records a virq to 'vmid' lost because no queue could hold it.
+ */
+void irq_stats_dropped(vcpuid_t vmid)
+{
+    if (vmid >= NUM_GUESTS_STATIC)
+        return;
+
+    _guest_stats[vmid].dropped++;
+}
+
+void irq_stats_reset(void)
+{
+    uint32_t *p;
+    int i;
+
+    p = (uint32_t *)_guest_stats;
+    for (i = 0; i < sizeof(_guest_stats) / sizeof(uint32_t); i++)
+        p[i] = 0;
+    p = (uint32_t *)_pirq_stats;
+    for (i = 0; i < sizeof(_pirq_stats) / sizeof(uint32_t); i++)
+        p[i] = 0;
+
+    _reset_stamp = get_timer_curcnt();
+}
+
+/**
+ * @brief   Serializes the statistics into 'buf', see interrupt_stats.h
+ *          for the layout. pirqs that never arrived are omitted.
+ * @return  Number of words written.
+ */
+uint32_t irq_stats_dump(uint32_t *buf, uint32_t max_words)
+{
+    uint32_t n = 0;
+    uint32_t *num_pirqs;
+    int i, j, k;
+
+    if (max_words < IRQ_STATS_HEADER_WORDS +
+            NUM_GUESTS_STATIC * IRQ_STATS_GUEST_WORDS + 1)
+        return 0;
+
+    buf[n++] = (uint32_t)(get_timer_curcnt() - _reset_stamp);
+    buf[n++] = COUNT_PER_USEC;
+    buf[n++] = NUM_GUESTS_STATIC;
+    buf[n++] = IRQ_STATS_BUCKETS;
+
+    for (i = 0; i < NUM_GUESTS_STATIC; i++) {
+        buf[n++] = _guest_stats[i].injected;
+        buf[n++] = _guest_stats[i].eoi;
+        buf[n++] = _guest_stats[i].dropped;
+        for (j = 0; j < IRQ_STATS_NUM_STAGES; j++)
+            for (k = 0; k < IRQ_STATS_BUCKETS; k++)
+                buf[n++] = _guest_stats[i].hist[j][k];
+    }
+
+    num_pirqs = &buf[n++];
+    *num_pirqs = 0;
+    for (i = 0; i < MAX_IRQS; i++) {
+        if (_pirq_stats[i].arrived == 0)
+            continue;
+        if (n + IRQ_STATS_PIRQ_WORDS > max_words)
+            break;
+        buf[n++] = i;
+        buf[n++] = _pirq_stats[i].arrived;
+        buf[n++] = _pirq_stats[i].injected;
+        buf[n++] = _pirq_stats[i].max_latency;
+        (*num_pirqs)++;
+    }
+
+    return n;
+}
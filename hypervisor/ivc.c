@@ -0,0 +1,95 @@
+/*
+ * ivc.c
+ * --------------------------------------
+ * Shared memory channels between guests
+ */
+
+#include <ivc.h>
+#include <memory.h>
+#include <interrupt.h>
+#include <k-hypervisor-config.h>
+#include <log/print.h>
+#include <log/string.h>
+
+struct ivc_channel {
+    uint32_t active;
+    vcpuid_t vmid[2];
+    struct ivc_shared *shm;
+};
+
+/* Set up before the guests start, read only afterwards */
+static struct ivc_channel _ivc_channels[IVC_MAX_CHANNELS];
+
+hvmm_status_t ivc_channel_create(uint32_t id, vcpuid_t vmid_a,
+        vcpuid_t vmid_b, uint32_t size)
+{
+    struct ivc_channel *ch;
+    uint32_t total = IVC_HEADER_SIZE + 2 * size;
+    uint32_t base;
+    hvmm_status_t ret;
+
+    if (id >= IVC_MAX_CHANNELS || _ivc_channels[id].active ||
+            vmid_a >= NUM_GUESTS_STATIC || vmid_b >= NUM_GUESTS_STATIC ||
+            vmid_a == vmid_b || size < SZ_4K || (size & (size - 1)) ||
+            total > IVC_CHANNEL_WINDOW)
+        return HVMM_STATUS_BAD_ACCESS;
+
+    /* The heap is identity mapped, align the area to a page */
+    base = (uint32_t)memory_alloc(total + SZ_4K);
+    if (!base) {
+        printh("ivc: no memory for channel %d\n", id);
+        return HVMM_STATUS_BUSY;
+    }
+    base = (base + SZ_4K - 1) & ~(SZ_4K - 1);
+    memset((void *)base, 0, total);
+
+    ch = &_ivc_channels[id];
+    ch->vmid[0] = vmid_a;
+    ch->vmid[1] = vmid_b;
+    ch->shm = (struct ivc_shared *)base;
+    ch->shm->magic = IVC_MAGIC;
+    ch->shm->id = id;
+    ch->shm->ring_size = size;
+
+    ret = memory_guest_map(vmid_a, IVC_CHANNEL_IPA(id), base, total,
+            MEMATTR_NORMAL_OWB | MEMATTR_NORMAL_IWB);
+    if (!ret)
+        ret = memory_guest_map(vmid_b, IVC_CHANNEL_IPA(id), base, total,
+                MEMATTR_NORMAL_OWB | MEMATTR_NORMAL_IWB);
+    if (ret) {
+        printh("ivc: channel %d could not be mapped\n", id);
+        return ret;
+    }
+
+    ch->active = 1;
+    printh("ivc: channel %d, guest %d <-> guest %d, %d bytes per ring\n",
+            id, vmid_a, vmid_b, size);
+
+    return HVMM_STATUS_SUCCESS;
+}
+
+hvmm_status_t ivc_doorbell(uint32_t id, vcpuid_t vmid)
+{
+    struct ivc_channel *ch;
+    uint32_t ring;
+    vcpuid_t peer;
+
+    if (id >= IVC_MAX_CHANNELS || !_ivc_channels[id].active)
+        return HVMM_STATUS_BAD_ACCESS;
+
+    ch = &_ivc_channels[id];
+    if (vmid == ch->vmid[0]) {
+        ring = IVC_RING_A_TO_B;
+        peer = ch->vmid[1];
+    } else if (vmid == ch->vmid[1]) {
+        ring = IVC_RING_B_TO_A;
+        peer = ch->vmid[0];
+    } else {
+        return HVMM_STATUS_BAD_ACCESS;
+    }
+
+    if (!ivc_ring_need_doorbell(ch->shm, ring))
+        return HVMM_STATUS_IGNORED;
+
+    return interrupt_guest_inject(peer, IVC_CHANNEL_VIRQ(id), 0, INJECT_SW);
+}
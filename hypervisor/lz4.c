@@ -0,0 +1,235 @@
+/*
+ * lz4.c
+ * --------------------------------------
+ * Decompression of LZ4 frames, for the compressed guest images
+ */
+
+#include <lz4.h>
+#include <log/string.h>
+
+#define LZ4_FLG_VERSION_MASK    0xC0
+#define LZ4_FLG_VERSION         0x40
+#define LZ4_FLG_BLOCK_CHECKSUM  0x10
+#define LZ4_FLG_CONTENT_SIZE    0x08
+#define LZ4_FLG_CONTENT_CHECKSUM 0x04
+#define LZ4_FLG_DICT_ID         0x01
+
+#define LZ4_BLOCK_UNCOMPRESSED  0x80000000
+#define LZ4_BLOCK_SIZE_MASK     0x7FFFFFFF
+#define LZ4_CHECKSUM_SIZE       4
+#define LZ4_MIN_MATCH           4
+
+/* Magic, FLG, BD and HC */
+#define LZ4_HEADER_MIN          7
+
+static uint32_t lz4_read32(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | (p[3] << 24);
+}
+
+/* Length of the frame header, 0 if 'src' does not start an LZ4 frame */
+static uint32_t lz4_header_length(const uint8_t *src, uint32_t max)
+{
+    uint32_t n = LZ4_HEADER_MIN;
+    uint8_t flg;
+
+    if (max < LZ4_HEADER_MIN || lz4_read32(src) != LZ4_FRAME_MAGIC)
+        return 0;
+
+    flg = src[4];
+    if ((flg & LZ4_FLG_VERSION_MASK) != LZ4_FLG_VERSION)
+        return 0;
+    if (flg & LZ4_FLG_CONTENT_SIZE)
+        n += 8;
+    if (flg & LZ4_FLG_DICT_ID)
+        n += 4;
+
+    return n <= max ? n : 0;
+}
+
+/**
+ * @brief   Walks the blocks of the frame at 'src'.
+ * @return  Length of the whole frame, 0 if there is no valid frame
+ *          within 'max' bytes.
+ */
+uint32_t lz4_frame_length(const uint8_t *src, uint32_t max)
+{
+    uint32_t n = lz4_header_length(src, max);
+    uint32_t block_extra;
+    uint32_t size;
+
+    if (!n)
+        return 0;
+
+    block_extra = (src[4] & LZ4_FLG_BLOCK_CHECKSUM) ? LZ4_CHECKSUM_SIZE : 0;
+    while (1) {
+        if (max - n < 4)
+            return 0;
+        size = lz4_read32(src + n);
+        n += 4;
+        if (!size)
+            break;
+        size &= LZ4_BLOCK_SIZE_MASK;
+        if (max - n < size + block_extra)
+            return 0;
+        n += size + block_extra;
+    }
+
+    if (src[4] & LZ4_FLG_CONTENT_CHECKSUM) {
+        if (max - n < LZ4_CHECKSUM_SIZE)
+            return 0;
+        n += LZ4_CHECKSUM_SIZE;
+    }
+
+    return n;
+}
+
+/* Reads the 255-run extension of a literal or match length */
+static const uint8_t *lz4_length(const uint8_t *ip, const uint8_t *iend,
+        uint32_t *len)
+{
+    uint8_t b;
+
+    do {
+        if (ip >= iend)
+            return 0;
+        b = *ip++;
+        *len += b;
+    } while (b == 255);
+
+    return ip;
+}
+
+/*
+ * Decodes one compressed block at 'op'. Matches may reach back into the
+ * output of earlier blocks, down to 'dst'.
+ */
+static uint8_t *lz4_block(const uint8_t *ip, const uint8_t *iend,
+        uint8_t *dst, uint8_t *op, uint8_t *oend)
+{
+    const uint8_t *match;
+    uint32_t token, len, offset;
+
+    while (ip < iend) {
+        token = *ip++;
+
+        len = token >> 4;
+        if (len == 15 && !(ip = lz4_length(ip, iend, &len)))
+            return 0;
+        if (len > (uint32_t)(iend - ip) || len > (uint32_t)(oend - op))
+            return 0;
+        memcpy(op, ip, len);
+        ip += len;
+        op += len;
+
+        /* The last sequence has literals only */
+        if (ip == iend)
+            break;
+
+        if (iend - ip < 2)
+            return 0;
+        offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        if (!offset || offset > (uint32_t)(op - dst))
+            return 0;
+
+        len = token & 15;
+        if (len == 15 && !(ip = lz4_length(ip, iend, &len)))
+            return 0;
+        len += LZ4_MIN_MATCH;
+        if (len > (uint32_t)(oend - op))
+            return 0;
+
+        match = op - offset;
+        if (offset >= len) {
+            memcpy(op, match, len);
+            op += len;
+        } else {
+            /* Overlapping, repeats the last 'offset' bytes */
+            while (len--)
+                *op++ = *match++;
+        }
+    }
+
+    return op;
+}
+
+/**
+ * @brief   Decompresses the frame at 'src' into 'dst', which must not
+ *          overlap it.
+ * @return  HVMM_STATUS_SUCCESS with the decompressed length in 'out_len',
+ *          HVMM_STATUS_NOT_FOUND if 'src' is not an LZ4 frame,
+ *          HVMM_STATUS_UNSUPPORTED_FEATURE if it needs a dictionary,
+ *          HVMM_STATUS_BAD_ACCESS if it is corrupt or does not fit.
+ */
+hvmm_status_t lz4_decompress(const uint8_t *src, uint32_t len,
+        uint8_t *dst, uint32_t dst_max, uint32_t *out_len)
+{
+    uint32_t n = lz4_header_length(src, len);
+    uint8_t *op = dst;
+    uint8_t *oend = dst + dst_max;
+    uint32_t block_extra;
+    uint32_t size;
+
+    if (!n)
+        return HVMM_STATUS_NOT_FOUND;
+    if (src[4] & LZ4_FLG_DICT_ID)
+        return HVMM_STATUS_UNSUPPORTED_FEATURE;
+
+    block_extra = (src[4] & LZ4_FLG_BLOCK_CHECKSUM) ? LZ4_CHECKSUM_SIZE : 0;
+    while (1) {
+        if (len - n < 4)
+            return HVMM_STATUS_BAD_ACCESS;
+        size = lz4_read32(src + n);
+        n += 4;
+        if (!size)
+            break;
+        if ((size & LZ4_BLOCK_SIZE_MASK) + block_extra > len - n)
+            return HVMM_STATUS_BAD_ACCESS;
+
+        if (size & LZ4_BLOCK_UNCOMPRESSED) {
+            size &= LZ4_BLOCK_SIZE_MASK;
+            if (size > (uint32_t)(oend - op))
+                return HVMM_STATUS_BAD_ACCESS;
+            memcpy(op, src + n, size);
+            op += size;
+        } else {
+            op = lz4_block(src + n, src + n + size, dst, op, oend);
+            if (!op)
+                return HVMM_STATUS_BAD_ACCESS;
+        }
+        n += size + block_extra;
+    }
+
+    *out_len = op - dst;
+
+    return HVMM_STATUS_SUCCESS;
+}
+
+/**
+ * @brief   Decompresses the frame at 'base' over itself, within the 'size'
+ *          bytes of the region. The frame is first moved to the top of
+ *          the region, so the output never catches up with the input and
+ *          no other buffer is needed.
+ * @return  As lz4_decompress(). The region is left untouched unless the
+ *          error is found while decompressing.
+ */
+hvmm_status_t lz4_unpack_in_place(uint8_t *base, uint32_t size,
+        uint32_t *out_len)
+{
+    uint32_t len;
+    uint8_t *src;
+
+    if (!lz4_header_length(base, size))
+        return HVMM_STATUS_NOT_FOUND;
+    if (base[4] & LZ4_FLG_DICT_ID)
+        return HVMM_STATUS_UNSUPPORTED_FEATURE;
+    len = lz4_frame_length(base, size);
+    if (!len)
+        return HVMM_STATUS_BAD_ACCESS;
+
+    src = base + ((size - len) & ~0x3);
+    memmove(src, base, len);
+
+    return lz4_decompress(src, len, base, src - base, out_len);
+}
@@ -79,3 +79,24 @@ hvmm_status_t memory_init(struct memmap_desc **guest0,
 
     return ret;
 }
+
+uint32_t memory_guest_ipa_to_pa(vcpuid_t vmid, uint32_t ipa, uint32_t size)
+{
+    /* memory_hw_ipa_to_pa */
+    if (_memory_ops->ipa_to_pa)
+        return _memory_ops->ipa_to_pa(vmid, ipa, size);
+
+    return 0;
+}
+
+hvmm_status_t memory_guest_map(vcpuid_t vmid, uint32_t ipa, uint32_t pa,
+        uint32_t size, enum memattr attr)
+{
+    hvmm_status_t ret = HVMM_STATUS_UNKNOWN_ERROR;
+
+    /* memory_hw_map */
+    if (_memory_ops->map)
+        ret = _memory_ops->map(vmid, ipa, pa, size, attr);
+
+    return ret;
+}
@@ -12,6 +12,11 @@
 #include <armv7_p15.h>
 #include <vcpu.h>
 #include <asm-arm_inline.h>
+#include <interrupt_stats.h>
+#include <trace.h>
+#include <exit_stats.h>
+#include <profile.h>
+#include <probe.h>
 
 #define DEMO
 
@@ -509,3 +514,92 @@ hvmm_status_t monitor_check_status(struct monitor_vmid *mvmid, uint32_t va)
     return ret;
 }
 
+
+/*
+ * Writes a dump of up to 'max_words' to the dump area with 'dump' and
+ * notifies the monitoring guest, which decodes it according to 'type'.
+ */
+static hvmm_status_t monitor_send_dump(struct monitor_vmid *mvmid,
+        uint8_t type, uint32_t (*dump)(uint32_t *buf, uint32_t max_words),
+        uint32_t max_words)
+{
+    struct monitoring_data *data;
+    uint32_t words;
+
+    words = dump((uint32_t *)SHARED_DUMP_ADDRESS, max_words);
+
+    data = (struct monitoring_data *)(SHARED_ADDRESS);
+    data->type = type;
+    data->memory_range = words;
+    flush_dcache_all();
+    monitor_notify_guest(mvmid->vmid_monitor);
+
+    return HVMM_STATUS_SUCCESS;
+}
+
+hvmm_status_t monitor_irq_stats(struct monitor_vmid *mvmid, uint32_t va)
+{
+    return monitor_send_dump(mvmid, IRQ_STATS, irq_stats_dump,
+            MONITOR_IRQ_STATS_WORDS);
+}
+
+hvmm_status_t monitor_irq_stats_reset(struct monitor_vmid *mvmid, uint32_t va)
+{
+    irq_stats_reset();
+
+    return HVMM_STATUS_SUCCESS;
+}
+
+hvmm_status_t monitor_irq_coalesce(struct monitor_vmid *mvmid, uint32_t va)
+{
+    struct irq_coalesce_param *param;
+
+    /* Parameters are written to the dump area by the monitoring guest */
+    flush_cache((unsigned long)SHARED_DUMP_ADDRESS,
+            sizeof(struct irq_coalesce_param));
+    param = (struct irq_coalesce_param *)SHARED_DUMP_ADDRESS;
+
+    return interrupt_guest_coalesce(param);
+}
+
+hvmm_status_t monitor_trace(struct monitor_vmid *mvmid, uint32_t va)
+{
+    return monitor_send_dump(mvmid, TRACE, trace_drain, MONITOR_TRACE_WORDS);
+}
+
+hvmm_status_t monitor_exit_stats(struct monitor_vmid *mvmid, uint32_t va)
+{
+    return monitor_send_dump(mvmid, EXIT_STATS, exit_stats_dump,
+            MONITOR_EXIT_STATS_WORDS);
+}
+
+hvmm_status_t monitor_exit_stats_reset(struct monitor_vmid *mvmid, uint32_t va)
+{
+    exit_stats_reset();
+
+    return HVMM_STATUS_SUCCESS;
+}
+
+/* 'va' is the sampling period in usec, 0 stops the profiler */
+hvmm_status_t monitor_profile_set(struct monitor_vmid *mvmid, uint32_t va)
+{
+    return profile_set_period(va);
+}
+
+hvmm_status_t monitor_profile(struct monitor_vmid *mvmid, uint32_t va)
+{
+    return monitor_send_dump(mvmid, PROFILE, profile_drain,
+            MONITOR_PROFILE_WORDS);
+}
+
+hvmm_status_t monitor_probe(struct monitor_vmid *mvmid, uint32_t va)
+{
+    return monitor_send_dump(mvmid, PROBE, probe_dump, MONITOR_PROBE_WORDS);
+}
+
+hvmm_status_t monitor_probe_reset(struct monitor_vmid *mvmid, uint32_t va)
+{
+    probe_reset();
+
+    return HVMM_STATUS_SUCCESS;
+}
@@ -0,0 +1,80 @@
+/*
+ * probe.c
+ * --------------------------------------
+ * Per-cpu cost probes around the hypervisor's own subsystems
+ */
+
+#include <probe.h>
+#include <timer.h>
+#include <smp.h>
+#include <log/string.h>
+
+struct probe_counter {
+    uint32_t count;
+    uint32_t min;
+    uint32_t max;
+    uint64_t total;
+};
+
+/* Written only by the owner cpu, in Hyp mode with irqs masked */
+static struct probe_counter _probe[NUM_CPUS][PROBE_NUM_SITES];
+
+#ifdef CFG_PROBE
+void probe_end(enum probe_site site, uint32_t start)
+{
+    struct probe_counter *probe = &_probe[smp_processor_id()][site];
+    uint32_t ticks = timer_stamp() - start;
+
+    if (!probe->count || ticks < probe->min)
+        probe->min = ticks;
+    if (ticks > probe->max)
+        probe->max = ticks;
+    probe->total += ticks;
+    probe->count++;
+}
+#endif
+
+void probe_reset(void)
+{
+    memset(_probe, 0, sizeof(_probe));
+}
+
+/**
+ * @brief   Serializes a snapshot of the probes into 'buf', see probe.h
+ *          for the layout. A probe being updated by its cpu may be off by
+ *          its last hit.
+ * @return  Number of words written.
+ */
+uint32_t probe_dump(uint32_t *buf, uint32_t max_words)
+{
+    struct probe_counter *probe;
+    uint32_t n = PROBE_HEADER_WORDS;
+    uint32_t records = 0;
+    int cpu, site;
+
+    if (max_words < PROBE_HEADER_WORDS)
+        return 0;
+
+    for (cpu = 0; cpu < NUM_CPUS; cpu++) {
+        for (site = 0; site < PROBE_NUM_SITES; site++) {
+            probe = &_probe[cpu][site];
+            if (!probe->count)
+                continue;
+            if (n + PROBE_RECORD_WORDS > max_words)
+                break;
+            buf[n] = (cpu << 16) | site;
+            buf[n + 1] = probe->count;
+            buf[n + 2] = probe->min;
+            /* The average of 32-bit samples fits in 32 bits */
+            buf[n + 3] = (uint32_t)timer_div64(probe->total, probe->count);
+            buf[n + 4] = probe->max;
+            n += PROBE_RECORD_WORDS;
+            records++;
+        }
+    }
+
+    buf[0] = COUNT_PER_USEC;
+    buf[1] = records;
+
+    return n;
+}
@@ -0,0 +1,147 @@
+/*
+ * profile.c
+ * --------------------------------------
+ * Sampling profiler of the guests
+ */
+
+#include <profile.h>
+#include <timer.h>
+#include <vcpu.h>
+#include <smp.h>
+#include <gic.h>
+#include <asm-arm_inline.h>
+
+struct profile_sample {
+    uint32_t pc;
+    uint32_t info;
+};
+
+/* 'head' is written by the sampling cpu, 'tail' by the drain only */
+struct profile_buffer {
+    struct profile_sample sample[PROFILE_SAMPLES];
+    volatile uint32_t head;
+    volatile uint32_t tail;
+    volatile uint32_t dropped;
+};
+
+static struct profile_buffer _profile_buf[NUM_CPUS];
+static struct timer_event _profile_event[NUM_CPUS];
+/* Period requested by the monitor and the one armed on each cpu */
+static volatile uint32_t _profile_period_us;
+static uint32_t _profile_armed_us[NUM_CPUS];
+static DEFINE_SPINLOCK(_profile_drain_lock);
+
+static void profile_sample(void *pregs, void *data)
+{
+    struct arch_regs *regs = pregs;
+    uint32_t cpu = smp_processor_id();
+    struct profile_buffer *buf = &_profile_buf[cpu];
+    uint32_t head = buf->head;
+    struct profile_sample *sample;
+    vcpuid_t vmid = guest_current_vmid();
+
+    if (!regs || vmid >= NUM_GUESTS_STATIC)
+        return;
+
+    if (head - buf->tail == PROFILE_SAMPLES) {
+        buf->dropped++;
+        return;
+    }
+
+    sample = &buf->sample[head & (PROFILE_SAMPLES - 1)];
+    sample->pc = regs->pc;
+    sample->info = (cpu << 16) | (vmid << 8) | (regs->cpsr & 0x1F);
+
+    /* Publish the sample before the index */
+    dmb();
+    buf->head = head + 1;
+}
+
+/**
+ * @brief   Starts sampling every 'period_us' on all cpus, or stops it if
+ *          'period_us' is 0. The other cpus follow on GIC_SGI_PROFILE.
+ */
+hvmm_status_t profile_set_period(uint32_t period_us)
+{
+    if (period_us && period_us < PROFILE_MIN_PERIOD_US)
+        return HVMM_STATUS_BAD_ACCESS;
+
+    _profile_period_us = period_us;
+    profile_sync();
+#ifdef _SMP_
+    /* Publish the period before the others read it */
+    dmb();
+    gic_set_sgi(((1 << NUM_CPUS) - 1) & ~gic_cpumask_current(),
+            GIC_SGI_PROFILE);
+#endif
+
+    return HVMM_STATUS_SUCCESS;
+}
+
+/**
+ * @brief   Brings the sampling event of the current cpu in line with the
+ *          requested period.
+ */
+void profile_sync(void)
+{
+    uint32_t cpu = smp_processor_id();
+    uint32_t period_us = _profile_period_us;
+
+    if (_profile_armed_us[cpu] == period_us)
+        return;
+
+    timer_event_cancel(&_profile_event[cpu]);
+    _profile_armed_us[cpu] = 0;
+    if (!period_us)
+        return;
+
+    timer_event_init(&_profile_event[cpu], profile_sample, 0);
+    if (timer_event_add(&_profile_event[cpu], period_us, period_us) ==
+            HVMM_STATUS_SUCCESS)
+        _profile_armed_us[cpu] = period_us;
+}
+
+/**
+ * @brief   Moves the samples of all cpus into 'buf', see profile.h for the
+ *          layout. Samples that do not fit are left for the next drain.
+ * @return  Number of words written.
+ */
+uint32_t profile_drain(uint32_t *buf, uint32_t max_words)
+{
+    struct profile_buffer *pbuf;
+    struct profile_sample *sample;
+    uint32_t n = PROFILE_DUMP_HEADER_WORDS;
+    uint32_t samples = 0;
+    uint32_t dropped = 0;
+    uint32_t head, tail;
+    int i;
+
+    if (max_words < PROFILE_DUMP_HEADER_WORDS)
+        return 0;
+
+    spin_lock(&_profile_drain_lock);
+    for (i = 0; i < NUM_CPUS; i++) {
+        pbuf = &_profile_buf[i];
+        head = pbuf->head;
+        /* Read the samples after the index */
+        dmb();
+        for (tail = pbuf->tail; tail != head &&
+                n + PROFILE_SAMPLE_WORDS <= max_words; tail++) {
+            sample = &pbuf->sample[tail & (PROFILE_SAMPLES - 1)];
+            buf[n++] = sample->pc;
+            buf[n++] = sample->info;
+            samples++;
+        }
+        /* Release the slots after they are read */
+        dmb();
+        pbuf->tail = tail;
+        dropped += pbuf->dropped;
+        pbuf->dropped = 0;
+    }
+    spin_unlock(&_profile_drain_lock);
+
+    buf[0] = samples;
+    buf[1] = dropped;
+
+    return n;
+}
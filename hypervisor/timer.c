@@ -16,15 +16,18 @@
 static timer_callback_t _host_callback[2];
 static timer_callback_t _guest_callback[2];
 
+struct timer_heap {
+    struct timer_event *ev[TIMER_MAX_EVENTS];
+    uint32_t num;
+};
+
+/* Accessed only by the owning cpu, with interrupts masked in hyp mode */
+static struct timer_heap _timer_heap[NUM_CPUS];
+/* Runs the host and guest callbacks, every interval of the host timer */
+static struct timer_event _timer_tick[NUM_CPUS];
+
 static struct timer_ops *_ops;
 
-/*
- * Converts from microseconds to system counter.
- */
-static inline uint64_t timer_t2c(uint64_t time_us)
-{
-    return time_us * COUNT_PER_USEC;
-}
 
 /*
  * Starts the timer.
@@ -50,32 +53,211 @@ static hvmm_status_t timer_stop(void)
     return HVMM_STATUS_UNSUPPORTED_FEATURE;
 }
 
+static inline void timer_heap_set(struct timer_heap *heap, uint32_t i,
+        struct timer_event *ev)
+{
+    heap->ev[i] = ev;
+    ev->slot = i + 1;
+}
+
+static void timer_heap_up(struct timer_heap *heap, uint32_t i)
+{
+    struct timer_event *ev = heap->ev[i];
+    uint32_t parent;
+
+    while (i > 0) {
+        parent = (i - 1) >> 1;
+        if (heap->ev[parent]->expires <= ev->expires)
+            break;
+        timer_heap_set(heap, i, heap->ev[parent]);
+        i = parent;
+    }
+    timer_heap_set(heap, i, ev);
+}
+
+static void timer_heap_down(struct timer_heap *heap, uint32_t i)
+{
+    struct timer_event *ev = heap->ev[i];
+    uint32_t child;
+
+    while ((child = 2 * i + 1) < heap->num) {
+        if (child + 1 < heap->num &&
+                heap->ev[child + 1]->expires < heap->ev[child]->expires)
+            child++;
+        if (ev->expires <= heap->ev[child]->expires)
+            break;
+        timer_heap_set(heap, i, heap->ev[child]);
+        i = child;
+    }
+    timer_heap_set(heap, i, ev);
+}
+
+static void timer_heap_remove(struct timer_heap *heap, struct timer_event *ev)
+{
+    uint32_t i = ev->slot - 1;
+    struct timer_event *last = heap->ev[--heap->num];
+
+    ev->slot = 0;
+    if (last == ev)
+        return;
+
+    timer_heap_set(heap, i, last);
+    if (i > 0 && heap->ev[(i - 1) >> 1]->expires > last->expires)
+        timer_heap_up(heap, i);
+    else
+        timer_heap_down(heap, i);
+}
+
 /*
- * Sets the timer interval(microsecond).
+ * Programs the timer to the earliest expiry of this cpu.
  */
-static hvmm_status_t timer_set_interval(uint32_t interval_us)
+static void timer_program(struct timer_heap *heap)
 {
+    uint64_t now, delta;
+
+    timer_stop();
+    if (!heap->num)
+        return;
+
+    /* timer_set_cval(), a deadline in the past fires at once */
+    if (_ops->set_cval) {
+        _ops->set_cval(heap->ev[0]->expires);
+        timer_start();
+        return;
+    }
+
+    now = read_cntpct();
+    delta = 0;
+    if (heap->ev[0]->expires > now)
+        delta = heap->ev[0]->expires - now;
+    /* TVAL is a signed 32-bit down counter */
+    if (delta > 0x7FFFFFFF)
+        delta = 0x7FFFFFFF;
+
     /* timer_set_tval() */
     if (_ops->set_interval)
-        return _ops->set_interval(timer_t2c(interval_us));
+        _ops->set_interval(delta);
+    timer_start();
+}
 
-    return HVMM_STATUS_UNSUPPORTED_FEATURE;
+static hvmm_status_t timer_event_arm(struct timer_event *ev,
+        uint64_t expires, uint32_t period_us)
+{
+    uint32_t cpu = smp_processor_id();
+    struct timer_heap *heap = &_timer_heap[cpu];
+
+    if (ev->slot) {
+        if (ev->cpu != cpu)
+            return HVMM_STATUS_BAD_ACCESS;
+        timer_heap_remove(heap, ev);
+    }
+    if (heap->num == TIMER_MAX_EVENTS)
+        return HVMM_STATUS_BUSY;
+
+    ev->expires = expires;
+    ev->period = timer_us_to_count(period_us);
+    ev->cpu = cpu;
+    heap->ev[heap->num] = ev;
+    timer_heap_up(heap, heap->num++);
+
+    if (heap->ev[0] == ev)
+        timer_program(heap);
+
+    return HVMM_STATUS_SUCCESS;
+}
+
+void timer_event_init(struct timer_event *ev, timer_event_callback_t callback,
+        void *data)
+{
+    ev->expires = 0;
+    ev->period = 0;
+    ev->callback = callback;
+    ev->data = data;
+    ev->slot = 0;
+    ev->cpu = 0;
+}
+
+hvmm_status_t timer_event_add(struct timer_event *ev, uint32_t delay_us,
+        uint32_t period_us)
+{
+    if (ev->slot)
+        return HVMM_STATUS_BUSY;
+
+    return timer_event_arm(ev, read_cntpct() + timer_us_to_count(delay_us),
+            period_us);
+}
+
+hvmm_status_t timer_event_add_abs(struct timer_event *ev, uint64_t expires,
+        uint32_t period_us)
+{
+    if (ev->slot)
+        return HVMM_STATUS_BUSY;
+
+    return timer_event_arm(ev, expires, period_us);
+}
+
+hvmm_status_t timer_event_modify(struct timer_event *ev, uint32_t delay_us,
+        uint32_t period_us)
+{
+    return timer_event_arm(ev, read_cntpct() + timer_us_to_count(delay_us),
+            period_us);
+}
+
+hvmm_status_t timer_event_cancel(struct timer_event *ev)
+{
+    uint32_t cpu = smp_processor_id();
+    struct timer_heap *heap = &_timer_heap[cpu];
+    uint32_t first;
+
+    if (!ev->slot)
+        return HVMM_STATUS_SUCCESS;
+    if (ev->cpu != cpu)
+        return HVMM_STATUS_BAD_ACCESS;
+
+    first = (heap->ev[0] == ev);
+    timer_heap_remove(heap, ev);
+    if (first)
+        timer_program(heap);
+
+    return HVMM_STATUS_SUCCESS;
 }
 
 /*
  * This method handles all timer IRQ.
+ * Runs the expired events in order of expiry, then programs the next one.
  */
 static void timer_handler(int irq, void *pregs, void *pdata)
 {
     uint32_t cpu = smp_processor_id();
+    struct timer_heap *heap = &_timer_heap[cpu];
+    struct timer_event *ev;
+    uint64_t now = read_cntpct();
 
     timer_stop();
+    while (heap->num && heap->ev[0]->expires <= now) {
+        ev = heap->ev[0];
+        timer_heap_remove(heap, ev);
+        if (ev->period) {
+            /* Keep the phase, unless whole periods were missed */
+            ev->expires += ev->period;
+            if (ev->expires <= now)
+                ev->expires = now + ev->period;
+            heap->ev[heap->num] = ev;
+            timer_heap_up(heap, heap->num++);
+        }
+        ev->callback(pregs, ev->data);
+    }
+    timer_program(heap);
+}
+
+static void timer_tick(void *pregs, void *data)
+{
+    uint32_t cpu = smp_processor_id();
+
     if (_host_callback[cpu])
         _host_callback[cpu](pregs);
     if (_guest_callback[cpu])
         _guest_callback[cpu](pregs);
-    timer_set_interval(GUEST_SCHED_TICK);
-    timer_start();
 }
 
 static hvmm_status_t timer_requset_irq(uint32_t irq)
@@ -106,17 +288,38 @@ static hvmm_status_t timer_guest_set_callback(timer_callback_t func)
 
 hvmm_status_t timer_set(struct timer_val *timer, uint32_t host)
 {
+    uint32_t cpu = smp_processor_id();
+
     if (host) {
-        timer_stop();
+        if (!timer->interval_us)
+            return HVMM_STATUS_BAD_ACCESS;
         timer_host_set_callback(timer->callback);
-        timer_set_interval(timer->interval_us);
-        timer_start();
+        timer_event_cancel(&_timer_tick[cpu]);
+        timer_event_init(&_timer_tick[cpu], timer_tick, 0);
+        return timer_event_modify(&_timer_tick[cpu], timer->interval_us,
+                timer->interval_us);
     } else
         timer_guest_set_callback(timer->callback);
 
     return HVMM_STATUS_SUCCESS;
 }
 
+hvmm_status_t timer_vtimer_save(struct vtimer_context *vtimer)
+{
+    if (_ops->vtimer_save)
+        return _ops->vtimer_save(vtimer);
+
+    return HVMM_STATUS_UNSUPPORTED_FEATURE;
+}
+
+hvmm_status_t timer_vtimer_restore(struct vtimer_context *vtimer)
+{
+    if (_ops->vtimer_restore)
+        return _ops->vtimer_restore(vtimer);
+
+    return HVMM_STATUS_UNSUPPORTED_FEATURE;
+}
+
 hvmm_status_t timer_init(uint32_t irq)
 {
     uint32_t cpu = smp_processor_id();
@@ -145,7 +348,55 @@ uint64_t get_timer_curcnt(void)
 {
     return read_cntpct();
 }
-uint32_t get_timer_interval_us(uint64_t after, uint64_t before)
+
+uint32_t timer_stamp(void)
+{
+    return (uint32_t)read_cntpct();
+}
+
+/*
+ * 64-bit by 32-bit division with 32-bit operations only, there is no
+ * libgcc. A divisor below 2^16, as the counts per microsecond of the
+ * supported boards, takes the dividend 16 bits at a time; larger ones
+ * fall back to one bit at a time.
+ */
+uint64_t timer_div64(uint64_t n, uint32_t d)
+{
+    uint64_t q = 0;
+    uint64_t r64 = 0;
+    uint32_t r = 0;
+    uint32_t cur;
+    int shift;
+
+    if (d < 0x10000) {
+        for (shift = 48; shift >= 0; shift -= 16) {
+            cur = (r << 16) | (uint32_t)((n >> shift) & 0xFFFF);
+            q = (q << 16) | (cur / d);
+            r = cur % d;
+        }
+        return q;
+    }
+
+    for (shift = 63; shift >= 0; shift--) {
+        r64 = (r64 << 1) | ((n >> shift) & 1);
+        if (r64 >= d) {
+            r64 -= d;
+            q |= 1ULL << shift;
+        }
+    }
+
+    return q;
+}
+
+uint64_t timer_count_to_us(uint64_t count)
+{
+    return timer_div64(count, COUNT_PER_USEC);
+}
+
+uint64_t timer_us_to_count(uint64_t time_us)
 {
-    return (uint32_t)(after - before) / COUNT_PER_USEC;
+    if (time_us > ~0ULL / COUNT_PER_USEC)
+        return ~0ULL;
+
+    return time_us * COUNT_PER_USEC;
 }
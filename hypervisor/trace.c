@@ -0,0 +1,127 @@
+/*
+ * trace.c
+ * --------------------------------------
+ * Per-cpu binary trace of hypervisor events
+ */
+
+#include <trace.h>
+#include <timer.h>
+#include <smp.h>
+#include <asm-arm_inline.h>
+#include <log/string.h>
+
+/*
+ * 'head' is written only by the owner cpu, which runs in Hyp mode with
+ * irqs masked, so records of one cpu never interleave. 'tail' is written
+ * only by the drain.
+ */
+struct trace_ring {
+    struct trace_record rec[TRACE_RING_RECORDS];
+    volatile uint32_t head;
+    uint32_t tail;
+};
+
+static struct trace_ring _trace_ring[NUM_CPUS];
+/* Serializes drains only, recording never waits */
+static DEFINE_SPINLOCK(_trace_drain_lock);
+
+/**
+ * @brief   Appends an event to the ring of the current cpu.
+ *
+ * Use trace_event(), which drops the events disabled at compile time.
+ */
+void trace_record(uint32_t event, uint32_t a0, uint32_t a1, uint32_t a2)
+{
+    uint32_t cpu = smp_processor_id();
+    struct trace_ring *ring = &_trace_ring[cpu];
+    uint32_t head = ring->head;
+    struct trace_record *rec = &ring->rec[head & (TRACE_RING_RECORDS - 1)];
+
+    rec->stamp = get_timer_curcnt();
+    rec->event = event;
+    rec->cpu = cpu;
+    rec->arg[0] = a0;
+    rec->arg[1] = a1;
+    rec->arg[2] = a2;
+
+    /* Publish the record before the index */
+    dmb();
+    ring->head = head + 1;
+}
+
+/*
+ * Copies the records of 'ring' recorded since the last drain to 'buf'.
+ * The owner cpu keeps recording meanwhile, records it may have overwritten
+ * during the copy are dropped and counted in 'lost'.
+ * @return Number of records copied.
+ */
+static uint32_t trace_drain_ring(struct trace_ring *ring, uint32_t *buf,
+        uint32_t max_records, uint32_t *lost)
+{
+    uint32_t head = ring->head;
+    uint32_t tail = ring->tail;
+    uint32_t count = 0;
+    uint32_t stale = 0;
+
+    /* Read the records after the index */
+    dmb();
+    if (head - tail > TRACE_RING_RECORDS) {
+        *lost += head - tail - TRACE_RING_RECORDS;
+        tail = head - TRACE_RING_RECORDS;
+    }
+
+    while (tail + count != head && count < max_records) {
+        memcpy(&buf[count * TRACE_RECORD_WORDS],
+                &ring->rec[(tail + count) & (TRACE_RING_RECORDS - 1)],
+                sizeof(struct trace_record));
+        count++;
+    }
+
+    /* Record 'head' may be under way, it reuses the slot of head - N */
+    dmb();
+    head = ring->head;
+    if (head - tail >= TRACE_RING_RECORDS) {
+        stale = head - tail - TRACE_RING_RECORDS + 1;
+        if (stale > count)
+            stale = count;
+        memmove(buf, &buf[stale * TRACE_RECORD_WORDS],
+                (count - stale) * sizeof(struct trace_record));
+        *lost += stale;
+    }
+
+    ring->tail = tail + count;
+
+    return count - stale;
+}
+
+/**
+ * @brief   Moves the records of all cpus into 'buf', see trace.h for the
+ *          layout. Records that do not fit are left for the next drain.
+ * @return  Number of words written.
+ */
+uint32_t trace_drain(uint32_t *buf, uint32_t max_words)
+{
+    uint32_t n = TRACE_DUMP_HEADER_WORDS;
+    uint32_t records = 0;
+    uint32_t lost = 0;
+    uint32_t count;
+    int i;
+
+    if (max_words < TRACE_DUMP_HEADER_WORDS)
+        return 0;
+
+    spin_lock(&_trace_drain_lock);
+    for (i = 0; i < NUM_CPUS; i++) {
+        count = trace_drain_ring(&_trace_ring[i], &buf[n],
+                (max_words - n) / TRACE_RECORD_WORDS, &lost);
+        n += count * TRACE_RECORD_WORDS;
+        records += count;
+    }
+    spin_unlock(&_trace_drain_lock);
+
+    buf[0] = COUNT_PER_USEC;
+    buf[1] = records;
+    buf[2] = lost;
+
+    return n;
+}
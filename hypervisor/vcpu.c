@@ -7,6 +7,11 @@
 #include <log/print.h>
 #include <hvmm_trace.h>
 #include <smp.h>
+#include <trace.h>
+#include <exit_stats.h>
+#include <probe.h>
+#include <lz4.h>
+#include <monitor.h>
 
 #define NUM_GUEST_CONTEXTS        NUM_GUESTS_CPU0_STATIC
 
@@ -49,11 +54,16 @@ static hvmm_status_t perform_switch(struct arch_regs *regs, vcpuid_t next_vmid)
 
     hvmm_status_t result = HVMM_STATUS_UNKNOWN_ERROR;
     uint32_t cpu = smp_processor_id();
+    vcpuid_t vmid = _current_guest_vmid[cpu];
+    uint32_t stamp;
 
-    if (_current_guest_vmid[cpu] == next_vmid)
+    if (vmid == next_vmid)
         return HVMM_STATUS_IGNORED; /* the same guest? */
 
-    save_and_restore(_current_guest_vmid[cpu], next_vmid, regs);
+    stamp = timer_stamp();
+    trace_event(TRACE_EV_GUEST_SWITCH, vmid, next_vmid, 0);
+    save_and_restore(vmid, next_vmid, regs);
+    exit_stats_switch(vmid, stamp);
 
     return result;
 }
@@ -150,6 +160,21 @@ vcpuid_t guest_last_vmid(void)
     return NUM_GUESTS_STATIC - 1;
 }
 
+uint32_t guest_vmid_to_cpu(vcpuid_t vmid)
+{
+    /* FIXME:Hardcoded for now */
+#ifdef _SMP_
+    if (vmid >= num_of_guest(0))
+        return 1;
+#endif
+    return 0;
+}
+
+uint8_t guest_is_running(vcpuid_t vmid)
+{
+    return _current_guest_vmid[guest_vmid_to_cpu(vmid)] == vmid;
+}
+
 vcpuid_t guest_next_vmid(vcpuid_t ofvmid)
 {
     vcpuid_t next = VMID_INVALID;
@@ -333,6 +358,34 @@ hvmm_status_t guest_init()
     return result;
 }
 
+/**
+ * @brief   Decompresses the image of guest 'vmid' if it was stored as an
+ *          LZ4 frame at 'base', in place in the guest's memory. The top of
+ *          the GUEST_SIZE_MAX bytes at 'base' is used as scratch. Raw
+ *          images are left as they are. Must run before the guest starts.
+ */
+hvmm_status_t guest_image_unpack(vcpuid_t vmid, uint32_t base)
+{
+    hvmm_status_t result;
+    uint32_t size;
+
+    result = lz4_unpack_in_place((uint8_t *)base, GUEST_SIZE_MAX, &size);
+    if (result == HVMM_STATUS_NOT_FOUND)
+        return HVMM_STATUS_SUCCESS;
+    if (result != HVMM_STATUS_SUCCESS) {
+        printH("[hyp] guest%d: compressed image not unpacked, code=%x\n",
+                vmid, result);
+        return result;
+    }
+
+    /* The guest starts with its caches off */
+    flush_cache(base, size);
+    invalidate_icache_all();
+    printh("[hyp] guest%d: image decompressed, %d bytes\n", vmid, size);
+
+    return HVMM_STATUS_SUCCESS;
+}
+
 struct vcpu get_guest(uint32_t guest_num)
 {
    return vcpu_arr[guest_num];
@@ -357,11 +410,20 @@ void save_and_restore(vcpuid_t from, vcpuid_t to, struct arch_regs *regs){
 
     struct vcpu *vcpu = 0;
     uint32_t cpu = smp_processor_id();
+    uint32_t start;
 
+    start = probe_start();
     guest_save(&vcpu_arr[from], regs);
+    probe_end(PROBE_GUEST_SAVE, start);
+    start = probe_start();
     memory_save();
+    probe_end(PROBE_MEMORY_SAVE, start);
+    start = probe_start();
     interrupt_save(from);
+    probe_end(PROBE_INTERRUPT_SAVE, start);
+    start = probe_start();
     vdev_save(from);
+    probe_end(PROBE_VDEV_SAVE, start);
 
     /* The context of the next guest */
     vcpu = &vcpu_arr[to];
@@ -372,10 +434,18 @@ void save_and_restore(vcpuid_t from, vcpuid_t to, struct arch_regs *regs){
     if (_guest_module.ops->dump)
         _guest_module.ops->dump(GUEST_VERBOSE_LEVEL_3, &vcpu->regs);
 
+    start = probe_start();
     vdev_restore(to);
+    probe_end(PROBE_VDEV_RESTORE, start);
+    start = probe_start();
     interrupt_restore(to);
+    probe_end(PROBE_INTERRUPT_RESTORE, start);
+    start = probe_start();
     memory_restore(to);
+    probe_end(PROBE_MEMORY_RESTORE, start);
+    start = probe_start();
     guest_restore(vcpu, regs);
+    probe_end(PROBE_GUEST_RESTORE, start);
 }
 void vcpu_init(){
     int i = 0;
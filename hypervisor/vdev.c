@@ -3,12 +3,149 @@
 #define DEBUG
 #include <log/print.h>
 #include <smp.h>
+#include <exit_stats.h>
+#include <timer.h>
 
 #define MAX_VDEV    256
 
 static struct vdev_module *_vdev_module[VDEV_LEVEL_MAX][MAX_VDEV];
 static int _vdev_size[VDEV_LEVEL_MAX];
 
+#define MAX_VDEV_MAPS       32
+#define MAX_VDEV_GUEST_MAPS 8
+
+/* MMIO range of a VDEV_LEVEL_LOW module, tables are sorted by base */
+struct vdev_map_entry {
+    uint32_t base;
+    uint32_t end;
+    int32_t num;
+};
+
+static struct vdev_map_entry _vdev_maps[MAX_VDEV_MAPS];
+static int _vdev_maps_size;
+static struct vdev_map_entry
+    _vdev_guest_maps[NUM_GUESTS_STATIC][MAX_VDEV_GUEST_MAPS];
+static int _vdev_guest_maps_size[NUM_GUESTS_STATIC];
+
+static hvmm_status_t vdev_map_insert(struct vdev_map_entry *table,
+        int *size, int max, struct vdev_memory_map *map, int32_t num)
+{
+    uint32_t base = map->base;
+    uint32_t end = map->base + map->size;
+    int i;
+
+    if (*size >= max || !map->size)
+        return HVMM_STATUS_BUSY;
+
+    for (i = *size; i > 0 && table[i - 1].base > base; i--)
+        table[i] = table[i - 1];
+
+    if ((i > 0 && table[i - 1].end > base) ||
+            (i < *size && table[i + 1].base < end)) {
+        /* Overlapping range, undo */
+        for (; i < *size; i++)
+            table[i] = table[i + 1];
+        return HVMM_STATUS_BAD_ACCESS;
+    }
+
+    table[i].base = base;
+    table[i].end = end;
+    table[i].num = num;
+    (*size)++;
+
+    return HVMM_STATUS_SUCCESS;
+}
+
+#define MAX_VDEV_COALESCED          8
+#define VDEV_COALESCED_RING_SIZE    64
+/* Latest replay of a buffered write while the guest keeps running */
+#define VDEV_COALESCED_DELAY_US     1000
+
+/* Ranges whose writes are buffered, sorted by base */
+static struct vdev_map_entry _vdev_coalesced[MAX_VDEV_COALESCED];
+static int _vdev_coalesced_size;
+
+struct vdev_coalesced_write {
+    uint32_t fipa;
+    uint32_t value;
+    enum vdev_access_size sas;
+    int32_t num;
+};
+
+/* Accessed only by the cpu the guest runs on */
+struct vdev_coalesced_ring {
+    struct vdev_coalesced_write entry[VDEV_COALESCED_RING_SIZE];
+    uint32_t head;
+    uint32_t tail;
+    struct timer_event flush;   /**< Armed while the ring is not empty */
+};
+
+static struct vdev_coalesced_ring _vdev_coalesced_ring[NUM_GUESTS_STATIC];
+
+#define VDEV_HVC_HASH_SIZE  64
+#define VDEV_HVC_HASH_MASK  (VDEV_HVC_HASH_SIZE - 1)
+
+/* HVC bindings of VDEV_LEVEL_MIDDLE modules, open addressing */
+struct vdev_hvc_entry {
+    uint32_t imm;
+    uint32_t fid;
+    int32_t num;
+};
+
+static struct vdev_hvc_entry _vdev_hvcs[VDEV_HVC_HASH_SIZE];
+static int _vdev_hvcs_size;
+
+static inline uint32_t vdev_hvc_hash(uint32_t imm, uint32_t fid)
+{
+    return (imm ^ fid ^ (fid >> 16) ^ (fid >> 24)) & VDEV_HVC_HASH_MASK;
+}
+
+static int32_t vdev_hvc_lookup(uint32_t imm, uint32_t fid)
+{
+    uint32_t h = vdev_hvc_hash(imm, fid);
+    int i;
+
+    for (i = 0; i < VDEV_HVC_HASH_SIZE; i++) {
+        struct vdev_hvc_entry *entry = &_vdev_hvcs[h];
+
+        if (entry->num == VDEV_NOT_FOUND)
+            break;
+        if (entry->imm == imm && entry->fid == fid)
+            return entry->num;
+        h = (h + 1) & VDEV_HVC_HASH_MASK;
+    }
+
+    return VDEV_NOT_FOUND;
+}
+
+static struct vdev_map_entry *vdev_map_search(struct vdev_map_entry *table,
+        int size, uint32_t addr)
+{
+    int lo = 0;
+    int hi = size - 1;
+    int mid;
+
+    while (lo <= hi) {
+        mid = (lo + hi) / 2;
+        if (addr < table[mid].base)
+            hi = mid - 1;
+        else if (addr >= table[mid].end)
+            lo = mid + 1;
+        else
+            return &table[mid];
+    }
+
+    return 0;
+}
+
+static int32_t vdev_map_lookup(struct vdev_map_entry *table, int size,
+        uint32_t addr)
+{
+    struct vdev_map_entry *entry = vdev_map_search(table, size, addr);
+
+    return entry ? entry->num : VDEV_NOT_FOUND;
+}
+
 /**
  * \brief Register the virtual deivce \a module. Level \a level is
  * composed of three types(high, middle and low priority). This function
@@ -38,6 +175,27 @@ hvmm_status_t vdev_register(int level, struct vdev_module *module)
     return result;
 }
 
+int32_t vdev_find_mapped(uint32_t fipa, struct vdev_memory_map *range)
+{
+    vcpuid_t vmid = guest_current_vmid();
+    struct vdev_map_entry *entry = 0;
+
+    if (vmid < NUM_GUESTS_STATIC && _vdev_guest_maps_size[vmid])
+        entry = vdev_map_search(_vdev_guest_maps[vmid],
+                _vdev_guest_maps_size[vmid], fipa);
+    if (!entry)
+        entry = vdev_map_search(_vdev_maps, _vdev_maps_size, fipa);
+    if (!entry)
+        return VDEV_NOT_FOUND;
+
+    if (range) {
+        range->base = entry->base;
+        range->size = entry->end - entry->base;
+    }
+
+    return entry->num;
+}
+
 /**
  * \brief Lookup the virtual deivce address, using the archtecture specific
  * information \a info and current archtecture specific register \a regs.
@@ -52,6 +210,20 @@ int32_t vdev_find(int level, struct arch_vdev_trigger_info *info,
     int32_t vdev_num = VDEV_NOT_FOUND;
     struct vdev_module *vdev;
 
+    if (level == VDEV_LEVEL_LOW) {
+        vdev_num = vdev_find_mapped(info->fipa, 0);
+        if (vdev_num != VDEV_NOT_FOUND)
+            return vdev_num;
+    } else if (level == VDEV_LEVEL_MIDDLE && _vdev_hvcs_size) {
+        uint32_t imm = info->iss & 0xFFFF;
+
+        vdev_num = vdev_hvc_lookup(imm,
+                imm == VDEV_HVC_IMM_SMCCC ? regs->gpr[0] : 0);
+        if (vdev_num != VDEV_NOT_FOUND)
+            return vdev_num;
+    }
+
+    /* Modules that are not looked up by their MMIO range or HVC */
     for (i = 0; i < _vdev_size[level]; i++) {
         vdev = _vdev_module[level][i];
         if (!vdev) {
@@ -64,7 +236,7 @@ int32_t vdev_find(int level, struct arch_vdev_trigger_info *info,
                     level, i);
             break;
         }
-        if (!vdev->ops->check)
+        if (!vdev->ops->check || vdev->map)
             continue;
         if (!vdev->ops->check(info, regs)) {
             vdev_num = i;
@@ -75,11 +247,82 @@ int32_t vdev_find(int level, struct arch_vdev_trigger_info *info,
     return vdev_num;
 }
 
+void vdev_coalesced_flush(vcpuid_t vmid)
+{
+    struct vdev_coalesced_ring *ring;
+    struct vdev_coalesced_write *entry;
+    struct arch_vdev_trigger_info info;
+    struct vdev_module *vdev;
+
+    if (vmid >= NUM_GUESTS_STATIC)
+        return;
+
+    ring = &_vdev_coalesced_ring[vmid];
+    timer_event_cancel(&ring->flush);
+    while (ring->tail != ring->head) {
+        entry = &ring->entry[ring->tail % VDEV_COALESCED_RING_SIZE];
+        vdev = _vdev_module[VDEV_LEVEL_LOW][entry->num];
+        info.ec = 0;
+        info.iss = 0;
+        info.il = 0;
+        info.fipa = entry->fipa;
+        info.sas = entry->sas;
+        info.value = &entry->value;
+        if (vdev->ops->write(&info, 0) < 0)
+            printh("vdev : '%s' coalesced write to %x failed\n",
+                    vdev->name, entry->fipa);
+        ring->tail++;
+    }
+}
+
+/*
+ * A switched out guest has been flushed by vdev_save(), only replay the
+ * writes of the guest that is still running here.
+ */
+static void vdev_coalesced_expired(void *pregs, void *data)
+{
+    vcpuid_t vmid = (struct vdev_coalesced_ring *)data - _vdev_coalesced_ring;
+
+    if (vmid == guest_current_vmid())
+        vdev_coalesced_flush(vmid);
+}
+
+/*
+ * Buffers a write to a coalesced range.
+ * Returns VDEV_NOT_FOUND if the address is not coalesced.
+ */
+static int32_t vdev_coalesced_write(int num,
+        struct arch_vdev_trigger_info *info)
+{
+    vcpuid_t vmid = guest_current_vmid();
+    struct vdev_coalesced_ring *ring;
+    struct vdev_coalesced_write *entry;
+
+    if (vdev_map_lookup(_vdev_coalesced, _vdev_coalesced_size,
+                info->fipa) != num || vmid >= NUM_GUESTS_STATIC)
+        return VDEV_NOT_FOUND;
+
+    ring = &_vdev_coalesced_ring[vmid];
+    if (ring->head - ring->tail == VDEV_COALESCED_RING_SIZE)
+        vdev_coalesced_flush(vmid);
+
+    entry = &ring->entry[ring->head % VDEV_COALESCED_RING_SIZE];
+    entry->fipa = info->fipa;
+    entry->value = *info->value;
+    entry->sas = info->sas;
+    entry->num = num;
+    if (ring->head++ == ring->tail)
+        timer_event_add(&ring->flush, VDEV_COALESCED_DELAY_US, 0);
+
+    return 0;
+}
+
 int32_t vdev_read(int level, int num, struct arch_vdev_trigger_info *info,
             struct arch_regs *regs)
 {
     int32_t size = 0;
     struct vdev_module *vdev = _vdev_module[level][num];
+    uint32_t stamp;
 
     if (!vdev) {
         printh("vdev : Could not get module, level : %d, i : %d\n",
@@ -93,8 +336,15 @@ int32_t vdev_read(int level, int num, struct arch_vdev_trigger_info *info,
         return VDEV_ERROR;
     }
 
-    if (vdev->ops->read)
+    /* A read observes every write buffered before it */
+    if (level == VDEV_LEVEL_LOW && _vdev_coalesced_size)
+        vdev_coalesced_flush(guest_current_vmid());
+
+    if (vdev->ops->read) {
+        stamp = timer_stamp();
         size = vdev->ops->read(info, regs);
+        exit_stats_vdev(guest_current_vmid(), level, num, stamp);
+    }
 
     return size;
 }
@@ -104,6 +354,7 @@ int32_t vdev_write(int level, int num, struct arch_vdev_trigger_info *info,
 {
     int32_t size = 0;
     struct vdev_module *vdev = _vdev_module[level][num];
+    uint32_t stamp;
 
     if (!vdev) {
         printh("vdev : Could not get module, level : %d, i : %d\n",
@@ -117,8 +368,15 @@ int32_t vdev_write(int level, int num, struct arch_vdev_trigger_info *info,
         return VDEV_ERROR;
     }
 
-    if (vdev->ops->write)
+    if (level == VDEV_LEVEL_LOW && _vdev_coalesced_size &&
+            vdev_coalesced_write(num, info) != VDEV_NOT_FOUND)
+        return 0;
+
+    if (vdev->ops->write) {
+        stamp = timer_stamp();
         size = vdev->ops->write(info, regs);
+        exit_stats_vdev(guest_current_vmid(), level, num, stamp);
+    }
 
     return size;
 }
@@ -147,12 +405,121 @@ hvmm_status_t vdev_post(int level, int num, struct arch_vdev_trigger_info *info,
     return result;
 }
 
+hvmm_status_t vdev_map_guest(vcpuid_t vmid, struct vdev_module *module,
+        struct vdev_memory_map *map)
+{
+    int32_t i;
+
+    if (vmid >= NUM_GUESTS_STATIC)
+        return HVMM_STATUS_BAD_ACCESS;
+
+    for (i = 0; i < _vdev_size[VDEV_LEVEL_LOW]; i++) {
+        if (_vdev_module[VDEV_LEVEL_LOW][i] == module)
+            return vdev_map_insert(_vdev_guest_maps[vmid],
+                    &_vdev_guest_maps_size[vmid], MAX_VDEV_GUEST_MAPS,
+                    map, i);
+    }
+
+    printh("vdev : '%s' is not a registered low level vdev\n",
+            module->name);
+    return HVMM_STATUS_BAD_ACCESS;
+}
+
+hvmm_status_t vdev_coalesce(struct vdev_module *module,
+        struct vdev_memory_map *map)
+{
+    int32_t i;
+
+    for (i = 0; i < MAX_VDEV && _vdev_module[VDEV_LEVEL_LOW][i]; i++) {
+        if (_vdev_module[VDEV_LEVEL_LOW][i] != module)
+            continue;
+        if (!module->ops->write)
+            return HVMM_STATUS_BAD_ACCESS;
+
+        return vdev_map_insert(_vdev_coalesced, &_vdev_coalesced_size,
+                MAX_VDEV_COALESCED, map, i);
+    }
+
+    printh("vdev : '%s' is not a registered low level vdev\n",
+            module->name);
+    return HVMM_STATUS_BAD_ACCESS;
+}
+
+hvmm_status_t vdev_hvc_bind(struct vdev_module *module, uint32_t imm,
+        uint32_t fid)
+{
+    uint32_t h;
+    int32_t i;
+
+    imm &= 0xFFFF;
+    if (imm != VDEV_HVC_IMM_SMCCC)
+        fid = 0;
+
+    if (_vdev_hvcs_size == 0) {
+        for (i = 0; i < VDEV_HVC_HASH_SIZE; i++)
+            _vdev_hvcs[i].num = VDEV_NOT_FOUND;
+    }
+
+    if (vdev_hvc_lookup(imm, fid) != VDEV_NOT_FOUND) {
+        printh("vdev : hvc %x(%x) is already bound\n", imm, fid);
+        return HVMM_STATUS_BAD_ACCESS;
+    }
+
+    /* Keep one slot free, lookups stop at an empty entry */
+    if (_vdev_hvcs_size >= VDEV_HVC_HASH_SIZE - 1)
+        return HVMM_STATUS_BUSY;
+
+    for (i = 0; i < MAX_VDEV && _vdev_module[VDEV_LEVEL_MIDDLE][i]; i++) {
+        if (_vdev_module[VDEV_LEVEL_MIDDLE][i] != module)
+            continue;
+
+        h = vdev_hvc_hash(imm, fid);
+        while (_vdev_hvcs[h].num != VDEV_NOT_FOUND)
+            h = (h + 1) & VDEV_HVC_HASH_MASK;
+        _vdev_hvcs[h].imm = imm;
+        _vdev_hvcs[h].fid = fid;
+        _vdev_hvcs[h].num = i;
+        _vdev_hvcs_size++;
+
+        return HVMM_STATUS_SUCCESS;
+    }
+
+    printh("vdev : '%s' is not a registered middle level vdev\n",
+            module->name);
+    return HVMM_STATUS_BAD_ACCESS;
+}
+
+/*
+ * Builds the MMIO range table from the registered VDEV_LEVEL_LOW modules.
+ */
+static hvmm_status_t vdev_map_init(void)
+{
+    int32_t i;
+    struct vdev_module *vdev;
+
+    for (i = 0; i < _vdev_size[VDEV_LEVEL_LOW]; i++) {
+        vdev = _vdev_module[VDEV_LEVEL_LOW][i];
+        if (!vdev->map)
+            continue;
+        if (vdev_map_insert(_vdev_maps, &_vdev_maps_size, MAX_VDEV_MAPS,
+                    vdev->map, i)) {
+            printh("vdev : Could not map '%s' at %x\n", vdev->name,
+                    vdev->map->base);
+            return HVMM_STATUS_UNKNOWN_ERROR;
+        }
+    }
+
+    return HVMM_STATUS_SUCCESS;
+}
+
 hvmm_status_t vdev_save(vcpuid_t vmid)
 {
     int i, j;
     struct vdev_module *vdev;
     hvmm_status_t result = HVMM_STATUS_UNKNOWN_ERROR;
 
+    vdev_coalesced_flush(vmid);
+
     /* TODO : change one level iteration */
     for (i = 0; i < VDEV_LEVEL_MAX; i++) {
         for (j = 0; j < _vdev_size[i]; j++) {
@@ -239,6 +606,13 @@ hvmm_status_t vdev_init(void)
             }
             _vdev_size[VDEV_LEVEL_LOW]++;
         }
+
+        if (vdev_map_init())
+            return HVMM_STATUS_UNKNOWN_ERROR;
+
+        for (i = 0; i < NUM_GUESTS_STATIC; i++)
+            timer_event_init(&_vdev_coalesced_ring[i].flush,
+                    vdev_coalesced_expired, &_vdev_coalesced_ring[i]);
     }
 
     for (i = 0; i < VDEV_LEVEL_MAX; i++) {
@@ -0,0 +1,361 @@
+/*
+ * virtio.c
+ * --------------------------------------
+ * virtio-mmio transport and split virtqueues
+ */
+
+#include <virtio.h>
+#include <memory.h>
+#include <interrupt.h>
+#include <asm-arm_inline.h>
+#include <log/print.h>
+
+static void virtio_reset(struct virtio_device *dev)
+{
+    int i;
+
+    dev->status = 0;
+    dev->device_features_sel = 0;
+    dev->driver_features_sel = 0;
+    dev->driver_features[0] = 0;
+    dev->driver_features[1] = 0;
+    dev->queue_sel = 0;
+    dev->interrupt_status = 0;
+    for (i = 0; i < VIRTIO_MAX_QUEUES; i++) {
+        dev->vq[i].num = 0;
+        dev->vq[i].ready = 0;
+        dev->vq[i].desc_addr[0] = dev->vq[i].desc_addr[1] = 0;
+        dev->vq[i].avail_addr[0] = dev->vq[i].avail_addr[1] = 0;
+        dev->vq[i].used_addr[0] = dev->vq[i].used_addr[1] = 0;
+        dev->vq[i].desc = 0;
+        dev->vq[i].avail = 0;
+        dev->vq[i].used = 0;
+        dev->vq[i].last_avail = 0;
+    }
+
+    if (dev->backend->reset)
+        dev->backend->reset(dev);
+}
+
+void virtio_device_init(struct virtio_device *dev,
+        const struct virtio_backend *backend, vcpuid_t vmid,
+        uint32_t virq, void *priv)
+{
+    dev->backend = backend;
+    dev->vmid = vmid;
+    dev->virq = virq;
+    dev->priv = priv;
+    virtio_reset(dev);
+}
+
+static uint32_t virtio_device_features(struct virtio_device *dev)
+{
+    uint64_t features = dev->backend->features |
+        (1ULL << VIRTIO_F_VERSION_1);
+
+    if (dev->device_features_sel == 0)
+        return (uint32_t)features;
+    if (dev->device_features_sel == 1)
+        return (uint32_t)(features >> 32);
+
+    return 0;
+}
+
+/*
+ * Maps the rings of the selected queue into the hypervisor. The driver
+ * programs the addresses and size before setting QueueReady.
+ */
+static hvmm_status_t virtio_queue_enable(struct virtio_device *dev,
+        struct virtqueue *vq)
+{
+    uint32_t num = vq->num;
+
+    /* Split rings are indexed modulo their size, which must divide 2^16 */
+    if (!num || (num & (num - 1)) || num > dev->backend->queue_num_max ||
+            vq->desc_addr[1] ||
+            vq->avail_addr[1] || vq->used_addr[1])
+        return HVMM_STATUS_BAD_ACCESS;
+
+    vq->desc = (struct virtq_desc *)memory_guest_ipa_to_pa(dev->vmid,
+            vq->desc_addr[0], num * sizeof(struct virtq_desc));
+    vq->avail = (struct virtq_avail *)memory_guest_ipa_to_pa(dev->vmid,
+            vq->avail_addr[0], sizeof(struct virtq_avail) +
+            num * sizeof(uint16_t));
+    vq->used = (struct virtq_used *)memory_guest_ipa_to_pa(dev->vmid,
+            vq->used_addr[0], sizeof(struct virtq_used) +
+            num * sizeof(struct virtq_used_elem));
+    if (!vq->desc || !vq->avail || !vq->used)
+        return HVMM_STATUS_BAD_ACCESS;
+
+    vq->last_avail = vq->avail->idx;
+    vq->ready = 1;
+
+    return HVMM_STATUS_SUCCESS;
+}
+
+static uint32_t *virtio_queue_reg(struct virtqueue *vq, uint32_t offset)
+{
+    switch (offset) {
+    case VIRTIO_MMIO_QUEUE_DESC_LOW:
+        return &vq->desc_addr[0];
+    case VIRTIO_MMIO_QUEUE_DESC_HIGH:
+        return &vq->desc_addr[1];
+    case VIRTIO_MMIO_QUEUE_AVAIL_LOW:
+        return &vq->avail_addr[0];
+    case VIRTIO_MMIO_QUEUE_AVAIL_HIGH:
+        return &vq->avail_addr[1];
+    case VIRTIO_MMIO_QUEUE_USED_LOW:
+        return &vq->used_addr[0];
+    case VIRTIO_MMIO_QUEUE_USED_HIGH:
+        return &vq->used_addr[1];
+    }
+
+    return 0;
+}
+
+int32_t virtio_mmio_read(struct virtio_device *dev, uint32_t offset,
+        uint32_t *value, enum vdev_access_size sas)
+{
+    const struct virtio_backend *backend = dev->backend;
+    struct virtqueue *vq = 0;
+    uint32_t shift;
+
+    if (dev->queue_sel < backend->num_queues)
+        vq = &dev->vq[dev->queue_sel];
+
+    if (offset >= VIRTIO_MMIO_CONFIG) {
+        /* The configuration space may be read byte by byte */
+        offset -= VIRTIO_MMIO_CONFIG;
+        *value = 0;
+        if (offset < backend->config_size && backend->read_config) {
+            shift = (offset & 0x3) * 8;
+            *value = backend->read_config(dev, offset & ~0x3) >> shift;
+            if (sas == VDEV_ACCESS_BYTE)
+                *value &= 0xFF;
+            else if (sas == VDEV_ACCESS_HWORD)
+                *value &= 0xFFFF;
+        }
+        return 0;
+    }
+
+    switch (offset) {
+    case VIRTIO_MMIO_MAGIC_VALUE:
+        *value = VIRTIO_MMIO_MAGIC;
+        break;
+    case VIRTIO_MMIO_VERSION:
+        *value = VIRTIO_MMIO_VERSION_2;
+        break;
+    case VIRTIO_MMIO_DEVICE_ID:
+        *value = backend->device_id;
+        break;
+    case VIRTIO_MMIO_VENDOR_ID:
+        *value = VIRTIO_MMIO_VENDOR;
+        break;
+    case VIRTIO_MMIO_DEVICE_FEATURES:
+        *value = virtio_device_features(dev);
+        break;
+    case VIRTIO_MMIO_QUEUE_NUM_MAX:
+        *value = vq ? backend->queue_num_max : 0;
+        break;
+    case VIRTIO_MMIO_QUEUE_NUM:
+        *value = vq ? vq->num : 0;
+        break;
+    case VIRTIO_MMIO_QUEUE_READY:
+        *value = vq ? vq->ready : 0;
+        break;
+    case VIRTIO_MMIO_INTERRUPT_STATUS:
+        *value = dev->interrupt_status;
+        break;
+    case VIRTIO_MMIO_STATUS:
+        *value = dev->status;
+        break;
+    case VIRTIO_MMIO_CONFIG_GENERATION:
+        *value = 0;
+        break;
+    default:
+        if (vq && virtio_queue_reg(vq, offset))
+            *value = *virtio_queue_reg(vq, offset);
+        else
+            *value = 0;
+        break;
+    }
+
+    return 0;
+}
+
+int32_t virtio_mmio_write(struct virtio_device *dev, uint32_t offset,
+        uint32_t value, enum vdev_access_size sas)
+{
+    const struct virtio_backend *backend = dev->backend;
+    struct virtqueue *vq = 0;
+    uint32_t *reg;
+
+    if (dev->queue_sel < backend->num_queues)
+        vq = &dev->vq[dev->queue_sel];
+
+    /* The configuration space of the supported devices is read-only */
+    if (offset >= VIRTIO_MMIO_CONFIG || sas != VDEV_ACCESS_WORD)
+        return 0;
+
+    switch (offset) {
+    case VIRTIO_MMIO_DEVICE_FEATURES_SEL:
+        dev->device_features_sel = value;
+        break;
+    case VIRTIO_MMIO_DRIVER_FEATURES:
+        if (dev->driver_features_sel < 2)
+            dev->driver_features[dev->driver_features_sel] = value;
+        break;
+    case VIRTIO_MMIO_DRIVER_FEATURES_SEL:
+        dev->driver_features_sel = value;
+        break;
+    case VIRTIO_MMIO_QUEUE_SEL:
+        dev->queue_sel = value;
+        break;
+    case VIRTIO_MMIO_QUEUE_NUM:
+        if (vq && !vq->ready)
+            vq->num = value;
+        break;
+    case VIRTIO_MMIO_QUEUE_READY:
+        if (!vq)
+            break;
+        if (!value) {
+            vq->ready = 0;
+        } else if (!vq->ready && virtio_queue_enable(dev, vq)) {
+            printh("virtio: %s queue %d of guest %d is not in guest memory\n",
+                    backend->name, dev->queue_sel, dev->vmid);
+            dev->status |= VIRTIO_STATUS_NEEDS_RESET;
+        }
+        break;
+    case VIRTIO_MMIO_QUEUE_NOTIFY:
+        if (value < backend->num_queues && dev->vq[value].ready &&
+                (dev->status & VIRTIO_STATUS_DRIVER_OK))
+            backend->notify(dev, value);
+        break;
+    case VIRTIO_MMIO_INTERRUPT_ACK:
+        dev->interrupt_status &= ~value;
+        break;
+    case VIRTIO_MMIO_STATUS:
+        if (value == 0) {
+            virtio_reset(dev);
+            break;
+        }
+        if ((value & VIRTIO_STATUS_FEATURES_OK) &&
+                !(dev->status & VIRTIO_STATUS_FEATURES_OK)) {
+            /* Accept only offered features, legacy drivers are refused */
+            uint64_t offered = backend->features |
+                (1ULL << VIRTIO_F_VERSION_1);
+            uint64_t accepted = ((uint64_t)dev->driver_features[1] << 32) |
+                dev->driver_features[0];
+
+            if ((accepted & ~offered) ||
+                    !(accepted & (1ULL << VIRTIO_F_VERSION_1)))
+                value &= ~VIRTIO_STATUS_FEATURES_OK;
+        }
+        dev->status = value;
+        break;
+    default:
+        if (vq && !vq->ready) {
+            reg = virtio_queue_reg(vq, offset);
+            if (reg)
+                *reg = value;
+        }
+        break;
+    }
+
+    return 0;
+}
+
+int virtq_pop(struct virtio_device *dev, uint32_t queue,
+        struct virtq_chain *chain)
+{
+    struct virtqueue *vq = &dev->vq[queue];
+    struct virtq_desc desc;
+    uint16_t head, idx, avail_idx;
+    uint32_t n = 0;
+    uint32_t pa;
+
+    if (!vq->ready)
+        return 0;
+    avail_idx = vq->avail->idx;
+    if (vq->last_avail == avail_idx)
+        return 0;
+
+    /* The driver never has more than the queue size in flight */
+    if ((uint16_t)(avail_idx - vq->last_avail) > vq->num) {
+        printh("virtio: %s queue %d of guest %d made %d buffers available\n",
+                dev->backend->name, queue, dev->vmid,
+                (uint16_t)(avail_idx - vq->last_avail));
+        dev->status |= VIRTIO_STATUS_NEEDS_RESET;
+        vq->ready = 0;
+        return VIRTQ_ERROR;
+    }
+
+    /* Read the ring entry after the index */
+    dmb();
+    head = vq->avail->ring[vq->last_avail % vq->num];
+    vq->last_avail++;
+
+    for (idx = head; ; idx = desc.next) {
+        if (idx >= vq->num || n == VIRTQ_MAX_SEGS)
+            goto error;
+        /*
+         * One copy of the descriptor is checked and used, the guest may
+         * change the ring meanwhile.
+         */
+        desc.addr = vq->desc[idx].addr;
+        desc.len = vq->desc[idx].len;
+        desc.flags = vq->desc[idx].flags;
+        desc.next = vq->desc[idx].next;
+        if (desc.addr >> 32)
+            goto error;
+        pa = memory_guest_ipa_to_pa(dev->vmid, (uint32_t)desc.addr,
+                desc.len);
+        if (!pa)
+            goto error;
+        chain->seg[n].addr = (uint8_t *)pa;
+        chain->seg[n].len = desc.len;
+        chain->seg[n].write = desc.flags & VIRTQ_DESC_F_WRITE;
+        n++;
+        if (!(desc.flags & VIRTQ_DESC_F_NEXT))
+            break;
+    }
+
+    chain->head = head;
+    chain->num = n;
+
+    return 1;
+
+error:
+    printh("virtio: %s queue %d of guest %d has a broken chain at %d\n",
+            dev->backend->name, queue, dev->vmid, head);
+    dev->status |= VIRTIO_STATUS_NEEDS_RESET;
+    vq->ready = 0;
+    return VIRTQ_ERROR;
+}
+
+void virtq_push(struct virtio_device *dev, uint32_t queue,
+        struct virtq_chain *chain, uint32_t len)
+{
+    struct virtqueue *vq = &dev->vq[queue];
+    volatile struct virtq_used_elem *elem;
+    uint16_t idx = vq->used->idx;
+
+    elem = &vq->used->ring[idx % vq->num];
+    elem->id = chain->head;
+    elem->len = len;
+
+    /* Publish the element before the index */
+    dmb();
+    vq->used->idx = idx + 1;
+}
+
+void virtio_notify(struct virtio_device *dev, uint32_t queue)
+{
+    struct virtqueue *vq = &dev->vq[queue];
+
+    if (vq->ready && (vq->avail->flags & VIRTQ_AVAIL_F_NO_INTERRUPT))
+        return;
+
+    dev->interrupt_status |= VIRTIO_INT_USED_RING;
+    interrupt_guest_inject(dev->vmid, dev->virq, 0, INJECT_SW);
+}
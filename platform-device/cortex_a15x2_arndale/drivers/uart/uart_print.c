@@ -2,6 +2,7 @@
 #include "exynos-uart.h"
 #include <include/asm_io.h>
 #include <k-hypervisor-config.h>
+#include <console.h>
 
 #ifdef CFG_EXYNOS5250
 #ifdef CFG_BOARD_ARNDALE
@@ -29,16 +30,28 @@ static int serial_err_check(int op)
     return readl(&uart->uerstat) & mask;
 }
 
-void uart_putc(const char c)
+/* A TX error reports room, the character is dropped as before */
+int uart_tx_full(void)
 {
     struct s5p_uart *const uart = (struct s5p_uart *) UART2_BASE;
-    while ((readl(&uart->ufstat) & TX_FIFO_FULL_MASK)) {
-        if (serial_err_check(1))
-            return;
-    }
+
+    return (readl(&uart->ufstat) & TX_FIFO_FULL_MASK) &&
+            !serial_err_check(1);
+}
+
+void uart_tx(const char c)
+{
+    struct s5p_uart *const uart = (struct s5p_uart *) UART2_BASE;
+
     writeb(c, &uart->utxh);
+}
+
+/* Output goes through the console, which waits for the FIFO if it must */
+void uart_putc(const char c)
+{
+    console_putc(c);
     if (c == '\n')
-        uart_putc('\r');
+        console_putc('\r');
 }
 void uart_print(const char *str)
 {
@@ -68,4 +81,17 @@ void uart_print_hex64(uint64_t v)
     uart_print_hex32((uint32_t)(v & 0xFFFFFFFF));
 }
 
+void uart_print_dec(uint32_t v)
+{
+    char buf[10];
+    int i = 0;
+
+    do {
+        buf[i++] = '0' + v % 10;
+        v /= 10;
+    } while (v);
+    while (i)
+        uart_putc(buf[--i]);
+}
+
 #endif
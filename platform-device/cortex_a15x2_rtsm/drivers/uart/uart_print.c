@@ -1,5 +1,6 @@
 #include "arch_types.h"
 #include <k-hypervisor-config.h>
+#include <console.h>
 
 
 #ifdef CFG_GENERIC_CA15
@@ -11,23 +12,33 @@
 #endif
 
 
-void uart_print(const char *str)
+/* PL011 */
+#define UARTFR          0x18
+#define UARTFR_TXFF     0x20
+
+int uart_tx_full(void)
 {
-    volatile char *pUART = (char *) UART0_BASE;
-    while (*str)
-        *pUART = *str++;
+    return *((volatile uint32_t *)(UART0_BASE + UARTFR)) & UARTFR_TXFF;
 }
 
-void uart_putc(const char c)
+void uart_tx(const char c)
 {
-    /* Wait until there is space in the FIFO */
-    while (*((uint32_t *)(UART0_BASE + 0x18)) & 0x20)
-        ;
-    /* Send the character */
     volatile char *pUART = (char *) UART0_BASE;
     *pUART = c;
 }
 
+/* Output goes through the console, which waits for the FIFO if it must */
+void uart_putc(const char c)
+{
+    console_putc(c);
+}
+
+void uart_print(const char *str)
+{
+    while (*str)
+        uart_putc(*str++);
+}
+
 void uart_print_hex32(uint32_t v)
 {
     unsigned int mask8 = 0xF;
@@ -50,4 +61,17 @@ void uart_print_hex64(uint64_t v)
     uart_print_hex32((uint32_t)(v & 0xFFFFFFFF));
 }
 
+void uart_print_dec(uint32_t v)
+{
+    char buf[10];
+    int i = 0;
+
+    do {
+        buf[i++] = '0' + v % 10;
+        v /= 10;
+    } while (v);
+    while (i)
+        uart_putc(buf[--i]);
+}
+
 #endif
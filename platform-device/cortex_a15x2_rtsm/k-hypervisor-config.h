@@ -61,6 +61,19 @@
 #define MONITOR_TARGET_VMID 0
 #define MONITOR_VIRQ 20
 
+/* Hypervisor events recorded in the trace rings, see trace.h */
+#define CFG_TRACE_EVENT_MASK TRACE_EV_ALL
+
+/*
+ * PMU overflow irqs: cpu n raises SPI CFG_PMU_IRQ_BASE + n, guests see
+ * CFG_PMU_VIRQ whatever cpu they run on
+ */
+#define CFG_PMU_IRQ_BASE 100
+#define CFG_PMU_VIRQ 100
+
+/* Cost probes around the hypervisor's subsystems, see probe.h */
+#define CFG_PROBE
+
 #define SZ_1                0x00000001
 #define SZ_2                0x00000002
 #define SZ_4                0x00000004
@@ -4,6 +4,8 @@
 #include <timer.h>
 #include <vdev.h>
 #include <memory.h>
+#include <ivc.h>
+#include <console.h>
 #include <gic_regs.h>
 #include <test/tests.h>
 #include <smp.h>
@@ -236,6 +238,10 @@ void setup_interrupt()
     DECLARE_VIRQMAP(_guest_virqmap, 0, 46, 46);
     DECLARE_VIRQMAP(_guest_virqmap, 0, 47, 47);
     DECLARE_VIRQMAP(_guest_virqmap, 0, 69, 69);
+
+    /* Virtual timer (CNTV) PPI, passed through to every guest */
+    for (i = 0; i < NUM_GUESTS_STATIC; i++)
+        DECLARE_VIRQMAP(_guest_virqmap, i, 27, 27);
 }
 
 void setup_memory()
@@ -253,6 +259,31 @@ void setup_memory()
 #endif
 }
 
+/*
+ * Decompresses the guest images stored as LZ4 frames, once the hypervisor
+ * runs with its caches on. Guests 2 and 3 are unpacked here as well, before
+ * the other cpus are woken up.
+ */
+void setup_guest_images()
+{
+    guest_image_unpack(0, (uint32_t) &_guest0_bin_start);
+    guest_image_unpack(1, (uint32_t) &_guest1_bin_start);
+#if _SMP_
+    guest_image_unpack(2, (uint32_t) &_guest2_bin_start);
+    guest_image_unpack(3, (uint32_t) &_guest3_bin_start);
+#endif
+}
+
+/*
+ * Creates the inter-VM channels, after the guest memory is initialized.
+ * Channel 0 connects guest 0 and guest 1.
+ */
+void setup_ivc()
+{
+    if (ivc_channel_create(0, 0, 1, SZ_64K))
+        printh("[start_guest] ivc channel 0 creation failed...\n");
+}
+
 /** @brief Registers generic timer irqs such as hypervisor timer event
  *  (GENERIC_TIMER_HYP), non-secure physical timer event(GENERIC_TIMER_NSP)
  *  and virtual timer event(GENERIC_TIMER_NSP).
@@ -286,6 +317,10 @@ int main_cpu_init()
 
     if (memory_init(guest0_mdlist, guest1_mdlist))
         printh("[start_guest] virtual memory initialization failed...\n");
+    /* Decompress the guest images that were stored compressed */
+    setup_guest_images();
+    /* Initialize Inter-VM channels */
+    setup_ivc();
     /* Initialize PIRQ to VIRQ mapping */
     setup_interrupt();
     /* Initialize Interrupt Management */
@@ -317,6 +352,9 @@ int main_cpu_init()
     /* Print Banner */
     printH("%s", BANNER_STRING);
 
+    /* Console output no longer waits for the UART from here on */
+    console_init();
+
     /* Switch to the first guest */
     guest_sched_start();
 